@@ -0,0 +1,110 @@
+/** @file
+ *****************************************************************************
+
+ Microbenchmarks for the bit/byte conversions in libzerocash/utils/util.cpp,
+ measured against the bit-at-a-time versions they replaced.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bench/benchmark.h"
+#include "libzerocash/utils/util.h"
+
+namespace legacy {
+
+void convertBytesToVector(const unsigned char* bytes, std::vector<bool>& v) {
+    int numBytes = v.size() / 8;
+    unsigned char c;
+    for(int i = 0; i < numBytes; i++) {
+        c = bytes[i];
+
+        for(int j = 0; j < 8; j++) {
+            v.at((i*8)+j) = ((c >> (7-j)) & 1);
+        }
+    }
+}
+
+void convertVectorToBytes(const std::vector<bool>& v, unsigned char* bytes) {
+    int numBytes = v.size() / 8;
+    unsigned char c = '\0';
+
+    for(int i = 0; i < numBytes; i++) {
+        c = '\0';
+        for(int j = 0; j < 8; j++) {
+            if(j == 7)
+                c = ((c | v.at((i*8)+j)));
+            else
+                c = ((c | v.at((i*8)+j)) << 1);
+        }
+        bytes[i] = c;
+    }
+}
+
+void convertBytesVectorToVector(const std::vector<unsigned char>& bytes, std::vector<bool>& v) {
+    v.resize(bytes.size() * 8);
+    unsigned char bytesArr[bytes.size()];
+    for(size_t i = 0; i < bytes.size(); i++) {
+        bytesArr[i] = bytes.at(i);
+    }
+    convertBytesToVector(bytesArr, v);
+}
+
+void convertVectorToBytesVector(const std::vector<bool>& v, std::vector<unsigned char>& bytes) {
+    unsigned char bytesArr[int(ceil(v.size() / 8.))];
+    convertVectorToBytes(v, bytesArr);
+    for(size_t i = 0; i < bytes.size(); i++) {
+        bytes.at(i) = bytesArr[i];
+    }
+}
+
+} /* namespace legacy */
+
+int main(int argc, char** argv) {
+    BenchmarkRunner runner("bench_conversions", argc, argv);
+    const size_t sizes[] = { 8, 32, 64, 1024 };
+    bool ok = true;
+
+    for (size_t n : sizes) {
+        std::vector<unsigned char> bytes(n), out_legacy(n), out_current(n);
+        libzerocash::getRandBytes(bytes.data(), n);
+        std::vector<bool> bits(8 * n), bits_legacy(8 * n);
+
+        libzerocash::convertBytesToVector(bytes.data(), bits);
+        legacy::convertBytesToVector(bytes.data(), bits_legacy);
+        libzerocash::convertVectorToBytes(bits, out_current.data());
+        legacy::convertVectorToBytes(bits, out_legacy.data());
+        ok = ok && (bits == bits_legacy) && (out_current == out_legacy) && (out_current == bytes);
+
+        const std::string size = "/" + std::to_string(n);
+        runner.run("convertBytesToVector/legacy" + size,
+                   [&] { legacy::convertBytesToVector(bytes.data(), bits); });
+        runner.run("convertBytesToVector/current" + size,
+                   [&] { libzerocash::convertBytesToVector(bytes.data(), bits); });
+        runner.run("convertVectorToBytes/legacy" + size,
+                   [&] { legacy::convertVectorToBytes(bits, out_legacy.data()); });
+        runner.run("convertVectorToBytes/current" + size,
+                   [&] { libzerocash::convertVectorToBytes(bits, out_current.data()); });
+        runner.run("convertBytesVectorToVector/legacy" + size,
+                   [&] { legacy::convertBytesVectorToVector(bytes, bits); });
+        runner.run("convertBytesVectorToVector/current" + size,
+                   [&] { libzerocash::convertBytesVectorToVector(bytes, bits); });
+        runner.run("convertVectorToBytesVector/legacy" + size,
+                   [&] { legacy::convertVectorToBytesVector(bits, out_legacy); });
+        runner.run("convertVectorToBytesVector/current" + size,
+                   [&] { libzerocash::convertVectorToBytesVector(bits, out_current); });
+    }
+
+    if (!ok) {
+        printf("MISMATCH between legacy and current conversions\n");
+        return 1;
+    }
+    return runner.finish();
+}
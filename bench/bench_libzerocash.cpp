@@ -0,0 +1,254 @@
+/** @file
+ *****************************************************************************
+
+ Benchmarks for the hot paths of libzerocash: hashing, bit conversions, the
+ Merkle trees, the serial number set, coin and address creation, minting
+ and pouring, and connecting blocks. See bench/benchmark.h for the options; in addition,
+
+   --pour-tree-depth=N   depth of the tree the Pour keys are generated for
+                         (default ZEROCASH_DEFAULT_TREE_SIZE)
+
+ The Pour benchmarks generate a fresh key pair first, which takes a while;
+ use --filter to leave them out.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bench/benchmark.h"
+#include "libsnark/common/profiling.hpp"
+#include "libzerocash/Address.h"
+#include "libzerocash/BlockValidator.h"
+#include "libzerocash/Coin.h"
+#include "libzerocash/IncrementalMerkleTree.h"
+#include "libzerocash/MintTransaction.h"
+#include "libzerocash/PourOutput.h"
+#include "libzerocash/PourTransaction.h"
+#include "libzerocash/PourTransactionView.h"
+#include "libzerocash/SerialNumberSet.h"
+#include "libzerocash/ZerocashParams.h"
+#include "libzerocash/utils/util.h"
+
+using namespace libzerocash;
+
+static std::vector<Digest256> randomLeaves(size_t count) {
+    std::vector<Digest256> leaves(count);
+    for (size_t i = 0; i < count; i++) {
+        getRandBytes(leaves[i].data(), Digest256::BYTES);
+    }
+    return leaves;
+}
+
+static void benchHashing(BenchmarkRunner &runner) {
+    unsigned char blocks[8][64];
+    unsigned char hashes[8][SHA256_BLOCK_SIZE];
+    getRandBytes(&blocks[0][0], sizeof(blocks));
+
+    runner.run("sha256/compress_block", [&] { sha256_compress_block(blocks[0], hashes[0]); });
+    runner.run("sha256/compress_x4", [&] { sha256_compress_x4(blocks, hashes); });
+    runner.run("sha256/compress_x8", [&] { sha256_compress_x8(blocks, hashes); });
+}
+
+static void benchConversions(BenchmarkRunner &runner) {
+    std::vector<unsigned char> bytes(32);
+    getRandBytes(bytes.data(), bytes.size());
+    std::vector<bool> bits(256);
+
+    runner.run("util/convertBytesVectorToVector/32", [&] { convertBytesVectorToVector(bytes, bits); });
+    runner.run("util/convertVectorToBytesVector/32", [&] { convertVectorToBytesVector(bits, bytes); });
+
+    Digest256 digest = Digest256::fromBytesVector(bytes);
+    runner.run("util/Digest256::toBitVector", [&] { bits = digest.toBitVector(); });
+    runner.run("util/Digest256::fromBitVector", [&] { digest = Digest256::fromBitVector(bits); });
+}
+
+static void benchMerkleTree(BenchmarkRunner &runner, uint32_t depth) {
+    const std::string suffix = "/depth" + std::to_string(depth);
+    const size_t prefill = 1000;
+    std::vector<Digest256> leaves = randomLeaves(prefill);
+
+    IncrementalMerkleTree tree(depth);
+    tree.appendBatch(leaves);
+
+    std::vector<bool> index;
+    runner.run("merkle/insert" + suffix, [&] {
+        if (!tree.insertElement(leaves[0], index)) {
+            tree = IncrementalMerkleTree(depth);
+            tree.insertElement(leaves[0], index);
+        }
+    });
+
+    runner.run("merkle/append_batch_1000" + suffix, [&] {
+        IncrementalMerkleTree batch(depth);
+        batch.appendBatch(leaves);
+    });
+
+    IncrementalMerkleTree full(depth);
+    full.appendBatch(leaves);
+    std::vector<bool> leafIndex;
+    convertIntToVector(prefill / 3, leafIndex);
+    merkle_authentication_path path(depth);
+    runner.run("merkle/witness" + suffix, [&] { full.getWitness(leafIndex, path); });
+
+    Digest256 root;
+    runner.run("merkle/root" + suffix, [&] { full.getRootValue(root); });
+
+    full.prune();
+    runner.run("merkle/compact" + suffix, [&] { full.getCompactRepresentation(); });
+
+    IncrementalMerkleTreeCompact compact = full.getCompactRepresentation();
+    runner.run("merkle/from_compact" + suffix, [&] { IncrementalMerkleTree restored(compact); });
+
+    IncrementalMerkleTree witnessed(depth);
+    witnessed.appendBatch(leaves);
+    IncrementalWitness witness;
+    witnessed.getIncrementalWitness(witness);
+    runner.run("merkle/incremental_witness_append" + suffix, [&] {
+        if (!witness.append(leaves[1])) {
+            witnessed.getIncrementalWitness(witness);
+        }
+    });
+}
+
+static void benchSerialNumbers(BenchmarkRunner &runner, unsigned bloomBitsPerSerial) {
+    const std::string suffix = bloomBitsPerSerial ? "/bloom" + std::to_string(bloomBitsPerSerial) : "";
+    if (!runner.enabled({ "serials/insert_batch_10000" + suffix, "serials/contains_batch_10000" + suffix })) {
+        return;
+    }
+
+    const size_t prefill = 1000000;
+    SerialNumberSet set(prefill, bloomBitsPerSerial);
+    std::vector<bool> flags;
+    set.insertBatch(randomLeaves(prefill), flags);
+
+    std::vector<Digest256> spent = randomLeaves(10000);
+    runner.run("serials/insert_batch_10000" + suffix, [&] {
+        SerialNumberSet batch(spent.size(), bloomBitsPerSerial);
+        batch.insertBatch(spent, flags);
+    });
+
+    // Half already spent, half not, as a block of double spends would be.
+    std::vector<Digest256> queries = randomLeaves(5000);
+    std::vector<Digest256> some = randomLeaves(5000);
+    set.insertBatch(some, flags);
+    queries.insert(queries.end(), some.begin(), some.end());
+    runner.run("serials/contains_batch_10000" + suffix, [&] { set.containsBatch(queries, flags); });
+}
+
+static void benchCoins(BenchmarkRunner &runner) {
+    runner.run("address/create", [&] { Address::CreateNewRandomAddress(); });
+
+    Address address = Address::CreateNewRandomAddress();
+    PublicAddress publicAddress = address.getPublicAddress();
+    runner.run("coin/create", [&] { Coin coin(publicAddress, 42); });
+
+    Coin coin(publicAddress, 42);
+    runner.run("mint/create", [&] { MintTransaction mint(coin); });
+
+    MintTransaction mint(coin);
+    runner.run("mint/verify", [&] { mint.verify(); });
+
+    std::vector<uint8_t> encoded(ZC_TX_MINT_SIZE);
+    runner.run("mint/serialize", [&] { mint.serialize(encoded.data()); });
+    MintTransaction decoded;
+    runner.run("mint/deserialize", [&] { decoded.deserialize(encoded.data()); });
+}
+
+static void benchPour(BenchmarkRunner &runner, uint32_t depth) {
+    const std::string suffix = "/depth" + std::to_string(depth);
+    if (!runner.enabled({ "pour/prove" + suffix, "pour/verify" + suffix, "pour/verify_batch_8" + suffix,
+                          "pour/serialize" + suffix, "pour/deserialize" + suffix, "pour/verify_view" + suffix,
+                          "block/connect_8" + suffix })) {
+        return;
+    }
+
+    printf("Generating Pour keys for depth %u...\n", depth);
+    fflush(stdout);
+    ZerocashParams params(depth, ZerocashParams::GenerateNewKeyPair(depth));
+
+    IncrementalMerkleTree tree(depth);
+    MerkleRootType rt(ZC_ROOT_SIZE);
+    tree.getRootValue(rt);
+    std::vector<unsigned char> pubkeyHash(ZC_SIG_PK_SIZE, 'a');
+
+    // A pour of public funds into a single new coin; the inputs are the
+    // dummy coins of value 0.
+    auto pour = [&] {
+        return PourTransaction(params, pubkeyHash, rt, {}, { PourOutput(1) }, 1, 0);
+    };
+
+    runner.run("pour/prove" + suffix, [&] { pour(); });
+
+    PourTransaction tx = pour();
+    runner.run("pour/verify" + suffix, [&] { tx.verify(params, pubkeyHash, rt); });
+
+    std::vector<uint8_t> encoded(ZC_TX_POUR_SIZE);
+    runner.run("pour/serialize" + suffix, [&] { tx.serialize(encoded.data()); });
+    PourTransaction decoded;
+    runner.run("pour/deserialize" + suffix, [&] { decoded.deserialize(encoded.data()); });
+
+    PourTransactionView view(encoded.data());
+    runner.run("pour/verify_view" + suffix, [&] { view.verify(params, pubkeyHash, rt); });
+
+    std::vector<PourTransaction> txs;
+    for (size_t i = 0; i < 8; i++) {
+        txs.push_back(pour());
+    }
+    std::vector<const PourTransaction*> txPointers;
+    for (const PourTransaction &t : txs) {
+        txPointers.push_back(&t);
+    }
+    std::vector<std::vector<unsigned char> > pubkeyHashes(txs.size(), pubkeyHash);
+    std::vector<MerkleRootType> roots(txs.size(), rt);
+    std::vector<size_t> failed;
+    runner.run("pour/verify_batch_8" + suffix, [&] {
+        PourTransaction::verifyBatch(params, txPointers, pubkeyHashes, roots, failed);
+    });
+
+    // Each run connects the block to a fresh chain, so that its serial
+    // numbers are unspent.
+    runner.run("block/connect_8" + suffix, [&] {
+        IncrementalMerkleTree chainTree(depth);
+        SerialNumberSet spent;
+        BlockValidator validator(params, chainTree, spent);
+        validator.connectBlock({}, txs, pubkeyHashes, roots);
+    });
+}
+
+int main(int argc, char** argv) {
+    // Split off our own option; the rest go to the runner.
+    uint32_t pourDepth = ZEROCASH_DEFAULT_TREE_SIZE;
+    std::vector<char*> args;
+    for (int i = 0; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.compare(0, 18, "--pour-tree-depth=") == 0) {
+            pourDepth = atoi(arg.c_str() + 18);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    BenchmarkRunner runner("bench_libzerocash", args.size(), args.data());
+
+    inhibit_profiling_info = true;
+    inhibit_profiling_counters = true;
+
+    benchHashing(runner);
+    benchConversions(runner);
+    for (uint32_t depth : { 20, 32, 64 }) {
+        benchMerkleTree(runner, depth);
+    }
+    benchSerialNumbers(runner, 0);
+    benchSerialNumbers(runner, 10);
+    benchCoins(runner);
+    benchPour(runner, pourDepth);
+
+    return runner.finish();
+}
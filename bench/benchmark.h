@@ -0,0 +1,208 @@
+/** @file
+ *****************************************************************************
+
+ A small harness for the programs in bench/: adaptive timing of a function,
+ a plain-text report on stdout and, with --json=FILE, a machine-readable
+ report that bench/compare-benchmarks.py can check against a baseline.
+
+ Options understood by every benchmark program:
+
+   --json=FILE        also write the results to FILE as JSON
+   --filter=STRING    only run benchmarks whose name contains STRING
+   --min-time=SECS    minimum duration of each timed sample (default 0.1)
+   --repetitions=N    number of timed samples per benchmark (default 5)
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(const std::string &suite, int argc, char** argv) :
+        suite(suite), minTime(0.1), repetitions(5)
+    {
+        for (int i = 1; i < argc; i++) {
+            std::string arg(argv[i]);
+            if (arg.compare(0, 7, "--json=") == 0) {
+                this->jsonPath = arg.substr(7);
+            } else if (arg.compare(0, 9, "--filter=") == 0) {
+                this->filter = arg.substr(9);
+            } else if (arg.compare(0, 11, "--min-time=") == 0) {
+                this->minTime = atof(arg.c_str() + 11);
+            } else if (arg.compare(0, 14, "--repetitions=") == 0) {
+                this->repetitions = std::max(1, atoi(arg.c_str() + 14));
+            } else {
+                throw std::invalid_argument("unknown option " + arg);
+            }
+        }
+    }
+
+    /* Whether any of the named benchmarks will run; lets a program skip
+     * expensive setup (such as generating keys) for filtered-out groups. */
+    bool enabled(const std::vector<std::string> &names) const {
+        for (const std::string &name : names) {
+            if (this->enabled(name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool enabled(const std::string &name) const {
+        return this->filter.empty() || name.find(this->filter) != std::string::npos;
+    }
+
+    /* Times f, called repeatedly: the number of calls per sample is raised
+     * until a sample takes at least the minimum time, then the remaining
+     * samples are taken with that many calls. Reports nanoseconds per call. */
+    void run(const std::string &name, const std::function<void()> &f) {
+        if (!this->enabled(name)) {
+            return;
+        }
+
+        uint64_t iterations = 1;
+        double elapsed = this->timeCalls(f, iterations);
+        while (elapsed < this->minTime * 1e9) {
+            // Aim a little past the minimum rather than doubling blindly, so
+            // that slow functions are not run far more often than needed.
+            double perCall = elapsed / iterations;
+            uint64_t target = (perCall > 0) ? (uint64_t) (1.2 * this->minTime * 1e9 / perCall) : 2 * iterations;
+            iterations = std::max(2 * iterations, std::min(target, 100 * iterations));
+            elapsed = this->timeCalls(f, iterations);
+        }
+
+        Result result;
+        result.name = name;
+        result.iterations = iterations;
+        result.samples.push_back(elapsed / iterations);
+        for (int r = 1; r < this->repetitions; r++) {
+            result.samples.push_back(this->timeCalls(f, iterations) / iterations);
+        }
+        std::sort(result.samples.begin(), result.samples.end());
+
+        printf("%-48s %12.1f ns/op  (min %12.1f, max %12.1f, %llu calls x %zu)\n",
+               name.c_str(), result.median(), result.samples.front(), result.samples.back(),
+               (unsigned long long) iterations, result.samples.size());
+        fflush(stdout);
+
+        this->results.push_back(result);
+    }
+
+    /* Writes the JSON report, if one was asked for. Returns the exit status
+     * for main. */
+    int finish() const {
+        if (this->jsonPath.empty()) {
+            return 0;
+        }
+
+        std::ofstream out(this->jsonPath.c_str());
+        if (!out.is_open()) {
+            fprintf(stderr, "could not write %s\n", this->jsonPath.c_str());
+            return 1;
+        }
+
+        char host[256] = { 0 };
+        gethostname(host, sizeof(host) - 1);
+        char date[32] = { 0 };
+        time_t now = time(NULL);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+        out.setf(std::ios::fixed);
+        out.precision(1);
+        out << "{\n";
+        out << "  \"context\": {\n";
+        out << "    \"suite\": \"" << escape(this->suite) << "\",\n";
+        out << "    \"date\": \"" << date << "\",\n";
+        out << "    \"host\": \"" << escape(host) << "\",\n";
+        out << "    \"compiler\": \"" << escape(__VERSION__) << "\",\n";
+#ifdef MULTICORE
+        out << "    \"multicore\": true,\n";
+#else
+        out << "    \"multicore\": false,\n";
+#endif
+        out << "    \"min_time_s\": " << std::setprecision(3) << this->minTime << std::setprecision(1) << ",\n";
+        out << "    \"repetitions\": " << this->repetitions << "\n";
+        out << "  },\n";
+        out << "  \"benchmarks\": [";
+        for (size_t i = 0; i < this->results.size(); i++) {
+            const Result &r = this->results[i];
+            out << (i == 0 ? "\n" : ",\n");
+            out << "    { \"name\": \"" << escape(r.name) << "\""
+                << ", \"iterations\": " << r.iterations
+                << ", \"ns_per_op\": " << r.median()
+                << ", \"ns_per_op_min\": " << r.samples.front()
+                << ", \"ns_per_op_max\": " << r.samples.back()
+                << " }";
+        }
+        out << "\n  ]\n}\n";
+
+        return out.good() ? 0 : 1;
+    }
+
+private:
+    struct Result {
+        std::string name;
+        uint64_t iterations;
+        std::vector<double> samples;    // ns per call, sorted
+
+        double median() const {
+            size_t n = this->samples.size();
+            return (n % 2) ? this->samples[n / 2] : (this->samples[n / 2 - 1] + this->samples[n / 2]) / 2;
+        }
+    };
+
+    static double timeCalls(const std::function<void()> &f, uint64_t iterations) {
+        typedef std::chrono::steady_clock clock;
+        clock::time_point start = clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            f();
+        }
+        return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    }
+
+    static std::string escape(const std::string &s) {
+        std::string result;
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+                result += c;
+            } else if ((unsigned char) c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                result += buf;
+            } else {
+                result += c;
+            }
+        }
+        return result;
+    }
+
+    std::string suite;
+    std::string jsonPath;
+    std::string filter;
+    double minTime;
+    int repetitions;
+    std::vector<Result> results;
+};
+
+#endif /* BENCHMARK_H_ */
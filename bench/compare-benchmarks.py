@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+#
+# Compares two JSON reports written by the programs in bench/ (with --json)
+# and exits with status 1 if any benchmark got slower than the threshold.
+#
+# usage: bench/compare-benchmarks.py [--threshold=0.10] BASELINE.json CURRENT.json
+
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        report = json.load(f)
+    return dict((b["name"], b["ns_per_op"]) for b in report["benchmarks"])
+
+
+def main(argv):
+    threshold = 0.10
+    paths = []
+    for arg in argv[1:]:
+        if arg.startswith("--threshold="):
+            threshold = float(arg[len("--threshold="):])
+        else:
+            paths.append(arg)
+    if len(paths) != 2:
+        sys.stderr.write("usage: %s [--threshold=0.10] BASELINE.json CURRENT.json\n" % argv[0])
+        return 2
+
+    baseline = load(paths[0])
+    current = load(paths[1])
+
+    regressions = 0
+    for name in sorted(set(baseline) | set(current)):
+        if name not in current:
+            print("%-48s %14s  (missing from current run)" % (name, ""))
+            continue
+        if name not in baseline:
+            print("%-48s %14.1f ns  (new)" % (name, current[name]))
+            continue
+
+        change = current[name] / baseline[name] - 1.0
+        flag = ""
+        if change > threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-48s %14.1f ns  %+7.1f%%%s" % (name, current[name], 100.0 * change, flag))
+
+    if regressions:
+        print("%d benchmark(s) more than %.0f%% slower than the baseline" % (regressions, 100.0 * threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
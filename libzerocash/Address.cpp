@@ -31,6 +31,11 @@ using CryptoPP::StringStore;
 namespace libzerocash {
 
 PrivateAddress::PrivateAddress(const std::vector<unsigned char> a_sk, const std::string sk_enc) {
+    this->a_sk = Digest256::fromBytesVector(a_sk);
+    this->sk_enc = sk_enc;
+}
+
+PrivateAddress::PrivateAddress(const Digest256& a_sk, const std::string sk_enc) {
     this->a_sk = a_sk;
     this->sk_enc = sk_enc;
 }
@@ -51,27 +56,17 @@ const std::string PrivateAddress::getEncryptionSecretKey() const {
     return this->sk_enc;
 }
 
-const std::vector<unsigned char>& PrivateAddress::getAddressSecret() const {
+const Digest256& PrivateAddress::getAddressSecret() const {
     return this->a_sk;
 }
 
-PublicAddress::PublicAddress(): a_pk(ZC_A_PK_SIZE) {
+PublicAddress::PublicAddress(): a_pk() {
     this->pk_enc = "";
 }
 
-PublicAddress::PublicAddress(const PrivateAddress& addr_sk): a_pk(ZC_A_PK_SIZE) {
-    std::vector<bool> a_sk_bool(ZC_A_SK_SIZE * 8);
-    convertBytesVectorToVector(addr_sk.getAddressSecret(), a_sk_bool);
-
-    std::vector<bool> zeros_256(256, 0);
-
-    std::vector<bool> a_pk_internal;
-    concatenateVectors(a_sk_bool, zeros_256, a_pk_internal);
-
-    std::vector<bool> a_pk_bool(ZC_A_PK_SIZE * 8);
-    hashVector(a_pk_internal, a_pk_bool);
-
-    convertVectorToBytesVector(a_pk_bool, this->a_pk);
+PublicAddress::PublicAddress(const PrivateAddress& addr_sk): a_pk() {
+    // a_pk = H(a_sk || 0^256)
+    this->a_pk = hashBlock(concatenate(addr_sk.getAddressSecret(), Digest256()));
 
     ECIES<ECP>::PublicKey publicKey;
 
@@ -90,7 +85,7 @@ const std::string PublicAddress::getEncryptionPublicKey() const {
     return this->pk_enc;
 }
 
-const std::vector<unsigned char>& PublicAddress::getPublicAddressSecret() const {
+const Digest256& PublicAddress::getPublicAddressSecret() const {
     return this->a_pk;
 }
 
@@ -127,11 +122,8 @@ bool Address::operator!=(const Address& rhs) const {
 }
 
 Address Address::CreateNewRandomAddress() {
-    std::vector<unsigned char> a_sk(ZC_A_SK_SIZE);
-
-    unsigned char a_sk_bytes[ZC_A_SK_SIZE];
-    getRandBytes(a_sk_bytes, ZC_A_SK_SIZE);
-    convertBytesToBytesVector(a_sk_bytes, a_sk);
+    Digest256 a_sk;
+    getRandBytes(a_sk.data(), ZC_A_SK_SIZE);
 
     AutoSeededRandomPool prng;
 
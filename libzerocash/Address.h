@@ -15,6 +15,7 @@
 #include <vector>
 #include <string>
 
+#include "utils/Bits.h"
 
 namespace libzerocash {
 
@@ -25,15 +26,16 @@ public:
     /* This constructor is to be used ONLY for deserialization. */
     PrivateAddress();
     PrivateAddress(const std::vector<unsigned char> a_sk, const std::string sk_enc);
+    PrivateAddress(const Digest256& a_sk, const std::string sk_enc);
 
     bool operator==(const PrivateAddress& rhs) const;
     bool operator!=(const PrivateAddress& rhs) const;
 
-    const std::vector<unsigned char>& getAddressSecret() const;
+    const Digest256& getAddressSecret() const;
     const std::string getEncryptionSecretKey() const;
 
 private:
-    std::vector<unsigned char> a_sk;
+    Digest256 a_sk;
     std::string sk_enc;
 
 };
@@ -50,11 +52,11 @@ public:
     bool operator!=(const PublicAddress& rhs) const;
 
 
-    const std::vector<unsigned char>& getPublicAddressSecret() const;
+    const Digest256& getPublicAddressSecret() const;
     const std::string getEncryptionPublicKey() const;
 
 private:
-    std::vector<unsigned char> a_pk;
+    Digest256 a_pk;
     std::string pk_enc;
 };
 
@@ -0,0 +1,163 @@
+/** @file
+ *****************************************************************************
+
+ Implementation of interfaces for the class BlockValidator.
+
+ See BlockValidator.h .
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+#include "BlockValidator.h"
+
+namespace libzerocash {
+
+BlockValidator::BlockValidator(const ZerocashParams& params,
+                               IncrementalMerkleTree& tree,
+                               SerialNumberSet& spentSerials,
+                               unsigned int num_threads) :
+    tree(tree), spentSerials(spentSerials), verifier(params, num_threads)
+{
+    Digest256 root;
+    this->tree.getRootValue(root);
+    this->anchors.insert(root);
+}
+
+void BlockValidator::addAnchor(const MerkleRootType& root)
+{
+    if (root.size() != Digest256::BYTES) {
+        throw std::invalid_argument("BlockValidator: anchor of the wrong size");
+    }
+    this->anchors.insert(Digest256(root.data()));
+}
+
+bool BlockValidator::isAnchor(const MerkleRootType& root) const
+{
+    return root.size() == Digest256::BYTES && this->anchors.count(Digest256(root.data())) != 0;
+}
+
+BlockValidator::Result BlockValidator::connectBlock(const std::vector<MintTransaction>& mints,
+                                                    const std::vector<PourTransaction>& pours,
+                                                    const std::vector<std::vector<unsigned char> >& pubkeyHashes,
+                                                    const std::vector<MerkleRootType>& merkleRoots)
+{
+    if (pubkeyHashes.size() != pours.size() || merkleRoots.size() != pours.size()) {
+        throw std::invalid_argument("BlockValidator: need a public key hash and a root for each pour");
+    }
+
+    // Everything short of the proofs costs a few hashes and lookups, so it
+    // all comes first: a block rejected here costs no proof verification.
+    for (size_t i = 0; i < pours.size(); i++) {
+        if (!this->isAnchor(merkleRoots[i])) {
+            return UNKNOWN_ANCHOR;
+        }
+    }
+
+    std::vector<Digest256> serials;
+    std::vector<Digest256> commitments;
+    serials.reserve(2 * pours.size());
+    commitments.reserve(mints.size() + 2 * pours.size());
+
+    for (const MintTransaction &mint : mints) {
+        const CoinCommitmentValue cm = mint.getMintedCoinCommitmentValue();
+        if (!mint.verify() || cm.size() != ZC_CM_SIZE) {
+            return INVALID_MINT;
+        }
+        commitments.push_back(Digest256(cm.data()));
+    }
+
+    for (const PourTransaction &pour : pours) {
+        // A version 0 pour has no proof to check, so it would pass whatever
+        // it spends and creates.
+        if (pour.getVersion() == 0) {
+            return INVALID_POUR;
+        }
+
+        const std::vector<unsigned char> sn_1 = pour.getSpentSerial1();
+        const std::vector<unsigned char> sn_2 = pour.getSpentSerial2();
+        const CoinCommitmentValue cm_1 = pour.getNewCoinCommitmentValue1();
+        const CoinCommitmentValue cm_2 = pour.getNewCoinCommitmentValue2();
+        if (sn_1.size() != ZC_SN_SIZE || sn_2.size() != ZC_SN_SIZE ||
+            cm_1.size() != ZC_CM_SIZE || cm_2.size() != ZC_CM_SIZE) {
+            return INVALID_POUR;
+        }
+        serials.push_back(Digest256(sn_1.data()));
+        serials.push_back(Digest256(sn_2.data()));
+        commitments.push_back(Digest256(cm_1.data()));
+        commitments.push_back(Digest256(cm_2.data()));
+    }
+
+    std::vector<Digest256> sorted(serials);
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+        return DOUBLE_SPEND;
+    }
+
+    std::vector<bool> spent;
+    if (this->spentSerials.containsBatch(serials, spent)) {
+        return DOUBLE_SPEND;
+    }
+
+    if (!this->tree.hasRoomFor(commitments.size())) {
+        return TREE_FULL;
+    }
+
+    // However this returns, the proofs of the block still waiting for a
+    // thread are dropped, so that a bad proof does not leave the rest of
+    // the block queued in front of the next one.
+    struct CancelOnExit {
+        std::shared_ptr<std::atomic<bool> > flag;
+        ~CancelOnExit() { *this->flag = true; }
+    } cancel = { std::make_shared<std::atomic<bool> >(false) };
+
+    std::vector<std::future<bool> > proofs;
+    proofs.reserve(pours.size());
+    for (size_t i = 0; i < pours.size(); i++) {
+        proofs.push_back(this->verifier.submit(pours[i], pubkeyHashes[i], merkleRoots[i], cancel.flag));
+    }
+
+    for (std::future<bool> &proof : proofs) {
+        if (!proof.get()) {
+            return INVALID_POUR;
+        }
+    }
+
+    // The serial numbers go first: inserting them either completes or
+    // throws without changing the set, and the tree is known to have room
+    // for the commitments.
+    std::vector<bool> inserted;
+    this->spentSerials.insertBatch(serials, inserted);
+    const bool appended = this->tree.appendBatch(commitments);
+    assert(appended);
+
+    Digest256 root;
+    this->tree.getRootValue(root);
+    this->anchors.insert(root);
+
+    return VALID;
+}
+
+const char* getBlockValidatorResultName(BlockValidator::Result result)
+{
+    switch (result) {
+    case BlockValidator::VALID:             return "valid";
+    case BlockValidator::INVALID_MINT:      return "invalid_mint";
+    case BlockValidator::UNKNOWN_ANCHOR:    return "unknown_anchor";
+    case BlockValidator::DOUBLE_SPEND:      return "double_spend";
+    case BlockValidator::INVALID_POUR:      return "invalid_pour";
+    case BlockValidator::TREE_FULL:         return "tree_full";
+    default:                                return "unknown";
+    }
+}
+
+} /* namespace libzerocash */
@@ -0,0 +1,103 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of interfaces for the class BlockValidator.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef BLOCKVALIDATOR_H_
+#define BLOCKVALIDATOR_H_
+
+#include <set>
+#include <vector>
+
+#include "IncrementalMerkleTree.h"
+#include "MintTransaction.h"
+#include "PourTransaction.h"
+#include "PourVerifier.h"
+#include "SerialNumberSet.h"
+#include "ZerocashParams.h"
+
+namespace libzerocash {
+
+/**
+ * Checks the mints and pours of a block against the chain state, and
+ * applies them to it if they are all valid: the serial numbers the pours
+ * spend go into the set of spent serial numbers, and the commitments of the
+ * minted and poured coins are appended to the commitment tree.
+ *
+ * A block is checked cheapest first: the anchors, the mints, the serial
+ * numbers and the room left in the tree, which take a few hashes and lookups
+ * on the calling thread, so that a block they reject costs no proof
+ * verification. The proofs are then verified in parallel by a PourVerifier,
+ * and once one fails the rest of the block's proofs are dropped. The state is
+ * only changed once every proof is known to be valid, in one batch update of
+ * the set and then one of the tree.
+ *
+ * The anchors that pours may use are the root of the tree when the validator
+ * is made, those of the tree after each block connected since, and any given
+ * to addAnchor. The tree and the set must outlive the validator, and are not
+ * to be changed by anything else while it is in use. Its PourVerifier turns
+ * off libsnark's profiling for good; see disableLibsnarkProfiling().
+ */
+class BlockValidator {
+public:
+    enum Result {
+        VALID = 0,
+        INVALID_MINT,           // a mint's commitment does not open to its value
+        UNKNOWN_ANCHOR,         // a pour is against a root the tree never had
+        DOUBLE_SPEND,           // a serial number is spent, or twice in the block
+        INVALID_POUR,           // a pour does not verify, or is of version 0
+        TREE_FULL               // the new commitments do not fit in the tree
+    };
+
+    /* num_threads is the number of threads verifying the proofs; 0 means one
+     * per hardware thread. */
+    BlockValidator(const ZerocashParams& params,
+                   IncrementalMerkleTree& tree,
+                   SerialNumberSet& spentSerials,
+                   unsigned int num_threads = 0);
+
+    BlockValidator(const BlockValidator&) = delete;
+    BlockValidator& operator=(const BlockValidator&) = delete;
+
+    /* Lets pours use root as their anchor, e.g. for a root the tree had
+     * before it was loaded. */
+    void addAnchor(const MerkleRootType& root);
+    bool isAnchor(const MerkleRootType& root) const;
+
+    /**
+     * Checks a block and, if it is valid, connects it. The new commitments
+     * are appended to the tree in block order: those of the mints, then
+     * those of the pours, two by two.
+     *
+     * Nothing is changed unless VALID is returned. If verifying a pour
+     * throws, the exception is passed on, also without changing anything.
+     *
+     * @param mints the mint transactions of the block.
+     * @param pours the pour transactions of the block.
+     * @param pubkeyHashes the public key hash bound to each pour.
+     * @param merkleRoots the anchor of each pour: the root of the tree the spent coins were in.
+     * @return VALID if the block was connected, otherwise the first reason found to reject it.
+     */
+    Result connectBlock(const std::vector<MintTransaction>& mints,
+                        const std::vector<PourTransaction>& pours,
+                        const std::vector<std::vector<unsigned char> >& pubkeyHashes,
+                        const std::vector<MerkleRootType>& merkleRoots);
+
+private:
+    IncrementalMerkleTree& tree;
+    SerialNumberSet& spentSerials;
+    PourVerifier verifier;
+    std::set<Digest256> anchors;
+};
+
+const char* getBlockValidatorResultName(BlockValidator::Result result);
+
+} /* namespace libzerocash */
+
+#endif /* BLOCKVALIDATOR_H_ */
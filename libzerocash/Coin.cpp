@@ -32,11 +32,15 @@ using CryptoPP::StringStore;
 
 namespace libzerocash {
 
-Coin::Coin(): addr_pk(), cm(), rho(ZC_RHO_SIZE), r(ZC_R_SIZE), coinValue(ZC_V_SIZE) {
+static_assert(Digest256::BYTES == ZC_RHO_SIZE && Digest256::BYTES == ZC_K_SIZE, "unexpected rho or k size");
+static_assert(Bits<384>::BYTES == ZC_R_SIZE, "unexpected r size");
+static_assert(Bits<64>::BYTES == ZC_V_SIZE, "unexpected value size");
+
+Coin::Coin(): addr_pk(), cm(), rho(), r(), coinValue() {
 
 }
 
-Coin::Coin(const std::string bucket, Address& addr): addr_pk(), cm(), rho(ZC_RHO_SIZE), r(ZC_R_SIZE), coinValue(ZC_V_SIZE) {
+Coin::Coin(const std::string bucket, Address& addr): addr_pk(), cm(), rho(), r(), coinValue() {
     // Retreive and decode the private key
     ECIES<ECP>::PrivateKey decodedPrivateKey;
     decodedPrivateKey.Load(StringStore(addr.getPrivateAddress().getEncryptionSecretKey()).Ref());
@@ -60,70 +64,40 @@ Coin::Coin(const std::string bucket, Address& addr): addr_pk(), cm(), rho(ZC_RHO
                     decrypt.CiphertextLength(ZC_V_SIZE + ZC_R_SIZE + ZC_RHO_SIZE),
                     &plaintext[0]);
 
-    // Grab the byte vectors
-    std::vector<unsigned char> value_v(plaintext.begin(),
-                                       plaintext.begin() + ZC_V_SIZE);
-    std::vector<unsigned char>     r_v(plaintext.begin() + ZC_V_SIZE,
-                                       plaintext.begin() + ZC_V_SIZE + ZC_R_SIZE);
-    std::vector<unsigned char>   rho_v(plaintext.begin() + ZC_V_SIZE + ZC_R_SIZE,
-                                       plaintext.begin() + ZC_V_SIZE + ZC_R_SIZE + ZC_RHO_SIZE);
-
-    this->coinValue = value_v;
-    this->r = r_v;
-    this->rho = rho_v;
+    // The plaintext is value || r || rho
+    this->coinValue = Bits<64>(&plaintext[0]);
+    this->r = Bits<384>(&plaintext[ZC_V_SIZE]);
+    this->rho = Digest256(&plaintext[ZC_V_SIZE + ZC_R_SIZE]);
     this->addr_pk = addr.getPublicAddress();
 
-    std::vector<unsigned char> a_pk = addr.getPublicAddress().getPublicAddressSecret();
-
-    this->computeCommitments(a_pk);
+    this->computeCommitments(addr.getPublicAddress().getPublicAddressSecret());
 }
 
-Coin::Coin(const PublicAddress& addr, uint64_t value): addr_pk(addr), cm(), rho(ZC_RHO_SIZE), r(ZC_R_SIZE), k(ZC_K_SIZE), coinValue(ZC_V_SIZE)
+Coin::Coin(const PublicAddress& addr, uint64_t value): addr_pk(addr), cm(), rho(), r(), k(), coinValue(Bits<64>::fromInt(value))
 {
-    convertIntToBytesVector(value, this->coinValue);
-
-    std::vector<unsigned char> a_pk = addr.getPublicAddressSecret();
-
-    unsigned char rho_bytes[ZC_RHO_SIZE];
-    getRandBytes(rho_bytes, ZC_RHO_SIZE);
-    convertBytesToBytesVector(rho_bytes, this->rho);
-
-    unsigned char r_bytes[ZC_R_SIZE];
-    getRandBytes(r_bytes, ZC_R_SIZE);
-    convertBytesToBytesVector(r_bytes, this->r);
+    getRandBytes(this->rho.data(), ZC_RHO_SIZE);
+    getRandBytes(this->r.data(), ZC_R_SIZE);
 
-	this->computeCommitments(a_pk);
+	this->computeCommitments(addr.getPublicAddressSecret());
 }
 
 
 Coin::Coin(const PublicAddress& addr, uint64_t value,
-		   const std::vector<unsigned char>& rho, const std::vector<unsigned char>& r): addr_pk(addr), rho(rho), r(r), k(ZC_K_SIZE), coinValue(ZC_V_SIZE)
+		   const std::vector<unsigned char>& rho, const std::vector<unsigned char>& r):
+    addr_pk(addr), rho(Digest256::fromBytesVector(rho)), r(Bits<384>::fromBytesVector(r)), k(), coinValue(Bits<64>::fromInt(value))
 {
-    convertIntToBytesVector(value, this->coinValue);
-
-    std::vector<unsigned char> a_pk = addr.getPublicAddressSecret();
-
-	this->computeCommitments(a_pk);
+	this->computeCommitments(addr.getPublicAddressSecret());
 }
 
 void
-Coin::computeCommitments(std::vector<unsigned char>& a_pk)
+Coin::computeCommitments(const Digest256& a_pk)
 {
-    std::vector<unsigned char> k_internal;
-    std::vector<unsigned char> k_internalhash_trunc(16);
-
-    std::vector<unsigned char> k_internalhash_internal;
-    concatenateVectors(a_pk, this->rho, k_internalhash_internal);
-
-    std::vector<unsigned char> k_internalhash(ZC_K_SIZE);
-    hashVector(k_internalhash_internal, k_internalhash);
-
-    copy(k_internalhash.begin(), k_internalhash.begin()+16, k_internalhash_trunc.begin());
-    concatenateVectors(this->r, k_internalhash_trunc, k_internal);
-    hashVector(k_internal, this->k);
+    // k = H(r || H(a_pk || rho)[0..128))
+    Digest256 k_internalhash = hashBlock(concatenate(a_pk, this->rho));
+    Bits<128> k_internalhash_trunc(k_internalhash.data());
+    this->k = hashBlock(concatenate(this->r, k_internalhash_trunc));
 
-    CoinCommitment com(this->coinValue, this->k);
-    this->cm = com;
+    this->cm = CoinCommitment(this->coinValue, this->k);
 }
 
 bool Coin::operator==(const Coin& rhs) const {
@@ -142,20 +116,20 @@ const CoinCommitment& Coin::getCoinCommitment() const {
 	return this->cm;
 }
 
-const std::vector<unsigned char>& Coin::getInternalCommitment() const {
+const Digest256& Coin::getInternalCommitment() const {
 	return this->k;
 }
 
-const std::vector<unsigned char>& Coin::getRho() const {
+const Digest256& Coin::getRho() const {
     return this->rho;
 }
 
-const std::vector<unsigned char>& Coin::getR() const {
+const Bits<384>& Coin::getR() const {
     return this->r;
 }
 
 uint64_t Coin::getValue() const {
-    return convertBytesVectorToInt(this->coinValue);
+    return this->coinValue.toInt();
 }
 
 } /* namespace libzerocash */
@@ -55,17 +55,17 @@ public:
 private:
 	PublicAddress addr_pk;
     CoinCommitment cm;
-	std::vector<unsigned char> rho;
-    std::vector<unsigned char> r;
-	std::vector<unsigned char> k;
-	std::vector<unsigned char> coinValue;
+	Digest256 rho;          // ZC_RHO_SIZE bytes
+    Bits<384> r;            // ZC_R_SIZE bytes
+	Digest256 k;            // ZC_K_SIZE bytes
+	Bits<64> coinValue;     // ZC_V_SIZE bytes
 
-	const std::vector<unsigned char>& getInternalCommitment() const;
+	const Digest256& getInternalCommitment() const;
 
-    const std::vector<unsigned char>& getRho() const;
+    const Digest256& getRho() const;
 
-    const std::vector<unsigned char>& getR() const;
-    void computeCommitments(std::vector<unsigned char>& a_pk);
+    const Bits<384>& getR() const;
+    void computeCommitments(const Digest256& a_pk);
 };
 
 } /* namespace libzerocash */
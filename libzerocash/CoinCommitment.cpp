@@ -19,28 +19,37 @@
 
 namespace libzerocash {
 
-CoinCommitment::CoinCommitment() : commitmentValue(ZC_CM_SIZE)
+CoinCommitment::CoinCommitment() : commitmentValue()
+{ }
+
+CoinCommitment::CoinCommitment(const Bits<64>& val, const Digest256& k)
+    : commitmentValue(hashBlock(concatenate(concatenate(k, Bits<192>()), val)))
 { }
 
 CoinCommitment::CoinCommitment(const std::vector<unsigned char>& val,
-                               const std::vector<unsigned char>& k) : commitmentValue(ZC_CM_SIZE)
+                               const std::vector<unsigned char>& k) : commitmentValue()
 {
+	if (val.size() > ZC_V_SIZE || k.size() > ZC_K_SIZE) {
+		throw std::runtime_error("CoinCommitment: inputs are too large");
+	}
+
+    if (val.size() == ZC_V_SIZE && k.size() == ZC_K_SIZE) {
+        *this = CoinCommitment(Bits<64>::fromBytesVector(val), Digest256::fromBytesVector(k));
+        return;
+    }
+
 	std::vector<bool> zeros_192(192, 0);
     std::vector<bool> cm_internal;
     std::vector<bool> value_bool(ZC_V_SIZE * 8, 0);
     std::vector<bool> k_bool(ZC_K_SIZE * 8, 0);
 
-	if (val.size() > ZC_V_SIZE || k.size() > ZC_K_SIZE) {
-		throw std::runtime_error("CoinCommitment: inputs are too large");
-	}
-
     libzerocash::convertBytesVectorToVector(val, value_bool);
     libzerocash::convertBytesVectorToVector(k, k_bool);
 
     libzerocash::concatenateVectors(k_bool, zeros_192, value_bool, cm_internal);
     std::vector<bool> cm_bool(ZC_CM_SIZE * 8);
     libzerocash::hashVector(cm_internal, cm_bool);
-    libzerocash::convertVectorToBytesVector(cm_bool, this->commitmentValue);
+    this->commitmentValue = Digest256::fromBitVector(cm_bool);
 }
 
 bool CoinCommitment::operator==(const CoinCommitment& rhs) const {
@@ -51,7 +60,11 @@ bool CoinCommitment::operator!=(const CoinCommitment& rhs) const {
 	return !(*this == rhs);
 }
 
-const std::vector<unsigned char>& CoinCommitment::getCommitmentValue() const {
+std::vector<unsigned char> CoinCommitment::getCommitmentValue() const {
+    return this->commitmentValue.toBytesVector();
+}
+
+const Digest256& CoinCommitment::getCommitmentDigest() const {
     return this->commitmentValue;
 }
 
@@ -14,6 +14,8 @@
 
 #include <vector>
 
+#include "utils/Bits.h"
+
 namespace libzerocash {
 
 /****************************** Coin commitment ******************************/
@@ -21,6 +23,7 @@ namespace libzerocash {
 class CoinCommitment {
 
 friend class PourTransaction;
+friend class MintTransaction;
 
 public:
 	CoinCommitment();
@@ -28,14 +31,18 @@ public:
 	CoinCommitment(const std::vector<unsigned char>& val,
                    const std::vector<unsigned char>& k);
 
-    const std::vector<unsigned char>& getCommitmentValue() const;
+	/* cm = H(k || 0^192 || v) */
+	CoinCommitment(const Bits<64>& val, const Digest256& k);
+
+    std::vector<unsigned char> getCommitmentValue() const;
+    const Digest256& getCommitmentDigest() const;
 
 	bool operator==(const CoinCommitment& rhs) const;
 	bool operator!=(const CoinCommitment& rhs) const;
 
 
 private:
-    std::vector<unsigned char> commitmentValue;
+    Digest256 commitmentValue;
 };
 
 } /* namespace libzerocash */
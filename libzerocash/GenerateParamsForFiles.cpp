@@ -10,6 +10,8 @@
  *****************************************************************************/
 
 #include <fstream>
+#include <iomanip>
+#include <iostream>
 
 #include "Zerocash.h"
 #include "ZerocashParams.h"
@@ -20,6 +22,15 @@
 
 using namespace libzerocash;
 
+static void printDigest(const std::vector<unsigned char>& digest, const std::string& path)
+{
+    /* Same format as sha256sum. */
+    for (unsigned char c : digest) {
+        std::cout << std::hex << std::setw(2) << std::setfill('0') << (int) c;
+    }
+    std::cout << std::dec << "  " << path << std::endl;
+}
+
 int main(int argc, char **argv)
 {
     if(argc != 4) {
@@ -34,11 +45,16 @@ int main(int argc, char **argv)
     auto keypair = libzerocash::ZerocashParams::GenerateNewKeyPair(tree_depth);
     libzerocash::ZerocashParams p(
         tree_depth,
-        &keypair
+        std::move(keypair)
     );
 
-    libzerocash::ZerocashParams::SaveProvingKeyToFile(&p.getProvingKey(), pkFile);
-    libzerocash::ZerocashParams::SaveVerificationKeyToFile(&p.getVerificationKey(), vkFile);
+    std::vector<unsigned char> pkDigest;
+    std::vector<unsigned char> vkDigest;
+    libzerocash::ZerocashParams::SaveProvingKeyToFile(&p.getProvingKey(), pkFile, &pkDigest);
+    libzerocash::ZerocashParams::SaveVerificationKeyToFile(&p.getVerificationKey(), vkFile, &vkDigest);
+
+    printDigest(pkDigest, pkFile);
+    printDigest(vkDigest, vkFile);
 
     return 0;
 }
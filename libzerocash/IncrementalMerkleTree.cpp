@@ -2,7 +2,7 @@
  *****************************************************************************
 
  Implementation of interfaces for the classes IncrementalMerkleTreeCompact,
- IncrementalMerkleNode, and IncrementalMerkleTree.
+ IncrementalWitness and IncrementalMerkleTree.
 
  See IncrementalMerkleTree.h .
 
@@ -15,26 +15,160 @@
 #include "IncrementalMerkleTree.h"
 #include "Zerocash.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <iostream>
 #include <vector>
 
 namespace libzerocash {
 
+    // The digest of an empty subtree (and of a pair of empty subtrees).
+    static const unsigned char zeroDigest[SHA256_BLOCK_SIZE] = { 0 };
+
+    static bool
+    digestIsZero(const unsigned char* digest)
+    {
+        return (memcmp(digest, zeroDigest, SHA256_BLOCK_SIZE) == 0);
+    }
+
+    // Nodes with nothing below them are returned by getNode as zeroDigest
+    // itself, so along the sparse right edge of a deep tree the digest need
+    // not be scanned.
+    static bool
+    nodeIsEmpty(const unsigned char* digest)
+    {
+        return (digest == zeroDigest) || digestIsZero(digest);
+    }
+
+    // Shifts that are allowed to reach (or exceed) the width of the word,
+    // which happens for the upper levels of a 64-high tree.
+    static uint64_t
+    shiftRight(uint64_t value, uint32_t bits)
+    {
+        return (bits >= 64) ? 0 : (value >> bits);
+    }
+
+    // The parent of two nodes, with the same convention as hashNode.
+    static Digest256
+    combine(const Digest256 &left, const Digest256 &right)
+    {
+        if (left.isZero() && right.isZero()) {
+            return Digest256();
+        }
+
+        return hashBlock(concatenate(left, right));
+    }
+
+    /////////////////////////////////////////////
+    // IncrementalWitness class
+    /////////////////////////////////////////////
+
+    bool
+    IncrementalWitness::append(const Digest256 &newLeaf)
+    {
+        // Check that the tree has a free leaf.
+        if (this->path.empty() ||
+            (this->treeHeight < 64 && this->numLeaves >= (((uint64_t) 1) << this->treeHeight))) {
+            return false;
+        }
+
+        // The new leaf lies in the sibling subtree of the given height: the
+        // highest bit in which its position differs from ours.
+        uint64_t newPosition = this->numLeaves++;
+        uint32_t height = 63 - __builtin_clzll(newPosition ^ this->position);
+        uint64_t count = newPosition & ((((uint64_t) 1) << height) - 1);
+
+        // Add the leaf to the frontier of that subtree, folding in the full
+        // nodes it completes.
+        Digest256 carry = newLeaf;
+        uint32_t k = 0;
+        for (; (count >> k) & 1; k++) {
+            carry = combine(this->frontier[k], carry);
+        }
+
+        if (k == height) {
+            this->path[height] = carry;
+            return true;
+        }
+        this->frontier[k] = carry;
+
+        // The sibling is only partly filled: rehash its right edge.
+        count++;
+        Digest256 node;
+        for (k = 0; k < height; k++) {
+            if ((count >> k) & 1) {
+                node = combine(this->frontier[k], node);
+            } else {
+                node = combine(node, Digest256());
+            }
+        }
+        this->path[height] = node;
+
+        return true;
+    }
+
+    bool
+    IncrementalWitness::append(const std::vector<bool> &hashV)
+    {
+        // Check that the value is a digest.
+        if (hashV.size() != SHA256_BLOCK_SIZE * 8) {
+            return false;
+        }
+
+        return this->append(Digest256::fromBitVector(hashV));
+    }
+
+    void
+    IncrementalWitness::getWitness(merkle_authentication_path &witness) const
+    {
+        witness.resize(this->treeHeight);
+        for (uint32_t depth = 0; depth < this->treeHeight; depth++) {
+            witness.at(depth).resize(SHA256_BLOCK_SIZE * 8);
+            convertBytesToVector(this->path[this->treeHeight - depth - 1].data(), witness.at(depth));
+        }
+    }
+
+    bool
+    IncrementalWitness::getRootValue(Digest256& r) const
+    {
+        Digest256 node = this->leaf;
+        for (uint32_t height = 0; height < this->treeHeight; height++) {
+            if ((this->position >> height) & 1) {
+                node = combine(this->path[height], node);
+            } else {
+                node = combine(node, this->path[height]);
+            }
+        }
+
+        r = node;
+        return true;
+    }
+
+    bool
+    IncrementalWitness::getRootValue(std::vector<bool>& r) const
+    {
+        Digest256 root;
+        this->getRootValue(root);
+        r.resize(SHA256_BLOCK_SIZE * 8);
+        convertBytesToVector(root.data(), r);
+        return true;
+    }
+
     /////////////////////////////////////////////
     // IncrementalMerkleTree class
     /////////////////////////////////////////////
 
     // Custom tree constructor (initialize tree of specified height)
-    IncrementalMerkleTree::IncrementalMerkleTree(uint32_t height) : root(0, height) {
-        treeHeight = height;
+    IncrementalMerkleTree::IncrementalMerkleTree(uint32_t height) : treeHeight(height) {
+        this->reset();
     }
 
     // Vector constructor. Initializes and inserts a list of elements.
-    IncrementalMerkleTree::IncrementalMerkleTree(std::vector< std::vector<bool> > &valueVector, uint32_t height) : root(0, height)
+    IncrementalMerkleTree::IncrementalMerkleTree(std::vector< std::vector<bool> > &valueVector, uint32_t height) : treeHeight(height)
     {
         // Initialize the tree
-        treeHeight = height;
+        this->reset();
 
         // Load the tree with all the given values
         if (this->insertVector(valueVector) == false) {
@@ -44,12 +178,12 @@ namespace libzerocash {
 
     // Custom tree constructor (initialize tree from compact representation)
     //
-    IncrementalMerkleTree::IncrementalMerkleTree(IncrementalMerkleTreeCompact &compact) : root(0, 0)
+    IncrementalMerkleTree::IncrementalMerkleTree(IncrementalMerkleTreeCompact &compact) : treeHeight(0)
 	{
 
 		// Initialize the tree
 		this->treeHeight = compact.getHeight();
-		root.treeHeight = treeHeight;
+		this->reset();
 
 		// Make sure we convert from the integer vector to the bool vector
 		libzerocash::convertBytesVectorToVector(compact.hashListBytes, compact.hashList);
@@ -65,484 +199,505 @@ namespace libzerocash {
         this->fromCompactRepresentation(compact);
     }
 
-    bool
-    IncrementalMerkleTree::insertElement(const std::vector<bool> &hashV, std::vector<bool> &index) {
-
-        // Resize the index vector
-        index.resize(this->treeHeight);
-
-        // Insert the element
-        return this->root.insertElement(hashV, index);
+    void
+    IncrementalMerkleTree::reset()
+    {
+        this->numLeaves = 0;
+        this->levels.assign(this->treeHeight + 1, std::vector<unsigned char>());
+        this->levelOffset.assign(this->treeHeight + 1, 0);
     }
 
-	bool
-    IncrementalMerkleTree::insertElement(const std::vector<unsigned char> &hashV, std::vector<unsigned char> &index) {
+    // Number of nodes at the given depth that have at least one leaf below them.
+    uint64_t
+    IncrementalMerkleTree::nodesAtDepth(uint32_t depth) const
+    {
+        uint32_t shift = this->treeHeight - depth;
 
-		// Create a temporary vector to hold hashV
-		std::vector<bool> hashVBool(hashV.size() * 8);
-		convertBytesVectorToVector(hashV, hashVBool);
+        if (shift >= 64) {
+            return (this->numLeaves > 0) ? 1 : 0;
+        }
 
-        // Create a temporary vector to hold the index
-		std::vector<bool> indexBool(this->treeHeight, 0);
+        uint64_t mask = (((uint64_t) 1) << shift) - 1;
+        return (this->numLeaves >> shift) + ((this->numLeaves & mask) ? 1 : 0);
+    }
 
-        // Insert the element
-        bool result = this->insertElement(hashVBool, indexBool);
+    // Returns the digest of a node, the zero digest if nothing has been
+    // inserted below it, or NULL if it has been pruned away.
+    const unsigned char*
+    IncrementalMerkleTree::getNode(uint32_t depth, uint64_t index) const
+    {
+        if (index >= this->nodesAtDepth(depth)) {
+            return zeroDigest;
+        }
 
-		// Convert the returned vector
-		index.resize(index.size() / 8); // this might need to include a ceil
-		convertVectorToBytesVector(indexBool, index);
+        if (index < this->levelOffset.at(depth)) {
+            return NULL;
+        }
 
-		return result;
+        return &this->levels.at(depth)[(index - this->levelOffset[depth]) * SHA256_BLOCK_SIZE];
     }
 
-    bool
-    IncrementalMerkleTree::getWitness(const std::vector<bool> &index, merkle_authentication_path &witness) {
+    void
+    IncrementalMerkleTree::setNode(uint32_t depth, uint64_t index, const unsigned char* digest)
+    {
+        std::vector<unsigned char> &level = this->levels.at(depth);
+        uint64_t stored = level.size() / SHA256_BLOCK_SIZE;
 
-		// Resize the witness if necessary
-		if (witness.size() < this->treeHeight) {
-			witness.resize(treeHeight);
-		}
+        assert(index >= this->levelOffset[depth]);
+        assert(index <= this->levelOffset[depth] + stored);
 
-		std::vector<bool> indexPadded = index;
+        if (index == this->levelOffset[depth] + stored) {
+            level.insert(level.end(), digest, digest + SHA256_BLOCK_SIZE);
+        } else {
+            memcpy(&level[(index - this->levelOffset[depth]) * SHA256_BLOCK_SIZE], digest, SHA256_BLOCK_SIZE);
+        }
+    }
 
-		// Discard leading bits of the index if necessary
-		if (indexPadded.size() > this->treeHeight) {
-			indexPadded.erase(indexPadded.begin(), indexPadded.begin() + (indexPadded.size() - this->treeHeight));
-		}
+    // Recompute an internal node from its two children. The "hash" of two
+    // zero digests is defined to be the zero digest.
+    void
+    IncrementalMerkleTree::hashNode(uint32_t depth, uint64_t index)
+    {
+        const unsigned char* left = this->getNode(depth + 1, 2 * index);
+        const unsigned char* right = this->getNode(depth + 1, 2 * index + 1);
+        assert(left != NULL && right != NULL);
 
-		// If the index vector is less than 'treeHeight' bits, pad the leftmost bits with 0 (false)
-		// This is to deal with the situation where somebody encodes e.g., a 32-bit integer as an index
-		// into a 64 height tree and does not explicitly pad to length.
-		if (indexPadded.size() < this->treeHeight) {
-			indexPadded.insert(indexPadded.begin(), (this->treeHeight - 1) - indexPadded.size(), false);
-		}
+        if (nodeIsEmpty(left) && nodeIsEmpty(right)) {
+            this->setNode(depth, index, zeroDigest);
+            return;
+        }
 
-        return this->root.getWitness(indexPadded, witness);
+        unsigned char block[2 * SHA256_BLOCK_SIZE];
+        unsigned char hash[SHA256_BLOCK_SIZE];
+        memcpy(block, left, SHA256_BLOCK_SIZE);
+        memcpy(block + SHA256_BLOCK_SIZE, right, SHA256_BLOCK_SIZE);
+        sha256_compress_block(block, hash);
+
+        this->setNode(depth, index, hash);
     }
 
-    bool
-    IncrementalMerkleTree::insertVector(std::vector< std::vector<bool> > &valueVector)
+    // Recompute up to eight consecutive nodes of a level starting at index.
+    // The nodes that are not the parent of two zero digests are hashed
+    // together with the multi-block SHA-256 kernel.
+    void
+    IncrementalMerkleTree::hashNodes(uint32_t depth, uint64_t index, uint32_t count)
     {
-        std::vector<bool> index;
+        unsigned char blocks[8][2 * SHA256_BLOCK_SIZE];
+        unsigned char hashes[8][SHA256_BLOCK_SIZE];
+        uint64_t targets[8];
+        uint32_t pending = 0;
+
+        assert(count <= 8);
+
+        for (uint32_t i = 0; i < count; i++) {
+            const unsigned char* left = this->getNode(depth + 1, 2 * (index + i));
+            const unsigned char* right = this->getNode(depth + 1, 2 * (index + i) + 1);
+            assert(left != NULL && right != NULL);
 
-        for (std::vector< std::vector<bool> >::iterator iter = valueVector.begin();
-             iter != valueVector.end(); ++iter) {
+            if (nodeIsEmpty(left) && nodeIsEmpty(right)) {
+                this->setNode(depth, index + i, zeroDigest);
+                continue;
+            }
 
-            if (this->insertElement(*iter, index) == false) {
-				return false;
-			}
+            memcpy(blocks[pending], left, SHA256_BLOCK_SIZE);
+            memcpy(blocks[pending] + SHA256_BLOCK_SIZE, right, SHA256_BLOCK_SIZE);
+            targets[pending++] = index + i;
+        }
 
+        if (pending == 0) {
+            return;
+        } else if (pending == 1) {
+            sha256_compress_block(blocks[0], hashes[0]);
+        } else if (pending <= 4) {
+            sha256_compress_x4(blocks, hashes);
+        } else {
+            sha256_compress_x8(blocks, hashes);
         }
 
-        return true;
+        for (uint32_t i = 0; i < pending; i++) {
+            this->setNode(depth, targets[i], hashes[i]);
+        }
     }
 
-    bool
-    IncrementalMerkleTree::getRootValue(std::vector<bool>& r) {
+    // Recompute every ancestor of the given leaf, bottom-up.
+    void
+    IncrementalMerkleTree::updatePath(uint64_t leafIndex)
+    {
+        for (uint32_t depth = this->treeHeight; depth-- > 0; ) {
+            this->hashNode(depth, shiftRight(leafIndex, this->treeHeight - depth));
+        }
+    }
 
-        // Query the root for its hash
-        this->root.getValue(r);
-        return true;
+    // Recompute every ancestor of the leaves in [firstLeaf, lastLeaf], one
+    // level at a time so that shared ancestors are only hashed once. Nodes
+    // are hashed in groups of eight to feed the multi-block SHA-256 kernel.
+    //
+    // The nodes of a level only depend on the level below, so with MULTICORE
+    // each level is hashed in parallel. Storage for the whole level is
+    // allocated up front so that the workers only ever overwrite nodes.
+    void
+    IncrementalMerkleTree::updateRange(uint64_t firstLeaf, uint64_t lastLeaf)
+    {
+        for (uint32_t depth = this->treeHeight; depth-- > 0; ) {
+            firstLeaf >>= 1;
+            lastLeaf >>= 1;
+
+            std::vector<unsigned char> &level = this->levels[depth];
+            uint64_t needed = (lastLeaf + 1 - this->levelOffset[depth]) * SHA256_BLOCK_SIZE;
+            if (level.size() < needed) {
+                level.resize(needed);
+            }
+
+            const uint64_t count = lastLeaf - firstLeaf + 1;
+            const int64_t groups = (count + 7) / 8;
+#ifdef MULTICORE
+            #pragma omp parallel for if (groups >= 8)
+#endif
+            for (int64_t g = 0; g < groups; g++) {
+                uint64_t first = firstLeaf + 8 * g;
+                this->hashNodes(depth, first, (uint32_t) std::min<uint64_t>(8, lastLeaf + 1 - first));
+            }
+        }
     }
 
-	bool
-    IncrementalMerkleTree::getRootValue(std::vector<unsigned char>& r) {
+    bool
+    IncrementalMerkleTree::insertElement(const Digest256 &leaf, std::vector<bool> &index) {
 
-		// Create a temporary byte vector
-		std::vector<bool> tempR(r.size() * 8, 0);
+        // Check that the tree has a free leaf.
+        if (this->treeHeight < 64 && this->numLeaves >= (((uint64_t) 1) << this->treeHeight)) {
+            return false;
+        }
 
-        // Query the root for its hash
-        this->root.getValue(tempR);
+        uint64_t position = this->numLeaves;
 
-		// Convert the result back into the given vector
-		convertVectorToBytesVector(tempR, r);
+        // Store the leaf and rehash its path to the root.
+        this->numLeaves++;
+        this->setNode(this->treeHeight, position, leaf.data());
+        this->updatePath(position);
+
+        // Report where the new element went, most significant bit first.
+        index.resize(this->treeHeight);
+        for (uint32_t i = 0; i < this->treeHeight; i++) {
+            index.at(i) = (shiftRight(position, this->treeHeight - 1 - i) & 1);
+        }
 
         return true;
     }
-	std::vector<unsigned char>
-	IncrementalMerkleTree::getRoot(){
-		std::vector<unsigned char> temp(8);
-		this->getRootValue(temp);
-		return temp;
-	}
 
     bool
-    IncrementalMerkleTree::prune()
-    {
-		return this->root.prune();
+    IncrementalMerkleTree::insertElement(const std::vector<bool> &hashV, std::vector<bool> &index) {
+
+        // Check that the value is a digest.
+        if (hashV.size() != SHA256_BLOCK_SIZE * 8) {
+            return false;
+        }
+
+        return this->insertElement(Digest256::fromBitVector(hashV), index);
     }
 
-    IncrementalMerkleTreeCompact
-    IncrementalMerkleTree::getCompactRepresentation()
-    {
-        IncrementalMerkleTreeCompact rep;
-        rep.hashList.resize(this->treeHeight);
-		rep.treeHeight = this->treeHeight;
-        std::fill (rep.hashList.begin(), rep.hashList.end(), false);
+	bool
+    IncrementalMerkleTree::insertElement(const std::vector<unsigned char> &hashV, std::vector<unsigned char> &index) {
 
-		this->root.getCompactRepresentation(rep);
+        // Create a temporary vector to hold the index
+		std::vector<bool> indexBool(this->treeHeight, 0);
 
-		// Convert the hashList into a bytesVector. First pad it to a multiple of 8 bits.
-		if (rep.hashList.size() % 8 != 0) {
-			rep.hashList.insert(rep.hashList.begin(), 8 - (rep.hashList.size() % 8), false);
-		}
-		rep.hashListBytes.resize(ceil(rep.hashList.size() / 8.0));
-		convertVectorToBytesVector(rep.hashList, rep.hashListBytes);
+        // Insert the element, which must be a digest
+        bool result = (hashV.size() == SHA256_BLOCK_SIZE) &&
+                      this->insertElement(Digest256(&hashV[0]), indexBool);
 
-        return rep;
+		// Convert the returned vector
+		index.resize(index.size() / 8); // this might need to include a ceil
+		convertVectorToBytesVector(indexBool, index);
+
+		return result;
     }
 
     bool
-    IncrementalMerkleTree::fromCompactRepresentation(IncrementalMerkleTreeCompact &rep)
-    {
-		return this->root.fromCompactRepresentation(rep, 0);
-	}
-
-    /////////////////////////////////////////////
-    // IncrementalMerkleNode class
-    /////////////////////////////////////////////
+    IncrementalMerkleTree::getWitness(const std::vector<bool> &index, merkle_authentication_path &witness) {
 
-    // Standard constructor
-    //
-    IncrementalMerkleNode::IncrementalMerkleNode(uint32_t depth, uint32_t height) : left(NULL), right(NULL), value(SHA256_BLOCK_SIZE * 8, 0), nodeDepth(depth), treeHeight(height),
-				subtreeFull(false), subtreePruned(false)
-    {
-        sha256_init(&ctx256);
-    }
+		// Resize the witness if necessary
+		if (witness.size() < this->treeHeight) {
+			witness.resize(treeHeight);
+		}
 
-    // Copy constructor
-    //
-    IncrementalMerkleNode::IncrementalMerkleNode(const IncrementalMerkleNode& toCopy) : left(NULL), right(NULL), value(SHA256_BLOCK_SIZE * 8, 0)
-    {
-        sha256_init(&ctx256);
-        this->nodeDepth = toCopy.nodeDepth;
-        this->subtreePruned = toCopy.subtreePruned;
-        this->subtreeFull = toCopy.subtreeFull;
-        this->value = toCopy.value;
-		this->treeHeight = toCopy.treeHeight;
+		// Read the position from the last treeHeight bits of the index. Any
+		// leading bits beyond that are discarded, and a shorter index is
+		// taken to be padded on the left with 0 (false). This is to deal with
+		// the situation where somebody encodes e.g., a 32-bit integer as an
+		// index into a 64 height tree and does not explicitly pad to length.
+		size_t skip = (index.size() > this->treeHeight) ? index.size() - this->treeHeight : 0;
 
-        // Recursively copy the subtrees
-        if (toCopy.left) {
-			this->left = new IncrementalMerkleNode(toCopy.left->nodeDepth, toCopy.left->treeHeight);
-            *(this->left) = *(toCopy.left);
+        uint64_t position = 0;
+        for (size_t i = skip; i < index.size(); i++) {
+            position = (position << 1) | (index[i] ? 1 : 0);
         }
 
-        if (toCopy.right) {
-			this->right = new IncrementalMerkleNode(toCopy.right->nodeDepth, toCopy.right->treeHeight);
-            *(this->right) = *(toCopy.right);
+        // We can only authenticate leaves that have been inserted.
+        if (position >= this->numLeaves) {
+            return false;
         }
-    }
 
-    IncrementalMerkleNode::~IncrementalMerkleNode()
-    {
-        if (this->left) {
-            delete this->left;
-            this->left = NULL;
-        }
+        // witness[depth] is the sibling of the path node one level below
+        // 'depth'. If any of those siblings was pruned, the path went through
+        // a full subtree that has since been discarded.
+        for (uint32_t depth = 0; depth < this->treeHeight; depth++) {
+            uint64_t pathNode = shiftRight(position, this->treeHeight - depth - 1);
+            const unsigned char* sibling = this->getNode(depth + 1, pathNode ^ 1);
+            if (sibling == NULL) {
+                return false;
+            }
 
-        if (this->right) {
-            delete this->right;
-            this->right = NULL;
+            witness.at(depth).resize(SHA256_BLOCK_SIZE * 8);
+            convertBytesToVector(sibling, witness.at(depth));
         }
+
+        return true;
     }
 
     bool
-    IncrementalMerkleNode::insertElement(const std::vector<bool> &hashV, std::vector<bool> &index)
+    IncrementalMerkleTree::getIncrementalWitness(IncrementalWitness &witness)
     {
-        bool result = false;
-
-        // Check if we have any free leaves. If not, bail.
-        if (this->subtreeFull == true) {
+        if (this->numLeaves == 0) {
             return false;
         }
 
-        // Are we a leaf? If so, store the hash value.
-        if (this->isLeaf()) {
-            // Store the given hash value here and return success.
-            this->value = hashV;
-            this->subtreeFull = true;
-            return true;
-        }
+        IncrementalWitness result;
+        result.treeHeight = this->treeHeight;
+        result.position = this->numLeaves - 1;
+        result.numLeaves = this->numLeaves;
+        result.path.resize(this->treeHeight);
+        result.frontier.resize(this->treeHeight);
 
-        // We're not a leaf. Try to insert into subtrees, creating them if necessary.
-        // Try to recurse on left subtree
-        if (!this->left) {
-            this->left = new IncrementalMerkleNode(this->nodeDepth + 1, this->treeHeight);
-        }
-        result = this->left->insertElement(hashV, index);
-        if (result == true) {
-            // Update the index value to indicate where the new node went
-            index.at(this->nodeDepth) = false;
+        const unsigned char* leaf = this->getNode(this->treeHeight, result.position);
+        if (leaf == NULL) {
+            return false;
         }
-
-        // If that failed, try to recurse on right subtree.
-        if (result == false) {
-            if (!this->right) {
-                this->right = new IncrementalMerkleNode(this->nodeDepth + 1, this->treeHeight);
-            }
-            result = this->right->insertElement(hashV, index);
-            if (result == true) {
-                index.at(this->nodeDepth) = true;
+        result.leaf = Digest256(leaf);
+
+        // The siblings to the left of the path are full; those to the right
+        // are still empty.
+        for (uint32_t height = 0; height < this->treeHeight; height++) {
+            const unsigned char* sibling = this->getNode(this->treeHeight - height, shiftRight(result.position, height) ^ 1);
+            if (sibling == NULL) {
+                return false;
             }
+            result.path[height] = Digest256(sibling);
         }
 
-        // If one of the inserts succeeded, update our 'fullness' status.
-        if (result == true) {
-            this->updateHashValue();
-            if (this->isLeaf()) { this->subtreeFull = true; }
-            else {
-                this->subtreeFull = this->checkIfNodeFull();
-            }
-        }
-
-        // Return the result
-        return result;
+        witness = result;
+        return true;
     }
 
     bool
-    IncrementalMerkleNode::getWitness(const std::vector<bool> &index, merkle_authentication_path &witness)
+    IncrementalMerkleTree::insertVector(std::vector< std::vector<bool> > &valueVector)
     {
-        bool result = false;
-
-        // If this node is a leaf: do nothing and return success
-        if (this->isLeaf()) {
-            return true;
-        }
+        return this->appendBatch(valueVector);
+    }
 
-		// If this node is pruned, we can't fetch a witness. Return failure.
-		if (this->isPruned()) {
-			return false;
-		}
+    bool
+    IncrementalMerkleTree::appendBatch(const std::vector< std::vector<bool> > &valueVector)
+    {
+        std::vector<Digest256> leaves(valueVector.size());
 
-        // If the index path leads to the left, we grab the hash value on the
-        // right -- then recurse on the left node.
-        if (index.at(nodeDepth) == false) {
-
-			// Make sure there is a value on the right. If not we put the 'null' hash (0) into that element.
-			if (this->right == NULL) {
-				witness.at(nodeDepth).resize(SHA256_BLOCK_SIZE * 8);
-				std::fill (witness.at(nodeDepth).begin(), witness.at(nodeDepth).end(), false);
-			} else {
-				this->right->getValue(witness.at(nodeDepth));
-				printVectorAsHex(witness.at(nodeDepth));
-			}
-
-            // Recurse on the left node
-            if (this->left) {
-                result = this->left->getWitness(index, witness);
+        for (size_t i = 0; i < valueVector.size(); i++) {
+            if (valueVector[i].size() != SHA256_BLOCK_SIZE * 8) {
+                return false;
             }
+
+            leaves[i] = Digest256::fromBitVector(valueVector[i]);
         }
 
-        // If the index path leads to the right, we grab the hash value on the
-        // left -- then recurse on the right node.
-        if (index.at(nodeDepth) == true) {
-            this->left->getValue(witness.at(nodeDepth));
+        return this->appendBatch(leaves);
+    }
+
+    bool
+    IncrementalMerkleTree::appendBatch(const std::vector< std::vector<unsigned char> > &valueVector)
+    {
+        std::vector<Digest256> leaves(valueVector.size());
 
-            // Recurse on the right node
-            if (this->right) {
-                result = this->right->getWitness(index, witness);
+        for (size_t i = 0; i < valueVector.size(); i++) {
+            if (valueVector[i].size() != SHA256_BLOCK_SIZE) {
+                return false;
             }
+
+            leaves[i] = Digest256(&valueVector[i][0]);
         }
 
-        return result;
+        return this->appendBatch(leaves);
     }
 
     bool
-    IncrementalMerkleNode::prune()
+    IncrementalMerkleTree::hasRoomFor(uint64_t count) const
     {
-        bool result = true;
+        return this->treeHeight >= 64 || count <= (((uint64_t) 1) << this->treeHeight) - this->numLeaves;
+    }
 
-        // If we're already pruned, return.
-        if (this->isPruned() == true) {
+    bool
+    IncrementalMerkleTree::appendBatch(const std::vector<Digest256> &leaves)
+    {
+        if (leaves.empty()) {
             return true;
         }
 
-        // Check to see if this node is full. If so, delete the subtrees.
-        if (this->subtreeFull == true) {
-            if (this->left) {
-                delete this->left;
-                this->left = NULL;
-            }
+        // Make sure the whole batch fits before touching the tree.
+        uint64_t count = leaves.size();
+        if (!this->hasRoomFor(count)) {
+            return false;
+        }
 
-            if (this->right) {
-                delete this->right;
-                this->right = NULL;
-            }
+        // Place all the leaves first, then rehash the affected nodes.
+        uint64_t first = this->numLeaves;
+        this->levels[this->treeHeight].reserve(this->levels[this->treeHeight].size() + count * SHA256_BLOCK_SIZE);
+        this->numLeaves += count;
+        for (uint64_t i = 0; i < count; i++) {
+            this->setNode(this->treeHeight, first + i, leaves[i].data());
+        }
 
-            this->subtreePruned = true;
-        } else {
-            // Node is not full. Recurse on left and right.
-            if (this->left) {
-                result &= this->left->prune();
-            }
+        this->updateRange(first, first + count - 1);
 
-            if (this->right) {
-                result &= this->right->prune();
-            }
-        }
+        return true;
+    }
 
-        return result;
+    bool
+    IncrementalMerkleTree::getRootValue(std::vector<bool>& r) {
+
+        // Query the root for its hash
+        r.resize(SHA256_BLOCK_SIZE * 8);
+        convertBytesToVector(this->getNode(0, 0), r);
+        return true;
     }
 
-    void
-    IncrementalMerkleNode::updateHashValue()
-    {
-        // Take no action on leaves or pruned nodes.
-        if (this->isLeaf() || this->isPruned()) {
-            return;
-        }
+	bool
+    IncrementalMerkleTree::getRootValue(std::vector<unsigned char>& r) {
 
-        // Obtain the hash of the two subtrees and hash the
-        // concatenation of the two.
-        std::vector<bool> hash(SHA256_BLOCK_SIZE * 8);
-        std::vector<bool> zero(SHA256_BLOCK_SIZE * 8);
-        std::fill (zero.begin(), zero.end(), false);
-
-		// The following code is ugly and should be refactored. It runs
-		// four special cases depending on whether left/right is NULL.
-		// It also ensures that the "hash" of (0 || 0) is 0.
-        if (this->left && !(this->right)) {
-			if (VectorIsZero(this->left->getValue())) {
-				hash = zero;
-			} else {
-				hashVectors(&ctx256, this->left->getValue(), zero, hash);
-			}
-        } else if (!(this->left) && this->right) {
-			if (VectorIsZero(this->right->getValue())) {
-				hash = zero;
-			} else {
-				hashVectors(&ctx256, zero, this->left->getValue(), hash);
-			}
-        } else if (this->left && this->right) {
-			if (VectorIsZero(this->left->getValue()) && VectorIsZero(this->right->getValue())) {
-				hash = zero;
-			} else {
-				hashVectors(&ctx256, this->left->getValue(), this->right->getValue(), hash);
-			}
-        } else {
-            hash = zero;
+        // Copy as much of the root hash as the given vector holds
+        const unsigned char* root = this->getNode(0, 0);
+        for (size_t i = 0; i < r.size() && i < SHA256_BLOCK_SIZE; i++) {
+            r[i] = root[i];
         }
 
-        this->value = hash;
+        return true;
+    }
+    bool
+    IncrementalMerkleTree::getRootValue(Digest256& r) {
+        r = Digest256(this->getNode(0, 0));
+        return true;
     }
 
+	std::vector<unsigned char>
+	IncrementalMerkleTree::getRoot(){
+		std::vector<unsigned char> temp(8);
+		this->getRootValue(temp);
+		return temp;
+	}
+
     bool
-    IncrementalMerkleNode::checkIfNodeFull()
+    IncrementalMerkleTree::prune()
     {
-        if (this->isPruned()) {
-            return true;
-        }
+        // At every depth below the root, keep only the node on the path to the
+        // next free leaf and its left sibling: everything to their left lies
+        // in full subtrees whose digests are already folded into their parents.
+        for (uint32_t depth = 1; depth <= this->treeHeight; depth++) {
+            uint64_t keepFrom = shiftRight(this->numLeaves, this->treeHeight - depth + 1) << 1;
+            uint64_t offset = this->levelOffset[depth];
+
+            if (keepFrom <= offset) {
+                continue;
+            }
 
-        if (this->left == NULL || this->right == NULL) {
-            return false;
+            std::vector<unsigned char> &level = this->levels[depth];
+            uint64_t drop = std::min<uint64_t>(keepFrom - offset, level.size() / SHA256_BLOCK_SIZE);
+            std::vector<unsigned char>(level.begin() + drop * SHA256_BLOCK_SIZE, level.end()).swap(level);
+            this->levelOffset[depth] = keepFrom;
         }
 
-        return (this->left->subtreeFull && this->right->subtreeFull);
+        return true;
     }
 
-    void
-    IncrementalMerkleNode::getCompactRepresentation(IncrementalMerkleTreeCompact &rep)
+    IncrementalMerkleTreeCompact
+    IncrementalMerkleTree::getCompactRepresentation()
     {
-        // Do nothing at the bottom level
-        if (this->isLeaf()) {
-            return;
-        }
+        IncrementalMerkleTreeCompact rep;
+        rep.hashList.resize(this->treeHeight);
+		rep.treeHeight = this->treeHeight;
+        std::fill (rep.hashList.begin(), rep.hashList.end(), false);
 
-        // There's no content below us. We're done
-        if (!this->left) {
-            return;
-        }
+        // The path bits are those of the next free leaf (or of the last leaf,
+        // once the tree is full). Each step to the right records the digest
+        // of the full left subtree it passes.
+        if (this->numLeaves > 0) {
+            uint64_t position = this->numLeaves;
+            if (this->treeHeight < 64 && position == (((uint64_t) 1) << this->treeHeight)) {
+                position--;
+            }
 
-        // If we have no right elements, don't include any hashes. Recurse to the left.
-        if (this->hasRightChildren() == false && this->left->isLeaf() == false && this->left->subtreeFull == false) {
-            rep.hashList.at(this->nodeDepth) = false;
-            this->left->getCompactRepresentation(rep);
-            return;
-        }
+            for (uint32_t depth = 0; depth < this->treeHeight; depth++) {
+                uint64_t pathNode = shiftRight(position, this->treeHeight - depth - 1);
+                if ((pathNode & 1) == 0) {
+                    continue;
+                }
 
-        // Otherwise: Add our left child hash to the tree.
-        rep.hashList.at(this->nodeDepth) = true;
-        std::vector<unsigned char> hash(SHA256_BLOCK_SIZE, 0);
-        convertVectorToBytesVector(this->left->getValue(), hash);
-        rep.hashVec.push_back(hash);
+                // A full tree that has been pruned has nothing left to record.
+                const unsigned char* left = this->getNode(depth + 1, pathNode ^ 1);
+                if (left == NULL) {
+                    break;
+                }
 
-        // If we have a right child, recurse to the right
-        if (this->hasRightChildren()) {
-            this->right->getCompactRepresentation(rep);
-            return;
+                rep.hashList.at(depth) = true;
+                rep.hashVec.push_back(std::vector<unsigned char>(left, left + SHA256_BLOCK_SIZE));
+            }
         }
 
-        // We get here in one of the following cases:
-        // 1. Our left child is a leaf, and there's no right child.
-        // 2. Our left child is a full tree, and there's no right child.
+		// Convert the hashList into a bytesVector. First pad it to a multiple of 8 bits.
+		if (rep.hashList.size() % 8 != 0) {
+			rep.hashList.insert(rep.hashList.begin(), 8 - (rep.hashList.size() % 8), false);
+		}
+		rep.hashListBytes.resize(ceil(rep.hashList.size() / 8.0));
+		convertVectorToBytesVector(rep.hashList, rep.hashListBytes);
 
-        // We've gone right for the last time, now we go left until we reach the
-        // bottom.
-        for (uint32_t i = this->nodeDepth + 1; i < this->treeHeight; i++) {
-            rep.hashList.at(i) = false;
-        }
+        return rep;
     }
 
     bool
-    IncrementalMerkleNode::fromCompactRepresentation(IncrementalMerkleTreeCompact &rep, uint32_t pos)
+    IncrementalMerkleTree::fromCompactRepresentation(IncrementalMerkleTreeCompact &rep)
     {
-        bool result = false;
-
-        // Do nothing at the bottom level
-        if (this->isLeaf()) {
-            return true;
-        }
+        // Clean out whatever this tree held before.
+        this->reset();
 
-        // If we have any subtrees (or this tree already has stuff in it), clean it out.
-        if (this->left) {
-            // XXX memory leak: left might have the only pointers to its heap
-            // allocated children!
-            delete this->left;
-            this->left = NULL;
+        // The path bits spell out the position of the next free leaf.
+        uint64_t position = 0;
+        for (uint32_t depth = 0; depth < this->treeHeight; depth++) {
+            position = (position << 1) | (rep.hashList.at(depth) ? 1 : 0);
         }
-        if (this->right) {
-            // XXX memory leak: right might have the only pointers to its heap
-            // allocated children!
-            delete this->right;
-            this->right = NULL;
+        this->numLeaves = position;
+
+        // Store the digest of each full left subtree along the path. These are
+        // the only nodes left of the path that we will ever need again.
+        size_t pos = 0;
+        for (uint32_t depth = 1; depth <= this->treeHeight; depth++) {
+            uint64_t pathNode = shiftRight(position, this->treeHeight - depth);
+            this->levelOffset[depth] = pathNode & ~((uint64_t) 1);
+
+            if (rep.hashList.at(depth - 1) == true) {
+                if (pos >= rep.hashVec.size()) {
+                    this->reset();
+                    return false;
+                }
+                this->setNode(depth, pathNode ^ 1, &rep.hashVec.at(pos++)[0]);
+            }
         }
-        this->subtreeFull = this->subtreePruned = false;
-
-        // If the hashList[nodeDepth] is true, insert the next hash into the left tree
-        // and mark it full AND pruned. Then recurse to the right.
-        if (rep.hashList.at(this->nodeDepth) == true) {
-			// Create a left node
-			this->left = new IncrementalMerkleNode(this->nodeDepth + 1, this->treeHeight);
 
-            // Fill the left node with the value and mark it full/pruned
-            std::vector<bool> hash(SHA256_BLOCK_SIZE * 8, 0);
-            convertBytesVectorToVector(rep.hashVec.at(pos), hash);
-            this->left->value = hash;
-            this->left->subtreePruned = this->left->subtreeFull = true;
+        // Recompute the partially filled nodes on the path, bottom-up.
+        for (uint32_t depth = this->treeHeight; depth-- > 0; ) {
+            uint32_t shift = this->treeHeight - depth;
+            bool partial = (shift >= 64) ? (position != 0) : ((position & ((((uint64_t) 1) << shift) - 1)) != 0);
 
-            // Create a right node and recurse on it (incrementing pos)
-            this->right = new IncrementalMerkleNode(this->nodeDepth + 1, this->treeHeight);
-            result = this->right->fromCompactRepresentation(rep, pos + 1);
-        } else if (this->nodeDepth < (this->treeHeight - 1)) {
-			// Otherwise --
-			// * If we're about to create a leaf level, do nothing.
-			// * Else create a left node and recurse on it.
-			this->left = new IncrementalMerkleNode(this->nodeDepth + 1, this->treeHeight);
-
-            // Otherwise recurse on the left node. Do not increment pos.
-            result = this->left->fromCompactRepresentation(rep, pos);
+            if (partial) {
+                this->hashNode(depth, shiftRight(position, shift));
+            }
         }
 
-        // Update the hash value of this node
-        this->updateHashValue();
-
-        return result;
+        return true;
     }
 
-	IncrementalMerkleNode
-	IncrementalMerkleNode::operator=(const IncrementalMerkleNode &rhs) {
-		IncrementalMerkleNode dup(rhs);
-		return dup;
-	}
-
 } /* namespace libzerocash */
@@ -2,7 +2,7 @@
  *****************************************************************************
 
  Declaration of interfaces for the classes IncrementalMerkleTreeCompact,
- IncrementalMerkleNode, and IncrementalMerkleTree.
+ IncrementalWitness and IncrementalMerkleTree.
 
  *****************************************************************************
  * @author     This file is part of libzerocash, developed by the Zerocash
@@ -37,7 +37,6 @@ namespace libzerocash {
  */
 class IncrementalMerkleTreeCompact {
     friend class IncrementalMerkleTree;
-    friend class IncrementalMerkleNode;
 public:
     uint32_t getHeight() { return this->treeHeight; }
 
@@ -53,62 +52,111 @@ private:
     std::vector< unsigned char > hashListBytes;
 };
 
-/********************* Incremental Merkle tree node **************************/
+/************************** Incremental witness ******************************/
 
-class IncrementalMerkleNode {
+/* The authentication path of one leaf, kept up to date as further leaves are
+ * appended to the tree without needing the tree itself. A wallet gets one
+ * from IncrementalMerkleTree::getIncrementalWitness right after inserting
+ * its coin's commitment, and then passes every commitment appended to the
+ * tree after it to append().
+ *
+ * Besides the path, a witness only holds the frontier of the sibling subtree
+ * currently being filled, so it takes O(treeHeight) memory and each append()
+ * takes O(treeHeight) hashes.
+ */
+class IncrementalWitness {
+    friend class IncrementalMerkleTree;
 public:
-    SHA256_CTX_mod ctx256;
-	IncrementalMerkleNode* left;
-    IncrementalMerkleNode* right;
-    std::vector<bool> value;
-    uint32_t nodeDepth;
-    uint32_t treeHeight;
-    bool subtreeFull;
-    bool subtreePruned;
+    IncrementalWitness() : treeHeight(0), position(0), numLeaves(0) {}
 
-    IncrementalMerkleNode(uint32_t depth, uint32_t height);
-    IncrementalMerkleNode(const IncrementalMerkleNode& toCopy);
-    ~IncrementalMerkleNode();
-
-    // Methods
-    bool insertElement(const std::vector<bool> &hashV, std::vector<bool> &index);
-    bool getWitness(const std::vector<bool> &index, merkle_authentication_path &witness);
-    bool prune();
-    void getCompactRepresentation(IncrementalMerkleTreeCompact &rep);
-    bool fromCompactRepresentation(IncrementalMerkleTreeCompact &rep, uint32_t pos);
+    /* Returns false if the tree is full, leaving the witness unchanged. */
+    bool append(const Digest256 &leaf);
+    bool append(const std::vector<bool> &hashV);
 
-    // Utility methods
-    bool isLeaf()   { return (nodeDepth == treeHeight); }
-    bool isPruned() { return subtreePruned; }
-    bool hasFreeLeaves() { return (!subtreeFull); }
-    bool hasRightChildren() { if (!right) return false; return true; }
-    void getValue(std::vector<bool> &r) { r = value; }
-    std::vector<bool>& getValue() { return value; }
+    /* The path as produced by IncrementalMerkleTree::getWitness for this
+     * leaf, in the tree made of the leaves appended so far. */
+    void getWitness(merkle_authentication_path &witness) const;
+    bool getRootValue(std::vector<bool>& r) const;
+    bool getRootValue(Digest256& r) const;
 
-    bool checkIfNodeFull();
-    void updateHashValue();
+    uint32_t getTreeHeight() const { return treeHeight; }
+    uint64_t getPosition() const { return position; }
+    uint64_t getTreeSize() const { return numLeaves; }
+    const Digest256& getLeaf() const { return leaf; }
 
-	IncrementalMerkleNode	operator=(const IncrementalMerkleNode &rhs);
+private:
+    uint32_t treeHeight;
+    uint64_t position;
+    uint64_t numLeaves;
+    Digest256 leaf;
+
+    /* path[h] is the sibling, at height h above the leaves, of the node over
+     * the leaf. frontier[k] is the full node at height k that is the left
+     * neighbour of the path to the next leaf in the sibling subtree being
+     * filled, for the k where that exists. */
+    std::vector<Digest256> path;
+    std::vector<Digest256> frontier;
 };
 
 /************************ Incremental Merkle tree ****************************/
 
+/* The tree is stored level by level: for each depth (0 is the root, treeHeight
+ * holds the leaves) the digests of the nodes at that depth are kept in one
+ * contiguous byte array, SHA256_BLOCK_SIZE bytes per node, in left-to-right
+ * order. Because elements are only ever appended, the nodes present at a given
+ * depth always form a contiguous range, so no per-node bookkeeping is needed.
+ *
+ * Pruning drops the prefix of every level that is no longer needed to keep
+ * appending; levelOffset records the index of the first node still stored at
+ * each depth. A node that is not present (because nothing has been inserted
+ * under it yet) has the all-zero digest, and the parent of two all-zero
+ * children is itself all-zero. The digest of an empty subtree is thus the same
+ * at every height, and absent nodes are all served from one static zero digest.
+ */
 class IncrementalMerkleTree {
 protected:
 
-	IncrementalMerkleNode	 root;
-    uint32_t   				 treeHeight;
+    uint32_t                                  treeHeight;
+    uint64_t                                  numLeaves;
+    std::vector< std::vector<unsigned char> > levels;
+    std::vector< uint64_t >                   levelOffset;
+
+    uint64_t nodesAtDepth(uint32_t depth) const;
+    const unsigned char* getNode(uint32_t depth, uint64_t index) const;
+    void setNode(uint32_t depth, uint64_t index, const unsigned char* digest);
+    void hashNode(uint32_t depth, uint64_t index);
+    void hashNodes(uint32_t depth, uint64_t index, uint32_t count);
+    void updatePath(uint64_t leafIndex);
+    void updateRange(uint64_t firstLeaf, uint64_t lastLeaf);
+    void reset();
 
 public:
     IncrementalMerkleTree(uint32_t height = ZEROCASH_DEFAULT_TREE_SIZE);
     IncrementalMerkleTree(std::vector< std::vector<bool> > &valueVector, uint32_t height);
 	IncrementalMerkleTree(IncrementalMerkleTreeCompact &compact);
 
+    bool insertElement(const Digest256 &leaf, std::vector<bool> &index);
     bool insertElement(const std::vector<bool> &hashV, std::vector<bool> &index);
 	bool insertElement(const std::vector<unsigned char> &hashV, std::vector<unsigned char> &index);
     bool insertVector(std::vector< std::vector<bool> > &valueVector);
+
+    /* Appends all of the given leaves, then recomputes each internal node
+     * above them exactly once. Either every leaf is inserted or, if they do
+     * not all fit, none is and false is returned. */
+    bool appendBatch(const std::vector< std::vector<bool> > &valueVector);
+    bool appendBatch(const std::vector< std::vector<unsigned char> > &valueVector);
+    bool appendBatch(const std::vector<Digest256> &leaves);
+
+    /* Whether count more leaves fit in the tree. */
+    bool hasRoomFor(uint64_t count) const;
     bool getWitness(const std::vector<bool> &index, merkle_authentication_path &witness);
+
+    /* Starts tracking the most recently inserted leaf. This must be done
+     * before prune() discards any of its path; returns false if it did, or
+     * if the tree is empty. */
+    bool getIncrementalWitness(IncrementalWitness &witness);
     bool getRootValue(std::vector<bool>& r);
+    bool getRootValue(Digest256& r);
 	bool getRootValue(std::vector<unsigned char>& r);
 	std::vector<unsigned char>getRoot();
     bool prune();
@@ -11,6 +11,8 @@
  * @copyright  MIT license (see LICENSE file)
  *****************************************************************************/
 
+#include <cstring>
+
 #include "Zerocash.h"
 #include "MintTransaction.h"
 
@@ -28,7 +30,7 @@ MintTransaction::MintTransaction(const Coin& c): coinValue(ZC_V_SIZE)
 {
     convertIntToBytesVector(c.getValue(), this->coinValue);
 
-	internalCommitment = c.getInternalCommitment();
+	internalCommitment = c.getInternalCommitment().toBytesVector();
 	externalCommitment = c.getCoinCommitment();
 }
 
@@ -64,7 +66,7 @@ bool MintTransaction::verify() const{
 	return false;
 }
 
-const CoinCommitmentValue& MintTransaction::getMintedCoinCommitmentValue() const{
+CoinCommitmentValue MintTransaction::getMintedCoinCommitmentValue() const{
 	return this->externalCommitment.getCommitmentValue();
 }
 
@@ -72,4 +74,22 @@ uint64_t MintTransaction::getMonetaryValue() const {
     return convertBytesVectorToInt(this->coinValue);
 }
 
+void MintTransaction::serialize(uint8_t* out) const {
+    if (this->coinValue.size() != ZC_V_SIZE || this->internalCommitment.size() != ZC_K_SIZE) {
+        throw std::logic_error("MintTransaction::serialize: the transaction has not been built");
+    }
+
+    memcpy(out, this->externalCommitment.getCommitmentDigest().data(), ZC_CM_SIZE);
+    memcpy(out + ZC_CM_SIZE, this->coinValue.data(), ZC_V_SIZE);
+    memcpy(out + ZC_CM_SIZE + ZC_V_SIZE, this->internalCommitment.data(), ZC_K_SIZE);
+}
+
+void MintTransaction::deserialize(const uint8_t* in) {
+    this->externalCommitment.commitmentValue = Digest256(in);
+    in += ZC_CM_SIZE;
+    this->coinValue.assign(in, in + ZC_V_SIZE);
+    in += ZC_V_SIZE;
+    this->internalCommitment.assign(in, in + ZC_K_SIZE);
+}
+
 } /* namespace libzerocash */
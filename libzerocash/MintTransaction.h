@@ -12,6 +12,8 @@
 #ifndef MINTTRANSACTION_H_
 #define MINTTRANSACTION_H_
 
+#include <cstdint>
+
 #include "CoinCommitment.h"
 #include "Coin.h"
 
@@ -46,7 +48,7 @@ public:
      *
      * @return the commitment
      */
-    const CoinCommitmentValue& getMintedCoinCommitmentValue() const;
+    CoinCommitmentValue getMintedCoinCommitmentValue() const;
 
     /**
      * Gets the monetary value of the minted coin.
@@ -55,6 +57,17 @@ public:
      */
     uint64_t getMonetaryValue() const;
 
+    /**
+     * Writes the transaction to out, in ZC_TX_MINT_SIZE bytes: cm || v || k.
+     */
+    void serialize(uint8_t* out) const;
+
+    /**
+     * Reads a transaction written by serialize. The commitment is not
+     * checked; that is what verify is for.
+     */
+    void deserialize(const uint8_t* in);
+
 
 private:
 	std::vector<unsigned char>	coinValue;			// coin value
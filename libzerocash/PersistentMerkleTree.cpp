@@ -0,0 +1,408 @@
+/** @file
+ *****************************************************************************
+
+ Implementation of interfaces for the class PersistentMerkleTree.
+
+ See PersistentMerkleTree.h .
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include "PersistentMerkleTree.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace libzerocash {
+
+    // The file starts with this header, padded to TREE_HEADER_SPACE bytes;
+    // the full nodes follow, SHA256_BLOCK_SIZE bytes each.
+    struct persistent_tree_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t height;
+        uint64_t num_leaves;    // leaves in the tree as of the last flush
+    };
+
+    static const char TREE_MAGIC[8] = { 'Z', 'C', 'M', 'T', 'R', 'E', 'E', 0 };
+    static const uint32_t TREE_VERSION = 1;
+    static const uint64_t TREE_HEADER_SPACE = 64;
+    static const uint64_t TREE_MIN_MAP_SIZE = 1 << 20;
+
+    static_assert(sizeof(persistent_tree_header) <= TREE_HEADER_SPACE, "persistent tree header too large");
+
+    // Shifts that are allowed to reach the width of the word, as in
+    // IncrementalMerkleTree.
+    static uint64_t
+    shiftRight(uint64_t value, uint32_t bits)
+    {
+        return (bits >= 64) ? 0 : (value >> bits);
+    }
+
+    // The bits of a leaf count below the given height.
+    static uint64_t
+    lowBits(uint64_t value, uint32_t bits)
+    {
+        return (bits >= 64) ? value : (value & ((((uint64_t) 1) << bits) - 1));
+    }
+
+    // The parent of two nodes. As in IncrementalMerkleTree, the parent of two
+    // zero digests is the zero digest.
+    static Digest256
+    combine(const Digest256 &left, const Digest256 &right)
+    {
+        if (left.isZero() && right.isZero()) {
+            return Digest256();
+        }
+
+        return hashBlock(concatenate(left, right));
+    }
+
+    PersistentMerkleTree::PersistentMerkleTree(const std::string &path, uint32_t height) :
+        treeHeight(height), numLeaves(0), flushedLeaves(0), fd(-1), map(NULL), mapSize(0),
+        partial(height + 1)
+    {
+        if (height > 64) {
+            throw std::invalid_argument("Merkle tree height must be at most 64");
+        }
+
+        this->fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (this->fd < 0) {
+            throw std::runtime_error("Could not open Merkle tree file " + path);
+        }
+
+        try {
+            struct stat st;
+            if (fstat(this->fd, &st) != 0) {
+                throw std::runtime_error("Could not stat Merkle tree file " + path);
+            }
+
+            if (st.st_size == 0) {
+                // A new tree: write the header now, so that the file is
+                // always a valid (if empty) tree.
+                this->reserve(0);
+
+                persistent_tree_header header;
+                memset(&header, 0, sizeof(header));
+                memcpy(header.magic, TREE_MAGIC, sizeof(TREE_MAGIC));
+                header.version = TREE_VERSION;
+                header.height = height;
+                header.num_leaves = 0;
+                memcpy(this->map, &header, sizeof(header));
+
+                if (msync(this->map, TREE_HEADER_SPACE, MS_SYNC) != 0) {
+                    throw std::runtime_error("Could not write Merkle tree file " + path);
+                }
+            } else {
+                if ((uint64_t) st.st_size < TREE_HEADER_SPACE) {
+                    throw std::runtime_error("Merkle tree file " + path + " is truncated");
+                }
+
+                this->mapSize = st.st_size;
+                void *p = mmap(NULL, this->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+                if (p == MAP_FAILED) {
+                    throw std::runtime_error("Could not map Merkle tree file " + path);
+                }
+                this->map = (unsigned char*) p;
+
+                persistent_tree_header header;
+                memcpy(&header, this->map, sizeof(header));
+                if (memcmp(header.magic, TREE_MAGIC, sizeof(TREE_MAGIC)) != 0 || header.version != TREE_VERSION) {
+                    throw std::runtime_error(path + " is not a Merkle tree file");
+                }
+                if (header.height != height) {
+                    throw std::runtime_error("Merkle tree file " + path + " holds a tree of another height");
+                }
+                if (height < 64 && header.num_leaves > (((uint64_t) 1) << height)) {
+                    throw std::runtime_error("Merkle tree file " + path + " is corrupt");
+                }
+                if (TREE_HEADER_SPACE + nodesBefore(header.num_leaves) * SHA256_BLOCK_SIZE > this->mapSize) {
+                    throw std::runtime_error("Merkle tree file " + path + " is truncated");
+                }
+
+                this->numLeaves = header.num_leaves;
+                this->flushedLeaves = header.num_leaves;
+                this->updatePartial();
+            }
+        } catch (...) {
+            this->close();
+            throw;
+        }
+    }
+
+    PersistentMerkleTree::~PersistentMerkleTree()
+    {
+        try {
+            this->flush();
+        } catch (...) {
+            // Leaves since the last successful flush are not in the tree on
+            // disk; there is nobody left to tell.
+        }
+        this->close();
+    }
+
+    void
+    PersistentMerkleTree::close()
+    {
+        if (this->map != NULL) {
+            munmap(this->map, this->mapSize);
+            this->map = NULL;
+        }
+        if (this->fd >= 0) {
+            ::close(this->fd);
+            this->fd = -1;
+        }
+    }
+
+    // The number of full nodes once the given number of leaves have been
+    // inserted: every leaf, plus floor(leaves / 2^h) nodes at each height h
+    // above them, which adds up to 2 * leaves - popcount(leaves).
+    uint64_t
+    PersistentMerkleTree::nodesBefore(uint64_t leaves)
+    {
+        return 2 * leaves - __builtin_popcountll(leaves);
+    }
+
+    // The position in the file of a full node. It is appended right after
+    // the last leaf below it, following the nodes of lower height that the
+    // same leaf completes.
+    uint64_t
+    PersistentMerkleTree::nodePosition(uint32_t height, uint64_t index)
+    {
+        uint64_t lastLeaf = ((index + 1) << height) - 1;
+        return nodesBefore(lastLeaf) + height;
+    }
+
+    // Returns the digest of a node: from the file if it is full, from
+    // partial if it is on the right edge, and zero if it is empty.
+    Digest256
+    PersistentMerkleTree::getNode(uint32_t height, uint64_t index) const
+    {
+        uint64_t full = shiftRight(this->numLeaves, height);
+
+        if (index < full) {
+            return Digest256(this->map + TREE_HEADER_SPACE + nodePosition(height, index) * SHA256_BLOCK_SIZE);
+        }
+
+        if (index == full && lowBits(this->numLeaves, height) != 0) {
+            return this->partial[height];
+        }
+
+        return Digest256();
+    }
+
+    void
+    PersistentMerkleTree::appendNode(uint64_t position, const Digest256 &digest)
+    {
+        memcpy(this->map + TREE_HEADER_SPACE + position * SHA256_BLOCK_SIZE, digest.data(), SHA256_BLOCK_SIZE);
+    }
+
+    // Makes sure the file, and its mapping, can hold the given number of
+    // nodes. The file grows geometrically, so remapping is rare.
+    void
+    PersistentMerkleTree::reserve(uint64_t nodes)
+    {
+        uint64_t needed = TREE_HEADER_SPACE + nodes * SHA256_BLOCK_SIZE;
+        if (needed <= this->mapSize) {
+            return;
+        }
+
+        uint64_t newSize = std::max(std::max(needed, 2 * this->mapSize), TREE_MIN_MAP_SIZE);
+
+        if (this->map != NULL) {
+            munmap(this->map, this->mapSize);
+            this->map = NULL;
+            this->mapSize = 0;
+        }
+
+        if (ftruncate(this->fd, newSize) != 0) {
+            throw std::runtime_error("Could not grow Merkle tree file");
+        }
+
+        void *p = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+        if (p == MAP_FAILED) {
+            throw std::runtime_error("Could not map Merkle tree file");
+        }
+        this->map = (unsigned char*) p;
+        this->mapSize = newSize;
+    }
+
+    // Recompute the partially filled nodes on the right edge, bottom-up.
+    void
+    PersistentMerkleTree::updatePartial()
+    {
+        for (uint32_t height = 1; height <= this->treeHeight; height++) {
+            if (lowBits(this->numLeaves, height) == 0) {
+                continue;
+            }
+
+            uint64_t index = shiftRight(this->numLeaves, height);
+            this->partial[height] = combine(this->getNode(height - 1, 2 * index),
+                                            this->getNode(height - 1, 2 * index + 1));
+        }
+    }
+
+    bool
+    PersistentMerkleTree::insertElement(const Digest256 &leaf, std::vector<bool> &index)
+    {
+        uint64_t position = this->numLeaves;
+
+        if (!this->appendBatch(std::vector<Digest256>(1, leaf))) {
+            return false;
+        }
+
+        // Report where the new element went, most significant bit first.
+        index.resize(this->treeHeight);
+        for (uint32_t i = 0; i < this->treeHeight; i++) {
+            index.at(i) = (shiftRight(position, this->treeHeight - 1 - i) & 1);
+        }
+
+        return true;
+    }
+
+    bool
+    PersistentMerkleTree::insertElement(const std::vector<bool> &hashV, std::vector<bool> &index)
+    {
+        // Check that the value is a digest.
+        if (hashV.size() != SHA256_BLOCK_SIZE * 8) {
+            return false;
+        }
+
+        return this->insertElement(Digest256::fromBitVector(hashV), index);
+    }
+
+    bool
+    PersistentMerkleTree::appendBatch(const std::vector< std::vector<bool> > &valueVector)
+    {
+        std::vector<Digest256> leaves(valueVector.size());
+
+        for (size_t i = 0; i < valueVector.size(); i++) {
+            if (valueVector[i].size() != SHA256_BLOCK_SIZE * 8) {
+                return false;
+            }
+
+            leaves[i] = Digest256::fromBitVector(valueVector[i]);
+        }
+
+        return this->appendBatch(leaves);
+    }
+
+    bool
+    PersistentMerkleTree::appendBatch(const std::vector<Digest256> &leaves)
+    {
+        if (leaves.empty()) {
+            return true;
+        }
+
+        // Make sure the whole batch fits before touching the tree.
+        uint64_t count = leaves.size();
+        if (this->treeHeight < 64 && count > (((uint64_t) 1) << this->treeHeight) - this->numLeaves) {
+            return false;
+        }
+
+        this->reserve(nodesBefore(this->numLeaves + count));
+
+        // Each leaf is followed in the file by the nodes it completes, i.e.
+        // one per trailing zero bit of the new leaf count.
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t position = nodesBefore(this->numLeaves);
+            this->appendNode(position, leaves[i]);
+            this->numLeaves++;
+
+            for (uint32_t height = 1; height <= this->treeHeight && lowBits(this->numLeaves, height) == 0; height++) {
+                uint64_t index = shiftRight(this->numLeaves, height) - 1;
+                this->appendNode(position + height, combine(this->getNode(height - 1, 2 * index),
+                                                            this->getNode(height - 1, 2 * index + 1)));
+            }
+        }
+
+        this->updatePartial();
+
+        return true;
+    }
+
+    void
+    PersistentMerkleTree::flush()
+    {
+        if (this->map == NULL || this->flushedLeaves == this->numLeaves) {
+            return;
+        }
+
+        // The nodes must be on disk before the header that refers to them.
+        if (msync(this->map, this->mapSize, MS_SYNC) != 0) {
+            throw std::runtime_error("Could not flush Merkle tree file");
+        }
+
+        persistent_tree_header *header = (persistent_tree_header*) this->map;
+        header->num_leaves = this->numLeaves;
+        if (msync(this->map, TREE_HEADER_SPACE, MS_SYNC) != 0) {
+            throw std::runtime_error("Could not flush Merkle tree file");
+        }
+
+        this->flushedLeaves = this->numLeaves;
+    }
+
+    bool
+    PersistentMerkleTree::getWitness(uint64_t position, merkle_authentication_path &witness) const
+    {
+        // We can only authenticate leaves that have been inserted.
+        if (position >= this->numLeaves) {
+            return false;
+        }
+
+        if (witness.size() < this->treeHeight) {
+            witness.resize(this->treeHeight);
+        }
+
+        // witness[depth] is the sibling of the path node one level below
+        // 'depth', i.e. at height treeHeight - depth - 1.
+        for (uint32_t depth = 0; depth < this->treeHeight; depth++) {
+            uint32_t height = this->treeHeight - depth - 1;
+            Digest256 sibling = this->getNode(height, shiftRight(position, height) ^ 1);
+            witness.at(depth).resize(SHA256_BLOCK_SIZE * 8);
+            convertBytesToVector(sibling.data(), witness.at(depth));
+        }
+
+        return true;
+    }
+
+    bool
+    PersistentMerkleTree::getWitness(const std::vector<bool> &index, merkle_authentication_path &witness) const
+    {
+        // Indices are read as by IncrementalMerkleTree::getWitness: extra
+        // leading bits are dropped and missing ones taken to be zero.
+        size_t skip = (index.size() > this->treeHeight) ? index.size() - this->treeHeight : 0;
+
+        uint64_t position = 0;
+        for (size_t i = skip; i < index.size(); i++) {
+            position = (position << 1) | (index[i] ? 1 : 0);
+        }
+
+        return this->getWitness(position, witness);
+    }
+
+    bool
+    PersistentMerkleTree::getRootValue(std::vector<bool>& r) const
+    {
+        r.resize(SHA256_BLOCK_SIZE * 8);
+        convertBytesToVector(this->getNode(this->treeHeight, 0).data(), r);
+        return true;
+    }
+
+    bool
+    PersistentMerkleTree::getRootValue(Digest256& r) const
+    {
+        r = this->getNode(this->treeHeight, 0);
+        return true;
+    }
+
+} /* namespace libzerocash */
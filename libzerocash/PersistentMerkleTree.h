@@ -0,0 +1,102 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of interfaces for the class PersistentMerkleTree.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef PERSISTENTMERKLETREE_H_
+#define PERSISTENTMERKLETREE_H_
+
+#include "utils/sha256.h"
+
+#include "Zerocash.h"
+#include <string>
+#include <vector>
+
+#include "libsnark/common/data_structures/merkle_tree.hpp"
+
+namespace libzerocash {
+
+/************************ Persistent Merkle tree *****************************/
+
+/* A Merkle tree kept in a file, with the same digests (and the same all-zero
+ * convention for empty subtrees) as IncrementalMerkleTree, that can produce a
+ * witness for every leaf ever inserted.
+ *
+ * Once every leaf below a node has been inserted the node never changes
+ * again, so full nodes are appended to the file in the order they become
+ * full: each leaf, followed by the ancestors it completes. The position of
+ * any full node in the file follows from its depth and index alone, and the
+ * file is memory-mapped so that reading a node is a copy out of the page
+ * cache. The only nodes not in the file are the (at most one per level)
+ * partially filled nodes on the right edge; they are recomputed from the file
+ * when it is opened, which takes treeHeight hashes whatever the tree holds.
+ *
+ * Inserted leaves are written to the mapping straight away, but only become
+ * part of the tree on disk at the next flush(), which is also done by the
+ * destructor. Leaves inserted after the last flush are lost if the process
+ * dies. Files are only portable between machines of the same byte order.
+ */
+class PersistentMerkleTree {
+public:
+    /* Opens the tree in the file at path, creating an empty tree of the given
+     * height if there is no such file. Throws std::runtime_error if the file
+     * cannot be used or holds a tree of another height. */
+    PersistentMerkleTree(const std::string &path, uint32_t height = ZEROCASH_DEFAULT_TREE_SIZE);
+    ~PersistentMerkleTree();
+
+    PersistentMerkleTree(const PersistentMerkleTree&) = delete;
+    PersistentMerkleTree& operator=(const PersistentMerkleTree&) = delete;
+
+    bool insertElement(const Digest256 &leaf, std::vector<bool> &index);
+    bool insertElement(const std::vector<bool> &hashV, std::vector<bool> &index);
+
+    /* Either every leaf is inserted or, if they do not all fit, none is and
+     * false is returned. */
+    bool appendBatch(const std::vector<Digest256> &leaves);
+    bool appendBatch(const std::vector< std::vector<bool> > &valueVector);
+
+    /* Witnesses are as produced by IncrementalMerkleTree::getWitness, and are
+     * available for every leaf inserted so far. */
+    bool getWitness(uint64_t position, merkle_authentication_path &witness) const;
+    bool getWitness(const std::vector<bool> &index, merkle_authentication_path &witness) const;
+
+    bool getRootValue(std::vector<bool>& r) const;
+    bool getRootValue(Digest256& r) const;
+
+    uint32_t getTreeHeight() const { return this->treeHeight; }
+    uint64_t size() const { return this->numLeaves; }
+
+    /* Makes every leaf inserted so far durable. */
+    void flush();
+
+private:
+    uint32_t                                  treeHeight;
+    uint64_t                                  numLeaves;
+    uint64_t                                  flushedLeaves;
+    int                                       fd;
+    unsigned char*                            map;
+    uint64_t                                  mapSize;
+
+    /* partial[h] is the digest of the partially filled node of height h (in
+     * levels above the leaves), if there is one. */
+    std::vector<Digest256>                    partial;
+
+    static uint64_t nodesBefore(uint64_t leaves);
+    static uint64_t nodePosition(uint32_t height, uint64_t index);
+
+    Digest256 getNode(uint32_t height, uint64_t index) const;
+    void appendNode(uint64_t position, const Digest256 &digest);
+    void reserve(uint64_t nodes);
+    void updatePartial();
+    void close();
+};
+
+} /* namespace libzerocash */
+
+#endif /* PERSISTENTMERKLETREE_H_ */
@@ -0,0 +1,127 @@
+/** @file
+ *****************************************************************************
+
+ Implementation of interfaces for the class PourBatchBuilder.
+
+ See PourBatchBuilder.h .
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "PourBatchBuilder.h"
+#include "PourVerifier.h"
+
+namespace libzerocash {
+
+PourBatchBuilder::PourBatchBuilder(const ZerocashParams& params, unsigned int num_threads) :
+    pk(params.getSharedProvingKey()), treeDepth(params.getTreeDepth()), numThreads(num_threads),
+    metrics(params.getPourMetrics())
+{
+    if (!this->pk) {
+        throw std::runtime_error("Pour proving key not set.");
+    }
+
+    disableLibsnarkProfiling();
+
+    if (this->numThreads == 0) {
+        this->numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    this->provers.resize(this->numThreads);
+}
+
+PourBatchBuilder::~PourBatchBuilder()
+{
+}
+
+size_t PourBatchBuilder::add(const std::vector<unsigned char>& pubkeyHash,
+                             const MerkleRootType& rt,
+                             const std::vector<PourInput>& inputs,
+                             const std::vector<PourOutput>& outputs,
+                             uint64_t vpub_old,
+                             uint64_t vpub_new)
+{
+    if (inputs.size() > 2 || outputs.size() > 2) {
+        throw std::length_error("Too many inputs or outputs specified");
+    }
+
+    PendingPour pour;
+    pour.pubkeyHash = pubkeyHash;
+    pour.rt = rt;
+    pour.inputs = inputs;
+    pour.outputs = outputs;
+    pour.vpub_old = vpub_old;
+    pour.vpub_new = vpub_new;
+    this->pending.push_back(std::move(pour));
+
+    return this->pending.size() - 1;
+}
+
+size_t PourBatchBuilder::size() const
+{
+    return this->pending.size();
+}
+
+std::vector<PourTransaction> PourBatchBuilder::build()
+{
+    std::vector<PendingPour> pours;
+    pours.swap(this->pending);
+
+    std::vector<PourTransaction> txs(pours.size());
+
+    // Pours take about the same time each, so threads simply take the next
+    // pour not yet started until none are left.
+    std::atomic<size_t> next(0);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto work = [&](size_t thread_index) {
+        try {
+            std::unique_ptr<zerocash_pour_prover_context<ZerocashParams::zerocash_pp> > &prover = this->provers[thread_index];
+            for (size_t i = next++; i < pours.size(); i = next++) {
+                if (!prover) {
+                    prover.reset(new zerocash_pour_prover_context<ZerocashParams::zerocash_pp>(*this->pk));
+                }
+
+                PendingPour &pour = pours[i];
+                txs[i] = PourTransaction(*prover, this->treeDepth, pour.pubkeyHash, pour.rt,
+                                         std::move(pour.inputs), std::move(pour.outputs),
+                                         pour.vpub_old, pour.vpub_new, this->metrics);
+            }
+        } catch (...) {
+            next = pours.size();
+
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+
+    const size_t num_threads = std::min<size_t>(this->numThreads, pours.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; t++) {
+        threads.emplace_back(work, t);
+    }
+    work(0);
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return txs;
+}
+
+} /* namespace libzerocash */
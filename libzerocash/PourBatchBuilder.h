@@ -0,0 +1,89 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of interfaces for the class PourBatchBuilder.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef POURBATCHBUILDER_H_
+#define POURBATCHBUILDER_H_
+
+#include <memory>
+#include <vector>
+
+#include "PourInput.h"
+#include "PourOutput.h"
+#include "PourTransaction.h"
+#include "ZerocashParams.h"
+
+namespace libzerocash {
+
+/**
+ * Builds many pour transactions at once. Pours are queued with add() and
+ * built by build(), which spreads them over a pool of threads; each thread
+ * generates witnesses, proves and encrypts with its own prover context, and
+ * all contexts share the proving key of the ZerocashParams.
+ *
+ * Prover contexts are kept between calls to build(), since setting one up
+ * costs about as much as generating a witness. Creating a PourBatchBuilder
+ * calls disableLibsnarkProfiling() (see PourVerifier.h). Pours are reported
+ * to the PourMetrics that the ZerocashParams had when the builder was made.
+ */
+class PourBatchBuilder {
+public:
+    /* num_threads == 0 means one thread per hardware thread. */
+    PourBatchBuilder(const ZerocashParams& params, unsigned int num_threads = 0);
+    ~PourBatchBuilder();
+
+    PourBatchBuilder(const PourBatchBuilder&) = delete;
+    PourBatchBuilder& operator=(const PourBatchBuilder&) = delete;
+
+    /**
+     * Queues a pour; the arguments are as for the PourTransaction
+     * constructor taking inputs and outputs.
+     *
+     * @return the index of the pour in the result of the next build().
+     */
+    size_t add(const std::vector<unsigned char>& pubkeyHash,
+               const MerkleRootType& rt,
+               const std::vector<PourInput>& inputs,
+               const std::vector<PourOutput>& outputs,
+               uint64_t vpub_old,
+               uint64_t vpub_new);
+
+    size_t size() const;
+
+    /**
+     * Builds the queued pours and empties the queue. If building a pour
+     * throws, the remaining pours are abandoned, the queue is emptied and
+     * the first exception is rethrown.
+     *
+     * @return the transactions, in the order they were added.
+     */
+    std::vector<PourTransaction> build();
+
+private:
+    struct PendingPour {
+        std::vector<unsigned char> pubkeyHash;
+        MerkleRootType rt;
+        std::vector<PourInput> inputs;
+        std::vector<PourOutput> outputs;
+        uint64_t vpub_old;
+        uint64_t vpub_new;
+    };
+
+    std::shared_ptr<const zerocash_pour_proving_key<ZerocashParams::zerocash_pp> > pk;
+    int treeDepth;
+    unsigned int numThreads;
+    PourMetrics* metrics;
+    std::vector<PendingPour> pending;
+    std::vector<std::unique_ptr<zerocash_pour_prover_context<ZerocashParams::zerocash_pp> > > provers;
+};
+
+} /* namespace libzerocash */
+
+#endif /* POURBATCHBUILDER_H_ */
@@ -24,13 +24,9 @@ PourInput::PourInput(int tree_depth): old_coin(), merkle_index(), path() {
 	// dummy merkle tree
 	IncrementalMerkleTree merkleTree(tree_depth);
 
-	// commitment from coin
-	std::vector<bool> commitment(ZC_CM_SIZE * 8);
-	convertBytesVectorToVector(this->old_coin.getCoinCommitment().getCommitmentValue(), commitment);
-
-	// insert commitment into the merkle tree
+	// insert the coin's commitment into the merkle tree
 	std::vector<bool> index;
-	merkleTree.insertElement(commitment, index);
+	merkleTree.insertElement(this->old_coin.getCoinCommitment().getCommitmentDigest(), index);
 
 	merkleTree.getWitness(index, this->path);
 
@@ -0,0 +1,117 @@
+/** @file
+ *****************************************************************************
+
+ Implementation of interfaces for the classes PourMetrics, PourPhaseCounters
+ and PourPhaseTimer.
+
+ See PourMetrics.h .
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <time.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "PourMetrics.h"
+
+namespace libzerocash {
+
+static uint64_t
+readClock(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+const char* getPourPhaseName(PourPhase phase)
+{
+    switch (phase) {
+    case POUR_PHASE_SERIALS_AND_MACS:       return "serials_and_macs";
+    case POUR_PHASE_BIT_CONVERSION:         return "bit_conversion";
+    case POUR_PHASE_WITNESS:                return "witness";
+    case POUR_PHASE_PROOF:                  return "proof";
+    case POUR_PHASE_ENCRYPTION:             return "encryption";
+    default:                                return "unknown";
+    }
+}
+
+PourPhaseCounters::PourPhaseCounters()
+{
+    this->reset();
+}
+
+void PourPhaseCounters::recordPour(const PourTimings &timings)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->totals.pours++;
+    for (size_t i = 0; i < POUR_PHASE_COUNT; i++) {
+        const PourPhaseTiming &phase = timings.phases[i];
+        this->totals.wallNanos[i] += phase.wallNanos;
+        this->totals.maxWallNanos[i] = std::max(this->totals.maxWallNanos[i], phase.wallNanos);
+        this->totals.cpuNanos[i] += phase.cpuNanos;
+        this->totals.allocations[i] += phase.allocations;
+    }
+}
+
+PourPhaseCounters::Totals PourPhaseCounters::getTotals() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->totals;
+}
+
+void PourPhaseCounters::reset()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    memset(&this->totals, 0, sizeof(this->totals));
+}
+
+PourPhaseTimer::PourPhaseTimer(PourMetrics* metrics) :
+    metrics(metrics), wallStart(0), cpuStart(0), allocationStart(0)
+{
+    this->start();
+}
+
+void PourPhaseTimer::start()
+{
+    if (this->metrics == NULL) {
+        return;
+    }
+
+    this->allocationStart = this->metrics->getAllocationCount();
+    this->cpuStart = readClock(CLOCK_THREAD_CPUTIME_ID);
+    this->wallStart = readClock(CLOCK_MONOTONIC);
+}
+
+void PourPhaseTimer::endPhase(PourPhase phase)
+{
+    if (this->metrics == NULL) {
+        return;
+    }
+
+    uint64_t wallEnd = readClock(CLOCK_MONOTONIC);
+    uint64_t cpuEnd = readClock(CLOCK_THREAD_CPUTIME_ID);
+    uint64_t allocationEnd = this->metrics->getAllocationCount();
+
+    PourPhaseTiming &timing = this->timings.phases[phase];
+    timing.wallNanos += wallEnd - this->wallStart;
+    timing.cpuNanos += cpuEnd - this->cpuStart;
+    timing.allocations += allocationEnd - this->allocationStart;
+
+    this->start();
+}
+
+void PourPhaseTimer::finish()
+{
+    if (this->metrics != NULL) {
+        this->metrics->recordPour(this->timings);
+    }
+}
+
+} /* namespace libzerocash */
@@ -0,0 +1,115 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of interfaces for the classes PourMetrics, PourPhaseCounters and
+ PourPhaseTimer.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef POURMETRICS_H_
+#define POURMETRICS_H_
+
+#include <cstdint>
+#include <mutex>
+
+namespace libzerocash {
+
+/* The phases of building a PourTransaction, in the order they run. Version 0
+ * transactions carry no proof, and skip the bit conversion, witness and proof
+ * phases. */
+enum PourPhase {
+    POUR_PHASE_SERIALS_AND_MACS = 0,    // serial numbers, h_S and the MACs
+    POUR_PHASE_BIT_CONVERSION,          // packing the prover inputs as bit vectors
+    POUR_PHASE_WITNESS,                 // zkSNARK witness generation and check
+    POUR_PHASE_PROOF,                   // the zkSNARK prover proper
+    POUR_PHASE_ENCRYPTION,              // ECIES encryption of the two new coins
+    POUR_PHASE_COUNT
+};
+
+const char* getPourPhaseName(PourPhase phase);
+
+struct PourPhaseTiming {
+    uint64_t wallNanos;     // wall-clock time
+    uint64_t cpuNanos;      // CPU time of the building thread
+    uint64_t allocations;   // as counted by PourMetrics::getAllocationCount
+
+    PourPhaseTiming() : wallNanos(0), cpuNanos(0), allocations(0) {}
+};
+
+struct PourTimings {
+    PourPhaseTiming phases[POUR_PHASE_COUNT];
+};
+
+/* A hook for the time spent in each phase of building a pour. Install one
+ * with ZerocashParams::setPourMetrics; recordPour is then called once for
+ * every PourTransaction built with those params, including by
+ * PourBatchBuilder, and so may be called from several threads at once.
+ *
+ * CPU time is that of the thread building the pour; with MULTICORE, the
+ * time spent by the prover's other threads is not included.
+ */
+class PourMetrics {
+public:
+    virtual ~PourMetrics() {}
+
+    virtual void recordPour(const PourTimings &timings) = 0;
+
+    /* libzerocash cannot see allocations; an application that counts them
+     * (for instance by replacing operator new) can report its count here,
+     * and the allocations in each phase are then recorded too. */
+    virtual uint64_t getAllocationCount() const { return 0; }
+};
+
+/* A PourMetrics that keeps running totals for each phase. */
+class PourPhaseCounters : public PourMetrics {
+public:
+    struct Totals {
+        uint64_t pours;
+        uint64_t wallNanos[POUR_PHASE_COUNT];
+        uint64_t maxWallNanos[POUR_PHASE_COUNT];
+        uint64_t cpuNanos[POUR_PHASE_COUNT];
+        uint64_t allocations[POUR_PHASE_COUNT];
+    };
+
+    PourPhaseCounters();
+
+    void recordPour(const PourTimings &timings);
+
+    Totals getTotals() const;
+    void reset();
+
+private:
+    mutable std::mutex mutex;
+    Totals totals;
+};
+
+/* Measures the phases of one pour, for PourTransaction. Does nothing if
+ * metrics is NULL. */
+class PourPhaseTimer {
+public:
+    explicit PourPhaseTimer(PourMetrics* metrics);
+
+    /* Ends the current phase, which is charged to the given phase, and
+     * starts the next one. */
+    void endPhase(PourPhase phase);
+
+    /* Reports the phases to the metrics. */
+    void finish();
+
+private:
+    PourMetrics* metrics;
+    PourTimings timings;
+    uint64_t wallStart;
+    uint64_t cpuStart;
+    uint64_t allocationStart;
+
+    void start();
+};
+
+} /* namespace libzerocash */
+
+#endif /* POURMETRICS_H_ */
@@ -0,0 +1,216 @@
+/** @file
+ *****************************************************************************
+
+ Implementation of the binary encoding of Pour proofs.
+
+ See PourProof.h .
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <cstring>
+#include <stdexcept>
+
+#include "PourProof.h"
+
+#include "libsnark/algebra/curves/alt_bn128/alt_bn128_pp.hpp"
+
+namespace libzerocash {
+
+static const size_t FQ_BYTES = 32;
+static const size_t G1_BYTES = FQ_BYTES;
+static const size_t G2_BYTES = 2 * FQ_BYTES;
+
+static const unsigned char FLAG_INFINITY = 0x80;
+static const unsigned char FLAG_Y_ODD = 0x40;
+static const unsigned char FLAGS = FLAG_INFINITY | FLAG_Y_ODD;
+
+static_assert(7 * G1_BYTES + G2_BYTES == ZC_POUR_PROOF_SIZE, "ZC_POUR_PROOF_SIZE does not match the proof encoding");
+
+static void writeFq(const alt_bn128_Fq& x, unsigned char* out) {
+    const bigint<alt_bn128_q_limbs> b = x.as_bigint();
+    for (size_t i = 0; i < FQ_BYTES; i++) {
+        out[FQ_BYTES - 1 - i] = (b.data[i / sizeof(mp_limb_t)] >> (8 * (i % sizeof(mp_limb_t)))) & 0xff;
+    }
+}
+
+/* Ignores the flag bits of in[0]. Returns false if the value is not reduced. */
+static bool readFq(const unsigned char* in, alt_bn128_Fq& x) {
+    bigint<alt_bn128_q_limbs> b;
+    for (size_t j = 0; j < alt_bn128_q_limbs; j++) {
+        b.data[j] = 0;
+    }
+    for (size_t i = 0; i < FQ_BYTES; i++) {
+        const unsigned char c = (i == FQ_BYTES - 1) ? (in[0] & ~FLAGS) : in[FQ_BYTES - 1 - i];
+        b.data[i / sizeof(mp_limb_t)] |= ((mp_limb_t) c) << (8 * (i % sizeof(mp_limb_t)));
+    }
+    if (mpn_cmp(b.data, alt_bn128_modulus_q.data, alt_bn128_q_limbs) >= 0) {
+        return false;
+    }
+    x = alt_bn128_Fq(b);
+    return true;
+}
+
+static bool isOdd(const alt_bn128_Fq& y) {
+    return y.as_bigint().data[0] & 1;
+}
+
+static bool isOdd(const alt_bn128_Fq2& y) {
+    return isOdd(y.c0.is_zero() ? y.c1 : y.c0);
+}
+
+/* libsnark's sqrt() does not terminate on a non-residue, so check first. */
+template<typename FieldT>
+static bool squareRoot(const FieldT& a, FieldT& root) {
+    if (!a.is_zero() && (a ^ FieldT::euler) != FieldT::one()) {
+        return false;
+    }
+    root = a.sqrt();
+    return true;
+}
+
+/* Whether the n bytes at in are the (only) encoding of the point at infinity. */
+static bool readInfinity(const unsigned char* in, size_t n) {
+    if (in[0] != FLAG_INFINITY) {
+        return false;
+    }
+    for (size_t i = 1; i < n; i++) {
+        if (in[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void writeG1(alt_bn128_G1 p, unsigned char* out) {
+    if (p.is_zero()) {
+        memset(out, 0, G1_BYTES);
+        out[0] = FLAG_INFINITY;
+        return;
+    }
+
+    p.to_affine_coordinates();
+    writeFq(p.X, out);
+    if (isOdd(p.Y)) {
+        out[0] |= FLAG_Y_ODD;
+    }
+}
+
+static void writeG2(alt_bn128_G2 p, unsigned char* out) {
+    if (p.is_zero()) {
+        memset(out, 0, G2_BYTES);
+        out[0] = FLAG_INFINITY;
+        return;
+    }
+
+    p.to_affine_coordinates();
+    writeFq(p.X.c0, out);
+    writeFq(p.X.c1, out + FQ_BYTES);
+    if (isOdd(p.Y)) {
+        out[0] |= FLAG_Y_ODD;
+    }
+}
+
+static bool readG1(const unsigned char* in, alt_bn128_G1& p) {
+    if (in[0] & FLAG_INFINITY) {
+        if (!readInfinity(in, G1_BYTES)) {
+            return false;
+        }
+        p = alt_bn128_G1::zero();
+        return true;
+    }
+
+    alt_bn128_Fq x, y;
+    if (!readFq(in, x) || !squareRoot(x.squared() * x + alt_bn128_coeff_b, y)) {
+        return false;
+    }
+    const bool odd = in[0] & FLAG_Y_ODD;
+    if (isOdd(y) != odd) {
+        if (y.is_zero()) {
+            return false;
+        }
+        y = -y;
+    }
+
+    // G1 has prime order, so every point on the curve is in it.
+    p = alt_bn128_G1(x, y, alt_bn128_Fq::one());
+    return true;
+}
+
+static bool readG2(const unsigned char* in, alt_bn128_G2& p) {
+    if (in[0] & FLAG_INFINITY) {
+        if (!readInfinity(in, G2_BYTES)) {
+            return false;
+        }
+        p = alt_bn128_G2::zero();
+        return true;
+    }
+
+    alt_bn128_Fq2 x, y;
+    if (!readFq(in, x.c0) || !readFq(in + FQ_BYTES, x.c1) ||
+        (in[FQ_BYTES] & FLAGS) != 0 ||
+        !squareRoot(x.squared() * x + alt_bn128_twist_coeff_b, y)) {
+        return false;
+    }
+    const bool odd = in[0] & FLAG_Y_ODD;
+    if (isOdd(y) != odd) {
+        if (y.is_zero()) {
+            return false;
+        }
+        y = -y;
+    }
+
+    // The twist has points outside the group of order r.
+    p = alt_bn128_G2(x, y, alt_bn128_Fq2::one());
+    return (alt_bn128_modulus_r * p).is_zero();
+}
+
+void serializePourProof(const PourProof& proof, uint8_t* out) {
+    writeG1(proof.g_A.g, out);
+    out += G1_BYTES;
+    writeG1(proof.g_A.h, out);
+    out += G1_BYTES;
+    writeG2(proof.g_B.g, out);
+    out += G2_BYTES;
+    writeG1(proof.g_B.h, out);
+    out += G1_BYTES;
+    writeG1(proof.g_C.g, out);
+    out += G1_BYTES;
+    writeG1(proof.g_C.h, out);
+    out += G1_BYTES;
+    writeG1(proof.g_H, out);
+    out += G1_BYTES;
+    writeG1(proof.g_K, out);
+}
+
+PourProof deserializePourProof(const uint8_t* in) {
+    PourProof proof;
+    if (!deserializePourProof(in, proof)) {
+        throw std::invalid_argument("deserializePourProof: invalid encoding of a proof");
+    }
+    return proof;
+}
+
+bool deserializePourProof(const uint8_t* in, PourProof& proof) {
+    bool ok = readG1(in, proof.g_A.g);
+    in += G1_BYTES;
+    ok = ok && readG1(in, proof.g_A.h);
+    in += G1_BYTES;
+    ok = ok && readG2(in, proof.g_B.g);
+    in += G2_BYTES;
+    ok = ok && readG1(in, proof.g_B.h);
+    in += G1_BYTES;
+    ok = ok && readG1(in, proof.g_C.g);
+    in += G1_BYTES;
+    ok = ok && readG1(in, proof.g_C.h);
+    in += G1_BYTES;
+    ok = ok && readG1(in, proof.g_H);
+    in += G1_BYTES;
+    ok = ok && readG1(in, proof.g_K);
+    return ok;
+}
+
+} /* namespace libzerocash */
@@ -0,0 +1,48 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of the binary encoding of Pour proofs.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef POURPROOF_H_
+#define POURPROOF_H_
+
+#include <cstdint>
+
+#include "Zerocash.h"
+#include "ZerocashParams.h"
+
+namespace libzerocash {
+
+typedef zerocash_pour_proof<ZerocashParams::zerocash_pp> PourProof;
+
+/*
+ * A proof is seven elements of G1 and one of G2, encoded in ZC_POUR_PROOF_SIZE
+ * bytes in the order g_A.g, g_A.h, g_B.g (the element of G2), g_B.h, g_C.g,
+ * g_C.h, g_H, g_K.
+ *
+ * Each point is compressed to its affine x coordinate, written big-endian in
+ * 32 bytes per element of Fq; for G2, x.c0 comes before x.c1. As q < 2^254,
+ * the two top bits of the first byte of each point are free and hold flags:
+ * 0x80 marks the point at infinity (all other bits zero), and 0x40 is set if
+ * y is odd (for G2, if y.c0 is odd, or y.c1 if y.c0 is zero). The encoding is
+ * for alt_bn128, the curve libzerocash is built for.
+ */
+void serializePourProof(const PourProof& proof, uint8_t* out);
+
+/* Throws std::invalid_argument unless in holds the encoding above, with every
+ * coordinate reduced and every point on the curve (and, for G2, in the group
+ * of order r). The proof itself is not checked. */
+PourProof deserializePourProof(const uint8_t* in);
+
+/* As above, but returns false rather than throwing. */
+bool deserializePourProof(const uint8_t* in, PourProof& proof);
+
+} /* namespace libzerocash */
+
+#endif /* POURPROOF_H_ */
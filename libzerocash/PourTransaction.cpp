@@ -30,6 +30,9 @@ using CryptoPP::PK_EncryptorFilter;
 #include <openssl/bn.h>
 #include <openssl/sha.h>
 
+#include <algorithm>
+#include <cstring>
+
 #include "Zerocash.h"
 #include "PourTransaction.h"
 #include "PourInput.h"
@@ -53,7 +56,21 @@ PourTransaction::PourTransaction(ZerocashParams& params,
                                  uint64_t vpub_old,
                                  uint64_t vpub_new
                                 ) :
-    publicOldValue(ZC_V_SIZE), publicNewValue(ZC_V_SIZE), serialNumber_1(ZC_SN_SIZE), serialNumber_2(ZC_SN_SIZE), MAC_1(ZC_H_SIZE), MAC_2(ZC_H_SIZE)
+    PourTransaction(params.getProverContext(), params.getTreeDepth(), pubkeyHash, rt,
+                    std::move(inputs), std::move(outputs), vpub_old, vpub_new, params.getPourMetrics())
+{
+}
+
+PourTransaction::PourTransaction(zerocash_pour_prover_context<ZerocashParams::zerocash_pp>& prover,
+                                 int tree_depth,
+                                 const std::vector<unsigned char>& pubkeyHash,
+                                 const MerkleRootType& rt,
+                                 std::vector<PourInput> inputs,
+                                 std::vector<PourOutput> outputs,
+                                 uint64_t vpub_old,
+                                 uint64_t vpub_new,
+                                 PourMetrics* metrics) :
+    publicOldValue(), publicNewValue(), serialNumber_1(), serialNumber_2(), MAC_1(), MAC_2()
 {
     if (inputs.size() > 2 || outputs.size() > 2) {
         throw std::length_error("Too many inputs or outputs specified");
@@ -61,7 +78,7 @@ PourTransaction::PourTransaction(ZerocashParams& params,
     
     while (inputs.size() < 2) {
         // Push a dummy input of value 0.
-        inputs.push_back(PourInput(params.getTreeDepth()));
+        inputs.push_back(PourInput(tree_depth));
     }
 
     while (outputs.size() < 2) {
@@ -70,7 +87,8 @@ PourTransaction::PourTransaction(ZerocashParams& params,
     }
 
     init(1,
-         params,
+         &prover,
+         metrics,
          rt,
          inputs[0].old_coin,
          inputs[1].old_coin,
@@ -107,7 +125,7 @@ PourTransaction::PourTransaction(uint16_t version_num,
                                  const std::vector<unsigned char>& pubkeyHash,
                                  const Coin& c_1_new,
                                  const Coin& c_2_new) :
-    publicOldValue(ZC_V_SIZE), publicNewValue(ZC_V_SIZE), serialNumber_1(ZC_SN_SIZE), serialNumber_2(ZC_SN_SIZE), MAC_1(ZC_H_SIZE), MAC_2(ZC_H_SIZE)
+    publicOldValue(), publicNewValue(), serialNumber_1(), serialNumber_2(), MAC_1(), MAC_2()
 {
     init(version_num, params, rt, c_1_old, c_2_old, addr_1_old, addr_2_old, patMerkleIdx_1, patMerkleIdx_2,
          patMAC_1, patMAC_2, addr_1_new, addr_2_new, v_pub_old, v_pub_new, pubkeyHash, c_1_new, c_2_new);
@@ -132,187 +150,100 @@ void PourTransaction::init(uint16_t version_num,
                      const Coin& c_1_new,
                      const Coin& c_2_new)
 {
+    // Only transactions with a proof need the (lazily built) prover context.
+    init(version_num, version_num > 0 ? &params.getProverContext() : NULL, params.getPourMetrics(),
+         rt, c_1_old, c_2_old, addr_1_old, addr_2_old, patMerkleIdx_1, patMerkleIdx_2,
+         patMAC_1, patMAC_2, addr_1_new, addr_2_new, v_pub_old, v_pub_new, pubkeyHash, c_1_new, c_2_new);
+}
+
+void PourTransaction::init(uint16_t version_num,
+                     zerocash_pour_prover_context<ZerocashParams::zerocash_pp>* prover,
+                     PourMetrics* metrics,
+                     const MerkleRootType& rt,
+                     const Coin& c_1_old,
+                     const Coin& c_2_old,
+                     const Address& addr_1_old,
+                     const Address& addr_2_old,
+                     const size_t patMerkleIdx_1,
+                     const size_t patMerkleIdx_2,
+                     const merkle_authentication_path& patMAC_1,
+                     const merkle_authentication_path& patMAC_2,
+                     const PublicAddress& addr_1_new,
+                     const PublicAddress& addr_2_new,
+                     uint64_t v_pub_old,
+                     uint64_t v_pub_new,
+                     const std::vector<unsigned char>& pubkeyHash,
+                     const Coin& c_1_new,
+                     const Coin& c_2_new)
+{
+    PourPhaseTimer timer(metrics);
+
     this->version = version_num;
 
-    convertIntToBytesVector(v_pub_old, this->publicOldValue);
-    convertIntToBytesVector(v_pub_new, this->publicNewValue);
+    this->publicOldValue = Bits<64>::fromInt(v_pub_old);
+    this->publicNewValue = Bits<64>::fromInt(v_pub_new);
 
     this->cm_1 = c_1_new.getCoinCommitment();
     this->cm_2 = c_2_new.getCoinCommitment();
 
-	std::vector<bool> root_bv(ZC_ROOT_SIZE * 8);
-    std::vector<bool> addr_pk_new_1_bv(ZC_A_PK_SIZE * 8);
-    std::vector<bool> addr_pk_new_2_bv(ZC_A_PK_SIZE * 8);
-    std::vector<bool> addr_sk_old_1_bv(ZC_A_SK_SIZE * 8);
-    std::vector<bool> addr_sk_old_2_bv(ZC_A_SK_SIZE * 8);
-    std::vector<bool> rand_new_1_bv(ZC_R_SIZE * 8);
-    std::vector<bool> rand_new_2_bv(ZC_R_SIZE * 8);
-    std::vector<bool> rand_old_1_bv(ZC_R_SIZE * 8);
-    std::vector<bool> rand_old_2_bv(ZC_R_SIZE * 8);
-    std::vector<bool> nonce_new_1_bv(ZC_RHO_SIZE * 8);
-    std::vector<bool> nonce_new_2_bv(ZC_RHO_SIZE * 8);
-    std::vector<bool> nonce_old_1_bv(ZC_RHO_SIZE * 8);
-    std::vector<bool> nonce_old_2_bv(ZC_RHO_SIZE * 8);
-    std::vector<bool> val_new_1_bv(ZC_V_SIZE * 8);
-    std::vector<bool> val_new_2_bv(ZC_V_SIZE * 8);
-    std::vector<bool> val_old_pub_bv(ZC_V_SIZE * 8);
-    std::vector<bool> val_new_pub_bv(ZC_V_SIZE * 8);
-    std::vector<bool> val_old_1_bv(ZC_V_SIZE * 8);
-    std::vector<bool> val_old_2_bv(ZC_V_SIZE * 8);
-    std::vector<bool> cm_new_1_bv(ZC_CM_SIZE * 8);
-    std::vector<bool> cm_new_2_bv(ZC_CM_SIZE * 8);
-
-	convertBytesVectorToVector(rt, root_bv);
-
-    convertBytesVectorToVector(c_1_new.getCoinCommitment().getCommitmentValue(), cm_new_1_bv);
-    convertBytesVectorToVector(c_2_new.getCoinCommitment().getCommitmentValue(), cm_new_2_bv);
-
-    convertBytesVectorToVector(addr_1_old.getPrivateAddress().getAddressSecret(), addr_sk_old_1_bv);
-    convertBytesVectorToVector(addr_2_old.getPrivateAddress().getAddressSecret(), addr_sk_old_2_bv);
-
-    convertBytesVectorToVector(addr_1_new.getPublicAddressSecret(), addr_pk_new_1_bv);
-    convertBytesVectorToVector(addr_2_new.getPublicAddressSecret(), addr_pk_new_2_bv);
-
-    convertBytesVectorToVector(c_1_old.getR(), rand_old_1_bv);
-    convertBytesVectorToVector(c_2_old.getR(), rand_old_2_bv);
-
-    convertBytesVectorToVector(c_1_new.getR(), rand_new_1_bv);
-    convertBytesVectorToVector(c_2_new.getR(), rand_new_2_bv);
-
-    convertBytesVectorToVector(c_1_old.getRho(), nonce_old_1_bv);
-    convertBytesVectorToVector(c_2_old.getRho(), nonce_old_2_bv);
-
-    convertBytesVectorToVector(c_1_new.getRho(), nonce_new_1_bv);
-    convertBytesVectorToVector(c_2_new.getRho(), nonce_new_2_bv);
-
-    std::vector<unsigned char> v_old_1_conv(ZC_V_SIZE, 0);
-    convertIntToBytesVector(c_1_old.getValue(), v_old_1_conv);
-    libzerocash::convertBytesVectorToVector(v_old_1_conv, val_old_1_bv);
-
-    std::vector<unsigned char> v_old_2_conv(ZC_V_SIZE, 0);
-    convertIntToBytesVector(c_2_old.getValue(), v_old_2_conv);
-    libzerocash::convertBytesVectorToVector(v_old_2_conv, val_old_2_bv);
-
-    std::vector<unsigned char> v_new_1_conv(ZC_V_SIZE, 0);
-    convertIntToBytesVector(c_1_new.getValue(), v_new_1_conv);
-    libzerocash::convertBytesVectorToVector(v_new_1_conv, val_new_1_bv);
-
-    std::vector<unsigned char> v_new_2_conv(ZC_V_SIZE, 0);
-    convertIntToBytesVector(c_2_new.getValue(), v_new_2_conv);
-    libzerocash::convertBytesVectorToVector(v_new_2_conv, val_new_2_bv);
-
-    convertBytesVectorToVector(this->publicOldValue, val_old_pub_bv);
-    convertBytesVectorToVector(this->publicNewValue, val_new_pub_bv);
-
-    std::vector<bool> nonce_old_1(ZC_RHO_SIZE * 8);
-    copy(nonce_old_1_bv.begin(), nonce_old_1_bv.end(), nonce_old_1.begin());
-    nonce_old_1.erase(nonce_old_1.end()-2, nonce_old_1.end());
-
-    nonce_old_1.insert(nonce_old_1.begin(), 1);
-    nonce_old_1.insert(nonce_old_1.begin(), 0);
-
-    std::vector<bool> sn_internal_1;
-    concatenateVectors(addr_sk_old_1_bv, nonce_old_1, sn_internal_1);
-    std::vector<bool> sn_old_1_bv(ZC_SN_SIZE * 8);
-    hashVector(sn_internal_1, sn_old_1_bv);
-
-    convertVectorToBytesVector(sn_old_1_bv, this->serialNumber_1);
-
-    std::vector<bool> nonce_old_2(ZC_RHO_SIZE * 8);
-    copy(nonce_old_2_bv.begin(), nonce_old_2_bv.end(), nonce_old_2.begin());
-    nonce_old_2.erase(nonce_old_2.end()-2, nonce_old_2.end());
-
-    nonce_old_2.insert(nonce_old_2.begin(), 1);
-    nonce_old_2.insert(nonce_old_2.begin(), 0);
-
-    std::vector<bool> sn_internal_2;
-    concatenateVectors(addr_sk_old_2_bv, nonce_old_2, sn_internal_2);
-    std::vector<bool> sn_old_2_bv(ZC_SN_SIZE * 8);
-    hashVector(sn_internal_2, sn_old_2_bv);
-
-    convertVectorToBytesVector(sn_old_2_bv, this->serialNumber_2);
-
-    unsigned char h_S_bytes[ZC_H_SIZE];
-    unsigned char pubkeyHash_bytes[ZC_H_SIZE];
-    convertBytesVectorToBytes(pubkeyHash, pubkeyHash_bytes);
-    SHA256_CTX sha256;
-    SHA256_Init(&sha256);
-    SHA256_Update(&sha256, pubkeyHash_bytes, ZC_H_SIZE);
-    SHA256_Final(h_S_bytes, &sha256);
-
-    std::vector<bool> h_S_bv(ZC_H_SIZE * 8);
-    convertBytesToVector(h_S_bytes, h_S_bv);
-
-    std::vector<bool> h_S_internal1(ZC_H_SIZE * 8);
-    convertBytesToVector(h_S_bytes, h_S_internal1);
-    h_S_internal1.erase(h_S_internal1.end()-3, h_S_internal1.end());
-    std::vector<bool> h_S_internal2 = h_S_internal1;
+    const Digest256& addr_sk_old_1 = addr_1_old.getPrivateAddress().getAddressSecret();
+    const Digest256& addr_sk_old_2 = addr_2_old.getPrivateAddress().getAddressSecret();
 
-    h_S_internal1.insert(h_S_internal1.begin(), 0);
-    h_S_internal1.insert(h_S_internal1.begin(), 0);
-    h_S_internal1.insert(h_S_internal1.begin(), 1);
+    // sn = H(a_sk || 01 || rho[0..254))
+    this->serialNumber_1 = hashBlock(concatenate(addr_sk_old_1, c_1_old.getRho().withPrefix(0x1, 2)));
+    this->serialNumber_2 = hashBlock(concatenate(addr_sk_old_2, c_2_old.getRho().withPrefix(0x1, 2)));
 
-    h_S_internal2.insert(h_S_internal2.begin(), 1);
-    h_S_internal2.insert(h_S_internal2.begin(), 0);
-    h_S_internal2.insert(h_S_internal2.begin(), 1);
+    Digest256 h_S;
+    Digest256 pubkeyHash_bits = Digest256::fromBytesVector(pubkeyHash);
+    SHA256_CTX sha256;
+    SHA256_Init(&sha256);
+    SHA256_Update(&sha256, pubkeyHash_bits.data(), ZC_H_SIZE);
+    SHA256_Final(h_S.data(), &sha256);
 
-    std::vector<bool> MAC_1_internal;
-    concatenateVectors(addr_sk_old_1_bv, h_S_internal1, MAC_1_internal);
-    std::vector<bool> MAC_1_bv(ZC_H_SIZE * 8);
-    hashVector(MAC_1_internal, MAC_1_bv);
-    convertVectorToBytesVector(MAC_1_bv, this->MAC_1);
+    // h_i = H(a_sk_i || 1 || (i - 1) as two bits || h_S[0..253))
+    this->MAC_1 = hashBlock(concatenate(addr_sk_old_1, h_S.withPrefix(0x4, 3)));
+    this->MAC_2 = hashBlock(concatenate(addr_sk_old_2, h_S.withPrefix(0x5, 3)));
 
-    std::vector<bool> MAC_2_internal;
-    concatenateVectors(addr_sk_old_2_bv, h_S_internal2, MAC_2_internal);
-    std::vector<bool> MAC_2_bv(ZC_H_SIZE * 8);
-    hashVector(MAC_2_internal, MAC_2_bv);
-    convertVectorToBytesVector(MAC_2_bv, this->MAC_2);
+    timer.endPhase(POUR_PHASE_SERIALS_AND_MACS);
 
     if(this->version > 0){
-        auto proofObj = zerocash_pour_ppzksnark_prover<ZerocashParams::zerocash_pp>(params.getProvingKey(),
-            { patMAC_1, patMAC_2 },
-            { patMerkleIdx_1, patMerkleIdx_2 },
-            root_bv,
-            { addr_pk_new_1_bv, addr_pk_new_2_bv },
-            { addr_sk_old_1_bv, addr_sk_old_2_bv },
-            { rand_new_1_bv, rand_new_2_bv },
-            { rand_old_1_bv, rand_old_2_bv },
-            { nonce_new_1_bv, nonce_new_2_bv },
-            { nonce_old_1_bv, nonce_old_2_bv },
-            { val_new_1_bv, val_new_2_bv },
-            val_old_pub_bv,
-            val_new_pub_bv,
-            { val_old_1_bv, val_old_2_bv },
-            h_S_bv);
-
-        std::stringstream ss;
-        ss << proofObj;
-        this->zkSNARK = ss.str();
+        // The prover is the only place that needs the inputs as bit vectors.
+        const bit_vector rt_bits = Digest256::fromBytesVector(rt).toBitVector();
+        const std::vector<bit_vector> new_address_public_keys = { addr_1_new.getPublicAddressSecret().toBitVector(), addr_2_new.getPublicAddressSecret().toBitVector() };
+        const std::vector<bit_vector> old_address_secret_keys = { addr_sk_old_1.toBitVector(), addr_sk_old_2.toBitVector() };
+        const std::vector<bit_vector> new_commitment_nonces = { c_1_new.getR().toBitVector(), c_2_new.getR().toBitVector() };
+        const std::vector<bit_vector> old_commitment_nonces = { c_1_old.getR().toBitVector(), c_2_old.getR().toBitVector() };
+        const std::vector<bit_vector> new_serial_number_nonces = { c_1_new.getRho().toBitVector(), c_2_new.getRho().toBitVector() };
+        const std::vector<bit_vector> old_serial_number_nonces = { c_1_old.getRho().toBitVector(), c_2_old.getRho().toBitVector() };
+        const std::vector<bit_vector> new_coin_values = { c_1_new.coinValue.toBitVector(), c_2_new.coinValue.toBitVector() };
+        const std::vector<bit_vector> old_coin_values = { c_1_old.coinValue.toBitVector(), c_2_old.coinValue.toBitVector() };
+        const bit_vector public_old_value = this->publicOldValue.toBitVector();
+        const bit_vector public_new_value = this->publicNewValue.toBitVector();
+        const bit_vector h_S_bits = h_S.toBitVector();
+        timer.endPhase(POUR_PHASE_BIT_CONVERSION);
+
+        prover->generate_witness({ patMAC_1, patMAC_2 },
+                                 { patMerkleIdx_1, patMerkleIdx_2 },
+                                 rt_bits,
+                                 new_address_public_keys,
+                                 old_address_secret_keys,
+                                 new_commitment_nonces,
+                                 old_commitment_nonces,
+                                 new_serial_number_nonces,
+                                 old_serial_number_nonces,
+                                 new_coin_values,
+                                 public_old_value,
+                                 public_new_value,
+                                 old_coin_values,
+                                 h_S_bits);
+        timer.endPhase(POUR_PHASE_WITNESS);
+
+        this->proof = prover->prove();
+        timer.endPhase(POUR_PHASE_PROOF);
     } else {
- 	   this->zkSNARK = std::string(1235,'A');
+        this->proof = PourProof();
     }
 
-    unsigned char val_new_1_bytes[ZC_V_SIZE];
-    unsigned char val_new_2_bytes[ZC_V_SIZE];
-    unsigned char nonce_new_1_bytes[ZC_RHO_SIZE];
-    unsigned char nonce_new_2_bytes[ZC_RHO_SIZE];
-    unsigned char rand_new_1_bytes[ZC_R_SIZE];
-    unsigned char rand_new_2_bytes[ZC_R_SIZE];
-
-    convertVectorToBytes(val_new_1_bv, val_new_1_bytes);
-    convertVectorToBytes(val_new_2_bv, val_new_2_bytes);
-    convertVectorToBytes(rand_new_1_bv, rand_new_1_bytes);
-    convertVectorToBytes(rand_new_2_bv, rand_new_2_bytes);
-    convertVectorToBytes(nonce_new_1_bv, nonce_new_1_bytes);
-    convertVectorToBytes(nonce_new_2_bv, nonce_new_2_bytes);
-
-    std::string val_new_1_string(val_new_1_bytes, val_new_1_bytes + ZC_V_SIZE);
-    std::string val_new_2_string(val_new_2_bytes, val_new_2_bytes + ZC_V_SIZE);
-    std::string nonce_new_1_string(nonce_new_1_bytes, nonce_new_1_bytes + ZC_RHO_SIZE);
-    std::string nonce_new_2_string(nonce_new_2_bytes, nonce_new_2_bytes + ZC_RHO_SIZE);
-    std::string rand_new_1_string(rand_new_1_bytes, rand_new_1_bytes + ZC_R_SIZE);
-    std::string rand_new_2_string(rand_new_2_bytes, rand_new_2_bytes + ZC_R_SIZE);
-
     AutoSeededRandomPool prng_1;
     AutoSeededRandomPool prng_2;
 
@@ -351,86 +282,147 @@ void PourTransaction::init(uint16_t version_num,
 
     std::string C_2_string(gEncryptBuf_2, gEncryptBuf_2 + sizeof gEncryptBuf_2 / sizeof gEncryptBuf_2[0]);
     this->ciphertext_2 = C_2_string;
+    timer.endPhase(POUR_PHASE_ENCRYPTION);
+
+    timer.finish();
+}
+
+bool PourTransaction::getVerifierInput(const ZerocashParams& params,
+                                       const std::vector<unsigned char> &pubkeyHash,
+                                       const MerkleRootType &merkleRoot,
+                                       r1cs_primary_input<Fr<ZerocashParams::zerocash_pp> > &input) const
+{
+    return getVerifierInput(params, pubkeyHash, merkleRoot,
+                            this->serialNumber_1.data(), this->serialNumber_2.data(),
+                            this->cm_1.getCommitmentDigest().data(), this->cm_2.getCommitmentDigest().data(),
+                            this->publicOldValue.data(), this->publicNewValue.data(),
+                            this->MAC_1.data(), this->MAC_2.data(),
+                            input);
+}
+
+bool PourTransaction::getVerifierInput(const ZerocashParams& params,
+                                       const std::vector<unsigned char> &pubkeyHash,
+                                       const MerkleRootType &merkleRoot,
+                                       const uint8_t* serialNumber_1,
+                                       const uint8_t* serialNumber_2,
+                                       const uint8_t* cm_1,
+                                       const uint8_t* cm_2,
+                                       const uint8_t* publicOldValue,
+                                       const uint8_t* publicNewValue,
+                                       const uint8_t* MAC_1,
+                                       const uint8_t* MAC_2,
+                                       r1cs_primary_input<Fr<ZerocashParams::zerocash_pp> > &input)
+{
+	if (merkleRoot.size() != ZC_ROOT_SIZE) { return false; }
+	if (pubkeyHash.size() != ZC_H_SIZE)	{ return false; }
+
+    // The public inputs in the order the Pour gadget packs them:
+    // rt || sn_1 || sn_2 || cm_1 || cm_2 || v_pub_old || v_pub_new || h_S || h_1 || h_2
+    unsigned char packed[ZC_ROOT_SIZE + 2 * ZC_SN_SIZE + 2 * ZC_CM_SIZE + 2 * ZC_V_SIZE + 3 * ZC_H_SIZE];
+    unsigned char* out = packed;
+    memcpy(out, &merkleRoot[0], ZC_ROOT_SIZE);
+    out += ZC_ROOT_SIZE;
+    for (const uint8_t* sn : { serialNumber_1, serialNumber_2 }) {
+        memcpy(out, sn, ZC_SN_SIZE);
+        out += ZC_SN_SIZE;
+    }
+    for (const uint8_t* cm : { cm_1, cm_2 }) {
+        memcpy(out, cm, ZC_CM_SIZE);
+        out += ZC_CM_SIZE;
+    }
+    for (const uint8_t* v : { publicOldValue, publicNewValue }) {
+        memcpy(out, v, ZC_V_SIZE);
+        out += ZC_V_SIZE;
+    }
+
+    SHA256_CTX sha256;
+    SHA256_Init(&sha256);
+    SHA256_Update(&sha256, &pubkeyHash[0], ZC_H_SIZE);
+    SHA256_Final(out, &sha256);
+    out += ZC_H_SIZE;
+
+    for (const uint8_t* mac : { MAC_1, MAC_2 }) {
+        memcpy(out, mac, ZC_H_SIZE);
+        out += ZC_H_SIZE;
+    }
+
+    zerocash_pour_ppzksnark_primary_input<ZerocashParams::zerocash_pp>(params.getVerificationKey(), packed, input);
+    return true;
 }
 
-bool PourTransaction::verify(ZerocashParams& params,
-                             std::vector<unsigned char> &pubkeyHash,
+bool PourTransaction::verify(const ZerocashParams& params,
+                             const std::vector<unsigned char> &pubkeyHash,
                              const MerkleRootType &merkleRoot) const
 {
 	if(this->version == 0){
 		return true;
 	}
 
-    zerocash_pour_proof<ZerocashParams::zerocash_pp> proof_SNARK;
-    std::stringstream ss;
-    ss.str(this->zkSNARK);
-    ss >> proof_SNARK;
+    r1cs_primary_input<Fr<ZerocashParams::zerocash_pp> > input;
+    if (!this->getVerifierInput(params, pubkeyHash, merkleRoot, input)) {
+        return false;
+    }
 
-	if (merkleRoot.size() != ZC_ROOT_SIZE) { return false; }
-	if (pubkeyHash.size() != ZC_H_SIZE)	{ return false; }
-	if (this->serialNumber_1.size() != ZC_SN_SIZE)	{ return false; }
-	if (this->serialNumber_2.size() != ZC_SN_SIZE)	{ return false; }
-	if (this->publicOldValue.size() != ZC_V_SIZE) { return false; }
-	if (this->publicNewValue.size() != ZC_V_SIZE) { return false; }
-	if (this->MAC_1.size() != ZC_H_SIZE)	{ return false; }
-	if (this->MAC_2.size() != ZC_H_SIZE)	{ return false; }
-
-    std::vector<bool> root_bv(ZC_ROOT_SIZE * 8);
-    std::vector<bool> sn_old_1_bv(ZC_SN_SIZE * 8);
-    std::vector<bool> sn_old_2_bv(ZC_SN_SIZE * 8);
-    std::vector<bool> cm_new_1_bv(ZC_CM_SIZE * 8);
-    std::vector<bool> cm_new_2_bv(ZC_CM_SIZE * 8);
-    std::vector<bool> val_old_pub_bv(ZC_V_SIZE * 8);
-    std::vector<bool> val_new_pub_bv(ZC_V_SIZE * 8);
-    std::vector<bool> MAC_1_bv(ZC_H_SIZE * 8);
-    std::vector<bool> MAC_2_bv(ZC_H_SIZE * 8);
-
-    convertBytesVectorToVector(merkleRoot, root_bv);
-    convertBytesVectorToVector(this->serialNumber_1, sn_old_1_bv);
-    convertBytesVectorToVector(this->serialNumber_2, sn_old_2_bv);
-    convertBytesVectorToVector(this->cm_1.getCommitmentValue(), cm_new_1_bv);
-    convertBytesVectorToVector(this->cm_2.getCommitmentValue(), cm_new_2_bv);
-    convertBytesVectorToVector(this->publicOldValue, val_old_pub_bv);
-    convertBytesVectorToVector(this->publicNewValue, val_new_pub_bv);
-    convertBytesVectorToVector(this->MAC_1, MAC_1_bv);
-    convertBytesVectorToVector(this->MAC_2, MAC_2_bv);
-
-    unsigned char h_S_bytes[ZC_H_SIZE];
-    unsigned char pubkeyHash_bytes[ZC_H_SIZE];
-    convertBytesVectorToBytes(pubkeyHash, pubkeyHash_bytes);
-    SHA256_CTX sha256;
-    SHA256_Init(&sha256);
-    SHA256_Update(&sha256, pubkeyHash_bytes, ZC_H_SIZE);
-    SHA256_Final(h_S_bytes, &sha256);
-
-    std::vector<bool> h_S_internal(ZC_H_SIZE * 8);
-    convertBytesToVector(h_S_bytes, h_S_internal);
-    h_S_internal.erase(h_S_internal.end()-2, h_S_internal.end());
-    h_S_internal.insert(h_S_internal.begin(), 0);
-    h_S_internal.insert(h_S_internal.begin(), 1);
-
-    std::vector<bool> h_S_bv(ZC_H_SIZE * 8);
-    convertBytesToVector(h_S_bytes, h_S_bv);
-
-    bool snark_result = zerocash_pour_ppzksnark_verifier<ZerocashParams::zerocash_pp>(params.getVerificationKey(),
-                                                                                      root_bv,
-                                                                                      { sn_old_1_bv, sn_old_2_bv },
-                                                                                      { cm_new_1_bv, cm_new_2_bv },
-                                                                                      val_old_pub_bv,
-                                                                                      val_new_pub_bv,
-                                                                                      h_S_bv,
-                                                                                      { MAC_1_bv, MAC_2_bv },
-                                                                                      proof_SNARK);
-
-    return snark_result;
+    return zerocash_pour_ppzksnark_online_verifier<ZerocashParams::zerocash_pp>(params.getProcessedVerificationKey(), input, this->proof);
 }
 
-const std::vector<unsigned char>& PourTransaction::getSpentSerial1() const{
-	return this->serialNumber_1;
+bool PourTransaction::verifyBatch(const ZerocashParams& params,
+                                  const std::vector<const PourTransaction*> &txs,
+                                  const std::vector<std::vector<unsigned char> > &pubkeyHashes,
+                                  const std::vector<MerkleRootType> &merkleRoots,
+                                  std::vector<size_t> &failed)
+{
+    if (pubkeyHashes.size() != txs.size() || merkleRoots.size() != txs.size()) {
+        throw std::invalid_argument("verifyBatch: need one public key hash and one merkle root per transaction");
+    }
+
+    failed.clear();
+
+    // Transactions with a proof to check, and their positions in txs.
+    std::vector<r1cs_primary_input<Fr<ZerocashParams::zerocash_pp> > > inputs;
+    std::vector<zerocash_pour_proof<ZerocashParams::zerocash_pp> > proofs;
+    std::vector<size_t> positions;
+    inputs.reserve(txs.size());
+    proofs.reserve(txs.size());
+    positions.reserve(txs.size());
+
+    for (size_t i = 0; i < txs.size(); i++) {
+        if (txs[i]->version == 0) {
+            continue;
+        }
+
+        r1cs_primary_input<Fr<ZerocashParams::zerocash_pp> > input;
+        if (!txs[i]->getVerifierInput(params, pubkeyHashes[i], merkleRoots[i], input)) {
+            failed.push_back(i);
+            continue;
+        }
+
+        inputs.push_back(std::move(input));
+        proofs.push_back(txs[i]->proof);
+        positions.push_back(i);
+    }
+
+    std::vector<size_t> failed_proofs;
+    zerocash_pour_ppzksnark_batch_verifier<ZerocashParams::zerocash_pp>(params.getVerificationKey(),
+                                                                        params.getProcessedVerificationKey(),
+                                                                        inputs,
+                                                                        proofs,
+                                                                        failed_proofs);
+
+    for (size_t j : failed_proofs) {
+        failed.push_back(positions[j]);
+    }
+    std::sort(failed.begin(), failed.end());
+
+    return failed.empty();
 }
 
-const std::vector<unsigned char>& PourTransaction::getSpentSerial2() const{
-	return this->serialNumber_2;
+std::vector<unsigned char> PourTransaction::getSpentSerial1() const{
+	return this->serialNumber_1.toBytesVector();
+}
+
+std::vector<unsigned char> PourTransaction::getSpentSerial2() const{
+	return this->serialNumber_2.toBytesVector();
 }
 
 const std::string& PourTransaction::getCiphertext1() const {
@@ -444,23 +436,90 @@ const std::string& PourTransaction::getCiphertext2() const {
 /**
  * Returns the hash of the first new coin commitment  output  by this Pour.
  */
-const CoinCommitmentValue& PourTransaction::getNewCoinCommitmentValue1() const{
+CoinCommitmentValue PourTransaction::getNewCoinCommitmentValue1() const{
 	return this->cm_1.getCommitmentValue();
 }
 
 /**
  * Returns the hash of the second new coin  commitment  output  by this Pour.
  */
-const CoinCommitmentValue& PourTransaction::getNewCoinCommitmentValue2() const{
+CoinCommitmentValue PourTransaction::getNewCoinCommitmentValue2() const{
 	return this->cm_2.getCommitmentValue();
 }
 
+uint16_t PourTransaction::getVersion() const {
+    return this->version;
+}
+
 uint64_t PourTransaction::getPublicValueIn() const{
-    return convertBytesVectorToInt(this->publicOldValue);
+    return this->publicOldValue.toInt();
 }
 
 uint64_t PourTransaction::getPublicValueOut() const{
-	return convertBytesVectorToInt(this->publicNewValue);
+	return this->publicNewValue.toInt();
+}
+
+void PourTransaction::serialize(uint8_t* out) const {
+    if (this->ciphertext_1.size() != ZC_C_SIZE || this->ciphertext_2.size() != ZC_C_SIZE) {
+        throw std::logic_error("PourTransaction::serialize: the transaction has not been built");
+    }
+
+    out[0] = this->version >> 8;
+    out[1] = this->version & 0xff;
+    out += ZC_TX_VERSION_SIZE;
+
+    for (const Bits<64>* v : { &this->publicOldValue, &this->publicNewValue }) {
+        memcpy(out, v->data(), ZC_V_SIZE);
+        out += ZC_V_SIZE;
+    }
+    for (const Digest256* d : { &this->serialNumber_1, &this->serialNumber_2,
+                                &this->cm_1.getCommitmentDigest(), &this->cm_2.getCommitmentDigest(),
+                                &this->MAC_1, &this->MAC_2 }) {
+        memcpy(out, d->data(), Digest256::BYTES);
+        out += Digest256::BYTES;
+    }
+
+    if (this->version > 0) {
+        serializePourProof(this->proof, out);
+    } else {
+        memset(out, 0, ZC_POUR_PROOF_SIZE);
+    }
+    out += ZC_POUR_PROOF_SIZE;
+
+    memcpy(out, this->ciphertext_1.data(), ZC_C_SIZE);
+    memcpy(out + ZC_C_SIZE, this->ciphertext_2.data(), ZC_C_SIZE);
+}
+
+void PourTransaction::deserialize(const uint8_t* in) {
+    const uint16_t version_num = (in[0] << 8) | in[1];
+    if (version_num == 0) {
+        throw std::invalid_argument("PourTransaction::deserialize: version 0 pours carry no proof");
+    }
+    const uint8_t* proof_in = in + ZC_TX_VERSION_SIZE + 2 * ZC_V_SIZE + 6 * Digest256::BYTES;
+
+    // Decode the proof first, so that nothing changes if it is invalid.
+    PourProof proof_decoded = deserializePourProof(proof_in);
+
+    this->version = version_num;
+    in += ZC_TX_VERSION_SIZE;
+
+    this->publicOldValue = Bits<64>(in);
+    in += ZC_V_SIZE;
+    this->publicNewValue = Bits<64>(in);
+    in += ZC_V_SIZE;
+
+    for (Digest256* d : { &this->serialNumber_1, &this->serialNumber_2,
+                          &this->cm_1.commitmentValue, &this->cm_2.commitmentValue,
+                          &this->MAC_1, &this->MAC_2 }) {
+        *d = Digest256(in);
+        in += Digest256::BYTES;
+    }
+
+    this->proof = std::move(proof_decoded);
+    in += ZC_POUR_PROOF_SIZE;
+
+    this->ciphertext_1.assign((const char*) in, ZC_C_SIZE);
+    this->ciphertext_2.assign((const char*) in + ZC_C_SIZE, ZC_C_SIZE);
 }
 
 } /* namespace libzerocash */
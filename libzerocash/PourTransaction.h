@@ -17,6 +17,9 @@
 #include "Zerocash.h"
 #include "PourInput.h"
 #include "PourOutput.h"
+#include "PourMetrics.h"
+#include "PourProof.h"
+#include <cstdint>
 #include <stdexcept>
 
 typedef std::vector<unsigned char> CoinCommitmentValue;
@@ -26,6 +29,9 @@ namespace libzerocash {
 /***************************** Pour transaction ******************************/
 
 class PourTransaction {
+
+friend class PourTransactionView;
+
 public:
     PourTransaction();
     PourTransaction(ZerocashParams& params,
@@ -36,6 +42,22 @@ public:
                                  uint64_t vpub_old,
                                  uint64_t vpub_new
                                 );
+    /**
+     * As above, but proves with the given prover context rather than the one
+     * owned by a ZerocashParams. A prover context is not thread-safe, but
+     * pours using different contexts over the same proving key may be built
+     * at the same time (see PourBatchBuilder). The phases of building the
+     * pour are reported to metrics, if it is not NULL.
+     */
+    PourTransaction(zerocash_pour_prover_context<ZerocashParams::zerocash_pp>& prover,
+                    int tree_depth,
+                    const std::vector<unsigned char>& pubkeyHash,
+                    const MerkleRootType& rt,
+                    std::vector<PourInput> inputs,
+                    std::vector<PourOutput> outputs,
+                    uint64_t vpub_old,
+                    uint64_t vpub_new,
+                    PourMetrics* metrics = NULL);
     /**
      * Generates a transaction pouring the funds  in  two existing coins into two new coins and optionally
      * converting some of those funds back into the base currency.
@@ -98,17 +120,39 @@ public:
     /**
      * Verifies the pour transaction.
      *
+     * This only reads params and the transaction, so any number of threads
+     * may verify at once against the same ZerocashParams, provided libsnark's
+     * profiling counters are turned off (inhibit_profiling_counters), as
+     * PourVerifier does: libsnark's profiling keeps global state.
+     *
      * @param params the cryptographic parameters used to verify the proofs.
      * @param pubkeyHash the hash of a public key that we verify is bound to the transaction
      * @param merkleRoot the root of the merkle tree the coins were in.
      * @return ture if correct, false otherwise.
      */
-    bool verify(ZerocashParams& params,
-                std::vector<unsigned char> &pubkeyHash,
+    bool verify(const ZerocashParams& params,
+                const std::vector<unsigned char> &pubkeyHash,
                 const MerkleRootType &merkleRoot) const;
 
-    const std::vector<unsigned char>& getSpentSerial1() const;
-    const std::vector<unsigned char>& getSpentSerial2() const;
+    /**
+     * Verifies a batch of pour transactions. The zkSNARK proofs are checked
+     * together, which is much cheaper than verifying them one at a time.
+     *
+     * @param params the cryptographic parameters used to verify the proofs.
+     * @param txs the transactions to verify.
+     * @param pubkeyHashes the public key hash bound to each transaction.
+     * @param merkleRoots the root of the merkle tree for each transaction.
+     * @param failed set to the (increasing) indices in txs of the transactions that do not verify.
+     * @return true if all transactions verify, false otherwise.
+     */
+    static bool verifyBatch(const ZerocashParams& params,
+                            const std::vector<const PourTransaction*> &txs,
+                            const std::vector<std::vector<unsigned char> > &pubkeyHashes,
+                            const std::vector<MerkleRootType> &merkleRoots,
+                            std::vector<size_t> &failed);
+
+    std::vector<unsigned char> getSpentSerial1() const;
+    std::vector<unsigned char> getSpentSerial2() const;
     const std::string& getCiphertext1() const;
     const std::string& getCiphertext2() const;
 
@@ -117,33 +161,101 @@ public:
      *
      * @return the coin hash
      */
-    const CoinCommitmentValue& getNewCoinCommitmentValue1() const;
+    CoinCommitmentValue getNewCoinCommitmentValue1() const;
 
     /**
      * Returns the hash of the second new coin generated by this Pour.
      *
      * @return the coin hash
      */
-    const CoinCommitmentValue& getNewCoinCommitmentValue2() const;
+    CoinCommitmentValue getNewCoinCommitmentValue2() const;
+
+    /* Version 0 pours carry no proof, and pass verify unchecked. */
+    uint16_t getVersion() const;
 
     uint64_t getPublicValueIn() const;
 
     uint64_t getPublicValueOut() const;
 
+    /**
+     * Writes the transaction to out, in ZC_TX_POUR_SIZE bytes:
+     *
+     *   version (2 bytes, big-endian) || v_pub_old || v_pub_new ||
+     *   sn_1 || sn_2 || cm_1 || cm_2 || h_1 || h_2 || proof || C_1 || C_2
+     *
+     * where the proof is encoded as by serializePourProof, and is all zero for
+     * version 0 transactions, which carry none. Throws std::logic_error if the
+     * transaction has not been built.
+     */
+    void serialize(uint8_t* out) const;
+
+    /**
+     * Reads a transaction written by serialize, decoding the proof once so
+     * that verifying it needs no further parsing. Throws
+     * std::invalid_argument, leaving the transaction unchanged, if the proof
+     * is not a valid encoding or if the version is 0: version 0 pours carry
+     * no proof and pass verify, so they are never taken from the wire.
+     */
+    void deserialize(const uint8_t* in);
+
 
 private:
 
-    std::vector<unsigned char>  publicOldValue;      // public input value of the Pour transaction
-    std::vector<unsigned char>  publicNewValue;     // public output value of the Pour transaction
-    std::vector<unsigned char>  serialNumber_1;     // serial number of input (old) coin #1
-    std::vector<unsigned char>  serialNumber_2;     // serial number of input (old) coin #1
+    /* prover may be NULL for version 0 transactions, which carry no proof;
+     * metrics may be NULL. */
+    void init(uint16_t version_num,
+              zerocash_pour_prover_context<ZerocashParams::zerocash_pp>* prover,
+              PourMetrics* metrics,
+              const MerkleRootType& roott,
+              const Coin& c_1_old,
+              const Coin& c_2_old,
+              const Address& addr_1_old,
+              const Address& addr_2_old,
+              const size_t patMerkleIdx_1,
+              const size_t patMerkleIdx_2,
+              const merkle_authentication_path& path_1,
+              const merkle_authentication_path& path_2,
+              const PublicAddress& addr_1_new,
+              const PublicAddress& addr_2_new,
+              uint64_t v_pub_in,
+              uint64_t v_pub_out,
+              const std::vector<unsigned char>& pubkeyHash,
+              const Coin& c_1_new,
+              const Coin& c_2_new);
+
+    /* Checks the public inputs and maps them to what the zkSNARK verifier
+     * expects. Returns false if the transaction is rejected before the proof
+     * needs to be checked. */
+    bool getVerifierInput(const ZerocashParams& params,
+                          const std::vector<unsigned char> &pubkeyHash,
+                          const MerkleRootType &merkleRoot,
+                          r1cs_primary_input<Fr<ZerocashParams::zerocash_pp> > &input) const;
+
+    /* As above, for public inputs given as byte strings. */
+    static bool getVerifierInput(const ZerocashParams& params,
+                                 const std::vector<unsigned char> &pubkeyHash,
+                                 const MerkleRootType &merkleRoot,
+                                 const uint8_t* serialNumber_1,
+                                 const uint8_t* serialNumber_2,
+                                 const uint8_t* cm_1,
+                                 const uint8_t* cm_2,
+                                 const uint8_t* publicOldValue,
+                                 const uint8_t* publicNewValue,
+                                 const uint8_t* MAC_1,
+                                 const uint8_t* MAC_2,
+                                 r1cs_primary_input<Fr<ZerocashParams::zerocash_pp> > &input);
+
+    Bits<64>                    publicOldValue;     // public input value of the Pour transaction
+    Bits<64>                    publicNewValue;     // public output value of the Pour transaction
+    Digest256                   serialNumber_1;     // serial number of input (old) coin #1
+    Digest256                   serialNumber_2;     // serial number of input (old) coin #1
     CoinCommitment              cm_1;               // coin commitment for output coin #1
     CoinCommitment              cm_2;               // coin commitment for output coin #2
-    std::vector<unsigned char>  MAC_1;              // first MAC    (h_1 in paper notation)
-    std::vector<unsigned char>  MAC_2;              // second MAC   (h_2 in paper notation)
+    Digest256                   MAC_1;              // first MAC    (h_1 in paper notation)
+    Digest256                   MAC_2;              // second MAC   (h_2 in paper notation)
     std::string                 ciphertext_1;       // ciphertext #1
     std::string                 ciphertext_2;       // ciphertext #2
-    std::string                 zkSNARK;            // contents of the zkSNARK proof itself
+    PourProof                   proof;              // the zkSNARK proof itself
     uint16_t                    version;            // version for the Pour transaction
 };
 
@@ -0,0 +1,73 @@
+/** @file
+ *****************************************************************************
+
+ Implementation of interfaces for the class PourTransactionView.
+
+ See PourTransactionView.h .
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include "PourTransactionView.h"
+#include "PourTransaction.h"
+#include "PourProof.h"
+
+#include "libsnark/zk_proof_systems/ppzksnark/r1cs_ppzksnark/r1cs_ppzksnark.hpp"
+#include "zerocash_pour_ppzksnark/zerocash_pour_ppzksnark.hpp"
+
+namespace libzerocash {
+
+static uint64_t readBigEndian(const uint8_t* in, size_t length) {
+    uint64_t val = 0;
+    for (size_t i = 0; i < length; i++) {
+        val = (val << 8) | in[i];
+    }
+    return val;
+}
+
+uint16_t PourTransactionView::getVersion() const {
+    return readBigEndian(this->bytes, ZC_TX_VERSION_SIZE);
+}
+
+uint64_t PourTransactionView::getPublicValueIn() const {
+    return readBigEndian(this->bytes + VALUE_OLD_OFFSET, ZC_V_SIZE);
+}
+
+uint64_t PourTransactionView::getPublicValueOut() const {
+    return readBigEndian(this->bytes + VALUE_NEW_OFFSET, ZC_V_SIZE);
+}
+
+bool PourTransactionView::verify(const ZerocashParams& params,
+                                 const std::vector<unsigned char> &pubkeyHash,
+                                 const MerkleRootType &merkleRoot) const
+{
+    // Version 0 pours carry no proof; as for PourTransaction::deserialize,
+    // one from a buffer is never taken as valid.
+    if (this->getVersion() == 0) {
+        return false;
+    }
+
+    // Kept between calls, so that its storage is only allocated once.
+    static thread_local r1cs_primary_input<Fr<ZerocashParams::zerocash_pp> > input;
+
+    if (!PourTransaction::getVerifierInput(params, pubkeyHash, merkleRoot,
+                                           this->getSpentSerial1(), this->getSpentSerial2(),
+                                           this->getNewCoinCommitmentValue1(), this->getNewCoinCommitmentValue2(),
+                                           this->bytes + VALUE_OLD_OFFSET, this->bytes + VALUE_NEW_OFFSET,
+                                           this->getMAC1(), this->getMAC2(),
+                                           input)) {
+        return false;
+    }
+
+    PourProof proof;
+    if (!deserializePourProof(this->getProof(), proof)) {
+        return false;
+    }
+
+    return zerocash_pour_ppzksnark_online_verifier<ZerocashParams::zerocash_pp>(params.getProcessedVerificationKey(), input, proof);
+}
+
+} /* namespace libzerocash */
@@ -0,0 +1,98 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of interfaces for the class PourTransactionView.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef POURTRANSACTIONVIEW_H_
+#define POURTRANSACTIONVIEW_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Zerocash.h"
+#include "ZerocashParams.h"
+
+namespace libzerocash {
+
+/************************** Pour transaction view ****************************/
+
+/*
+ * A read-only view of a pour transaction in the encoding written by
+ * PourTransaction::serialize, such as one in a network buffer. Nothing is
+ * copied out of the buffer: the fields are returned as pointers into it, and
+ * verify reads the public inputs and the proof from it directly. The buffer
+ * must hold ZC_TX_POUR_SIZE bytes and outlive the view.
+ */
+class PourTransactionView {
+public:
+    explicit PourTransactionView(const uint8_t* data) : bytes(data) { }
+
+    uint16_t getVersion() const;
+    uint64_t getPublicValueIn() const;
+    uint64_t getPublicValueOut() const;
+
+    /* ZC_SN_SIZE bytes each. */
+    const uint8_t* getSpentSerial1() const { return this->bytes + SERIAL_1_OFFSET; }
+    const uint8_t* getSpentSerial2() const { return this->bytes + SERIAL_2_OFFSET; }
+
+    /* ZC_CM_SIZE bytes each. */
+    const uint8_t* getNewCoinCommitmentValue1() const { return this->bytes + COMMITMENT_1_OFFSET; }
+    const uint8_t* getNewCoinCommitmentValue2() const { return this->bytes + COMMITMENT_2_OFFSET; }
+
+    /* ZC_H_SIZE bytes each. */
+    const uint8_t* getMAC1() const { return this->bytes + MAC_1_OFFSET; }
+    const uint8_t* getMAC2() const { return this->bytes + MAC_2_OFFSET; }
+
+    /* ZC_POUR_PROOF_SIZE bytes, as written by serializePourProof. */
+    const uint8_t* getProof() const { return this->bytes + PROOF_OFFSET; }
+
+    /* ZC_C_SIZE bytes each. */
+    const uint8_t* getCiphertext1() const { return this->bytes + CIPHERTEXT_1_OFFSET; }
+    const uint8_t* getCiphertext2() const { return this->bytes + CIPHERTEXT_2_OFFSET; }
+
+    const uint8_t* data() const { return this->bytes; }
+    static size_t size() { return ZC_TX_POUR_SIZE; }
+
+    /**
+     * Verifies the pour transaction, as PourTransaction::verify does, except
+     * that version 0 pours, which carry no proof, and invalid encodings of
+     * the proof fail verification. Besides what the
+     * zkSNARK verifier itself allocates, this allocates nothing after the
+     * first call on each thread.
+     *
+     * @param params the cryptographic parameters used to verify the proofs.
+     * @param pubkeyHash the hash of a public key that we verify is bound to the transaction
+     * @param merkleRoot the root of the merkle tree the coins were in.
+     * @return true if correct, false otherwise.
+     */
+    bool verify(const ZerocashParams& params,
+                const std::vector<unsigned char> &pubkeyHash,
+                const MerkleRootType &merkleRoot) const;
+
+private:
+    enum {
+        VALUE_OLD_OFFSET = ZC_TX_VERSION_SIZE,
+        VALUE_NEW_OFFSET = VALUE_OLD_OFFSET + ZC_V_SIZE,
+        SERIAL_1_OFFSET = VALUE_NEW_OFFSET + ZC_V_SIZE,
+        SERIAL_2_OFFSET = SERIAL_1_OFFSET + ZC_SN_SIZE,
+        COMMITMENT_1_OFFSET = SERIAL_2_OFFSET + ZC_SN_SIZE,
+        COMMITMENT_2_OFFSET = COMMITMENT_1_OFFSET + ZC_CM_SIZE,
+        MAC_1_OFFSET = COMMITMENT_2_OFFSET + ZC_CM_SIZE,
+        MAC_2_OFFSET = MAC_1_OFFSET + ZC_H_SIZE,
+        PROOF_OFFSET = MAC_2_OFFSET + ZC_H_SIZE,
+        CIPHERTEXT_1_OFFSET = PROOF_OFFSET + ZC_POUR_PROOF_SIZE,
+        CIPHERTEXT_2_OFFSET = CIPHERTEXT_1_OFFSET + ZC_C_SIZE
+    };
+
+    const uint8_t* bytes;
+};
+
+} /* namespace libzerocash */
+
+#endif /* POURTRANSACTIONVIEW_H_ */
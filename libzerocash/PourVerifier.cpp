@@ -0,0 +1,112 @@
+/** @file
+ *****************************************************************************
+
+ Implementation of interfaces for the class PourVerifier.
+
+ See PourVerifier.h .
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <algorithm>
+#include <mutex>
+
+#include "common/profiling.hpp"
+
+#include "PourVerifier.h"
+
+namespace libzerocash {
+
+void disableLibsnarkProfiling()
+{
+    static std::once_flag once;
+    std::call_once(once, [] {
+        inhibit_profiling_info = true;
+        inhibit_profiling_counters = true;
+    });
+}
+
+PourVerifier::PourVerifier(const ZerocashParams& params, unsigned int num_threads) :
+    params(params), stopping(false)
+{
+    disableLibsnarkProfiling();
+
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < num_threads; i++) {
+        this->workers.emplace_back(&PourVerifier::work, this);
+    }
+}
+
+PourVerifier::~PourVerifier()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->available.notify_all();
+
+    for (std::thread &t : this->workers) {
+        t.join();
+    }
+}
+
+std::future<bool> PourVerifier::submit(const PourTransaction& tx,
+                                       const std::vector<unsigned char>& pubkeyHash,
+                                       const MerkleRootType& merkleRoot,
+                                       const std::shared_ptr<const std::atomic<bool> >& cancelled)
+{
+    Job job;
+    job.tx = tx;
+    job.pubkeyHash = pubkeyHash;
+    job.merkleRoot = merkleRoot;
+    job.cancelled = cancelled;
+    std::future<bool> result = job.result.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->jobs.push_back(std::move(job));
+    }
+    this->available.notify_one();
+
+    return result;
+}
+
+unsigned int PourVerifier::getNumThreads() const
+{
+    return this->workers.size();
+}
+
+void PourVerifier::work()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->available.wait(lock, [this] { return this->stopping || !this->jobs.empty(); });
+            if (this->jobs.empty()) {
+                return;
+            }
+            job = std::move(this->jobs.front());
+            this->jobs.pop_front();
+        }
+
+        if (job.cancelled && *job.cancelled) {
+            job.result.set_value(false);
+            continue;
+        }
+
+        try {
+            job.result.set_value(job.tx.verify(this->params, job.pubkeyHash, job.merkleRoot));
+        } catch (...) {
+            job.result.set_exception(std::current_exception());
+        }
+    }
+}
+
+} /* namespace libzerocash */
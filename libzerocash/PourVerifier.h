@@ -0,0 +1,96 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of interfaces for the class PourVerifier.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef POURVERIFIER_H_
+#define POURVERIFIER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "PourTransaction.h"
+#include "ZerocashParams.h"
+
+namespace libzerocash {
+
+/**
+ * Turns off libsnark's profiling counters and output, which live in global
+ * state that is not safe to update from several threads. The switch is made
+ * once, on the first call, and is permanent: profiling stays off for the rest
+ * of the process. Call it before any thread enters libsnark.
+ */
+void disableLibsnarkProfiling();
+
+/**
+ * A pool of worker threads verifying pour transactions against one
+ * ZerocashParams. Transactions are queued with submit(), and each result is
+ * delivered through a future; a transaction that makes verification throw
+ * delivers the exception instead.
+ *
+ * Creating a PourVerifier calls disableLibsnarkProfiling().
+ *
+ * The ZerocashParams must outlive the PourVerifier. Destroying the verifier
+ * waits for the transactions already submitted to be verified.
+ */
+class PourVerifier {
+public:
+    /* num_threads == 0 means one thread per hardware thread. */
+    PourVerifier(const ZerocashParams& params, unsigned int num_threads = 0);
+    ~PourVerifier();
+
+    PourVerifier(const PourVerifier&) = delete;
+    PourVerifier& operator=(const PourVerifier&) = delete;
+
+    /**
+     * Queues a pour transaction for verification.
+     *
+     * @param tx the transaction; it is copied, so it need not outlive the call.
+     * @param pubkeyHash the hash of a public key that we verify is bound to the transaction
+     * @param merkleRoot the root of the merkle tree the coins were in.
+     * @param cancelled if given and set by the time a thread takes the
+     *        transaction, it is not verified and false is delivered; this
+     *        drops the rest of a batch whose outcome is already known.
+     * @return the result of PourTransaction::verify, once it is known.
+     */
+    std::future<bool> submit(const PourTransaction& tx,
+                             const std::vector<unsigned char>& pubkeyHash,
+                             const MerkleRootType& merkleRoot,
+                             const std::shared_ptr<const std::atomic<bool> >& cancelled = nullptr);
+
+    unsigned int getNumThreads() const;
+
+private:
+    struct Job {
+        PourTransaction tx;
+        std::vector<unsigned char> pubkeyHash;
+        MerkleRootType merkleRoot;
+        std::shared_ptr<const std::atomic<bool> > cancelled;
+        std::promise<bool> result;
+    };
+
+    void work();
+
+    const ZerocashParams& params;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::deque<Job> jobs;
+    bool stopping;
+    std::vector<std::thread> workers;
+};
+
+} /* namespace libzerocash */
+
+#endif /* POURVERIFIER_H_ */
@@ -0,0 +1,498 @@
+/** @file
+ *****************************************************************************
+
+ Implementation of interfaces for the class SerialNumberSet.
+
+ See SerialNumberSet.h .
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include "SerialNumberSet.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace libzerocash {
+
+    // The file starts with this header, padded to SET_HEADER_SPACE bytes;
+    // the table follows, SERIAL_SIZE bytes per slot.
+    struct serial_set_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t clean;         // 1 if the file was flushed since it last changed
+        uint64_t capacity;
+        uint64_t count;
+        uint32_t has_zero;
+    };
+
+    static const char SET_MAGIC[8] = { 'Z', 'C', 'S', 'N', 'S', 'E', 'T', 0 };
+    static const uint32_t SET_VERSION = 1;
+    static const uint64_t SET_HEADER_SPACE = 64;
+    static const uint64_t SERIAL_SIZE = Digest256::BYTES;
+    static const uint64_t MIN_CAPACITY = 16;
+
+    // Lookups in containsBatch and insertBatch run this far behind the
+    // prefetches of the slots they will read.
+    static const size_t PREFETCH_DISTANCE = 8;
+
+    static_assert(sizeof(serial_set_header) <= SET_HEADER_SPACE, "serial number set header too large");
+
+    static bool
+    isEmpty(const unsigned char* slot)
+    {
+        for (size_t i = 0; i < SERIAL_SIZE; i++) {
+            if (slot[i] != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static uint64_t
+    nextPowerOfTwo(uint64_t n)
+    {
+        uint64_t p = 1;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    // Puts a serial number known not to be in the table into its first free
+    // slot.
+    static void
+    insertNew(unsigned char* table, uint64_t capacity, const unsigned char* serial, uint64_t slot)
+    {
+        while (!isEmpty(table + slot * SERIAL_SIZE)) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        memcpy(table + slot * SERIAL_SIZE, serial, SERIAL_SIZE);
+    }
+
+    // Maps a new file of the given capacity, holding an empty table.
+    static unsigned char*
+    createTableFile(const std::string &file, int fd, uint64_t capacity, uint64_t &mapSize)
+    {
+        mapSize = SET_HEADER_SPACE + capacity * SERIAL_SIZE;
+        if (ftruncate(fd, mapSize) != 0) {
+            throw std::runtime_error("Could not grow serial number set file " + file);
+        }
+        void *p = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            throw std::runtime_error("Could not map serial number set file " + file);
+        }
+        return (unsigned char*) p;
+    }
+
+    static void
+    writeHeader(unsigned char* map, uint64_t capacity, uint64_t count, bool hasZero, bool clean)
+    {
+        serial_set_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SET_MAGIC, sizeof(SET_MAGIC));
+        header.version = SET_VERSION;
+        header.clean = clean;
+        header.capacity = capacity;
+        header.count = count;
+        header.has_zero = hasZero;
+        memcpy(map, &header, sizeof(header));
+    }
+
+    SerialNumberSet::SerialNumberSet(size_t expectedSize, unsigned bloomBitsPerSerial) :
+        fd(-1), map(NULL), mapSize(0), table(NULL), capacity(capacityFor(expectedSize)),
+        count(0), hasZero(false), dirty(false),
+        bloomBitsPerSerial(bloomBitsPerSerial), bloomHashes(0), bloomMask(0)
+    {
+        this->memoryTable.assign(this->capacity * SERIAL_SIZE, 0);
+        this->table = this->memoryTable.data();
+        this->resetBloom();
+    }
+
+    SerialNumberSet::SerialNumberSet(const std::string &path, size_t expectedSize, unsigned bloomBitsPerSerial) :
+        path(path), fd(-1), map(NULL), mapSize(0), table(NULL), capacity(0),
+        count(0), hasZero(false), dirty(false),
+        bloomBitsPerSerial(bloomBitsPerSerial), bloomHashes(0), bloomMask(0)
+    {
+        this->fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (this->fd < 0) {
+            throw std::runtime_error("Could not open serial number set file " + path);
+        }
+
+        try {
+            struct stat st;
+            if (fstat(this->fd, &st) != 0) {
+                throw std::runtime_error("Could not stat serial number set file " + path);
+            }
+
+            if (st.st_size == 0) {
+                this->capacity = capacityFor(expectedSize);
+                this->map = createTableFile(path, this->fd, this->capacity, this->mapSize);
+                writeHeader(this->map, this->capacity, 0, false, true);
+                if (msync(this->map, SET_HEADER_SPACE, MS_SYNC) != 0) {
+                    throw std::runtime_error("Could not write serial number set file " + path);
+                }
+            } else {
+                if ((uint64_t) st.st_size < SET_HEADER_SPACE) {
+                    throw std::runtime_error("Serial number set file " + path + " is truncated");
+                }
+
+                this->mapSize = st.st_size;
+                void *p = mmap(NULL, this->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+                if (p == MAP_FAILED) {
+                    throw std::runtime_error("Could not map serial number set file " + path);
+                }
+                this->map = (unsigned char*) p;
+
+                serial_set_header header;
+                memcpy(&header, this->map, sizeof(header));
+                if (memcmp(header.magic, SET_MAGIC, sizeof(SET_MAGIC)) != 0 || header.version != SET_VERSION) {
+                    throw std::runtime_error(path + " is not a serial number set file");
+                }
+                if (!header.clean) {
+                    throw std::runtime_error("Serial number set file " + path + " was not closed cleanly");
+                }
+                if (header.capacity < MIN_CAPACITY || (header.capacity & (header.capacity - 1)) != 0 ||
+                    header.count > header.capacity / 2 + 1 ||
+                    SET_HEADER_SPACE + header.capacity * SERIAL_SIZE != this->mapSize) {
+                    throw std::runtime_error("Serial number set file " + path + " is corrupt");
+                }
+
+                this->capacity = header.capacity;
+                this->count = header.count;
+                this->hasZero = header.has_zero;
+            }
+
+            this->table = this->map + SET_HEADER_SPACE;
+            this->resetBloom();
+        } catch (...) {
+            this->close();
+            throw;
+        }
+    }
+
+    SerialNumberSet::~SerialNumberSet()
+    {
+        try {
+            this->flush();
+        } catch (...) {
+            // The file stays marked as not closed cleanly; there is nobody
+            // left to tell.
+        }
+        this->close();
+    }
+
+    void
+    SerialNumberSet::close()
+    {
+        if (this->map != NULL) {
+            munmap(this->map, this->mapSize);
+            this->map = NULL;
+        }
+        if (this->fd >= 0) {
+            ::close(this->fd);
+            this->fd = -1;
+        }
+    }
+
+    // Serial numbers are uniformly random, so any 8 of their bytes make a
+    // good hash.
+    uint64_t
+    SerialNumberSet::word(const unsigned char* serial, size_t i)
+    {
+        uint64_t w;
+        memcpy(&w, serial + 8 * i, sizeof(w));
+        return w;
+    }
+
+    // The smallest capacity that keeps the table at most half full.
+    uint64_t
+    SerialNumberSet::capacityFor(size_t expectedSize)
+    {
+        return std::max(MIN_CAPACITY, nextPowerOfTwo(2 * (uint64_t) expectedSize));
+    }
+
+    uint64_t
+    SerialNumberSet::slotFor(const unsigned char* serial) const
+    {
+        return word(serial, 0) & (this->capacity - 1);
+    }
+
+    // Finds serial, which must not be zero. If it is not there, slot is set
+    // to the empty slot where it would go.
+    bool
+    SerialNumberSet::find(const unsigned char* serial, uint64_t &slot) const
+    {
+        uint64_t i = this->slotFor(serial);
+        while (true) {
+            const unsigned char* p = this->table + i * SERIAL_SIZE;
+            if (memcmp(p, serial, SERIAL_SIZE) == 0) {
+                slot = i;
+                return true;
+            }
+            if (isEmpty(p)) {
+                slot = i;
+                return false;
+            }
+            i = (i + 1) & (this->capacity - 1);
+        }
+    }
+
+    // The Bloom filter hashes are h1 + i * h2 for two further words of the
+    // serial number (Kirsch and Mitzenmacher), independent of the one that
+    // picks the slot.
+    bool
+    SerialNumberSet::bloomMayContain(const unsigned char* serial) const
+    {
+        if (this->bloom.empty()) {
+            return true;
+        }
+
+        const uint64_t h1 = word(serial, 1);
+        const uint64_t h2 = word(serial, 2) | 1;
+        for (unsigned i = 0; i < this->bloomHashes; i++) {
+            const uint64_t bit = (h1 + i * h2) & this->bloomMask;
+            if (!(this->bloom[bit / 64] & (((uint64_t) 1) << (bit % 64)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void
+    SerialNumberSet::bloomAdd(const unsigned char* serial)
+    {
+        if (this->bloom.empty()) {
+            return;
+        }
+
+        const uint64_t h1 = word(serial, 1);
+        const uint64_t h2 = word(serial, 2) | 1;
+        for (unsigned i = 0; i < this->bloomHashes; i++) {
+            const uint64_t bit = (h1 + i * h2) & this->bloomMask;
+            this->bloom[bit / 64] |= ((uint64_t) 1) << (bit % 64);
+        }
+    }
+
+    // Sizes the Bloom filter for the current capacity and fills it from the
+    // table.
+    void
+    SerialNumberSet::resetBloom()
+    {
+        if (this->bloomBitsPerSerial == 0) {
+            this->bloom.clear();
+            return;
+        }
+
+        const uint64_t bits = std::max((uint64_t) 64, nextPowerOfTwo(this->bloomBitsPerSerial * (this->capacity / 2)));
+        this->bloomMask = bits - 1;
+        this->bloomHashes = std::min(16u, std::max(1u, (unsigned) lround(this->bloomBitsPerSerial * std::log(2.0))));
+        this->bloom.assign(bits / 64, 0);
+
+        for (uint64_t i = 0; i < this->capacity; i++) {
+            const unsigned char* p = this->table + i * SERIAL_SIZE;
+            if (!isEmpty(p)) {
+                this->bloomAdd(p);
+            }
+        }
+    }
+
+    // Moves every serial number into a new table of the given capacity. For
+    // a file, the new table is built in a new file that is then renamed over
+    // the old one, so that the file holds either table, clean, whatever
+    // happens; in effect, growing flushes.
+    void
+    SerialNumberSet::grow(uint64_t newCapacity)
+    {
+        if (this->path.empty()) {
+            std::vector<unsigned char> newTable(newCapacity * SERIAL_SIZE, 0);
+            for (uint64_t i = 0; i < this->capacity; i++) {
+                const unsigned char* p = this->table + i * SERIAL_SIZE;
+                if (!isEmpty(p)) {
+                    insertNew(newTable.data(), newCapacity, p, word(p, 0) & (newCapacity - 1));
+                }
+            }
+            this->memoryTable.swap(newTable);
+            this->table = this->memoryTable.data();
+        } else {
+            const std::string newPath = this->path + ".grow";
+            int newFd = open(newPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (newFd < 0) {
+                throw std::runtime_error("Could not create serial number set file " + newPath);
+            }
+
+            uint64_t newMapSize = 0;
+            unsigned char* newMap = NULL;
+            try {
+                newMap = createTableFile(newPath, newFd, newCapacity, newMapSize);
+                unsigned char* newTable = newMap + SET_HEADER_SPACE;
+                for (uint64_t i = 0; i < this->capacity; i++) {
+                    const unsigned char* p = this->table + i * SERIAL_SIZE;
+                    if (!isEmpty(p)) {
+                        insertNew(newTable, newCapacity, p, word(p, 0) & (newCapacity - 1));
+                    }
+                }
+
+                writeHeader(newMap, newCapacity, this->count, this->hasZero, true);
+                if (msync(newMap, newMapSize, MS_SYNC) != 0 || rename(newPath.c_str(), this->path.c_str()) != 0) {
+                    throw std::runtime_error("Could not write serial number set file " + newPath);
+                }
+            } catch (...) {
+                if (newMap != NULL) {
+                    munmap(newMap, newMapSize);
+                }
+                ::close(newFd);
+                unlink(newPath.c_str());
+                throw;
+            }
+
+            this->close();
+            this->fd = newFd;
+            this->map = newMap;
+            this->mapSize = newMapSize;
+            this->table = newMap + SET_HEADER_SPACE;
+            this->dirty = false;
+        }
+
+        this->capacity = newCapacity;
+        this->resetBloom();
+    }
+
+    // Marks the file as not closed cleanly before its first change since the
+    // last flush.
+    void
+    SerialNumberSet::markDirty()
+    {
+        if (this->path.empty() || this->dirty) {
+            return;
+        }
+
+        writeHeader(this->map, this->capacity, this->count, this->hasZero, false);
+        if (msync(this->map, SET_HEADER_SPACE, MS_SYNC) != 0) {
+            throw std::runtime_error("Could not write serial number set file " + this->path);
+        }
+        this->dirty = true;
+    }
+
+    void
+    SerialNumberSet::flush()
+    {
+        if (this->path.empty() || !this->dirty) {
+            return;
+        }
+
+        if (msync(this->map, this->mapSize, MS_SYNC) != 0) {
+            throw std::runtime_error("Could not write serial number set file " + this->path);
+        }
+        writeHeader(this->map, this->capacity, this->count, this->hasZero, true);
+        if (msync(this->map, SET_HEADER_SPACE, MS_SYNC) != 0) {
+            throw std::runtime_error("Could not write serial number set file " + this->path);
+        }
+        this->dirty = false;
+    }
+
+    bool
+    SerialNumberSet::insert(const Digest256 &serial)
+    {
+        const unsigned char* s = serial.data();
+
+        if (isEmpty(s)) {
+            if (this->hasZero) {
+                return false;
+            }
+            this->markDirty();
+            this->hasZero = true;
+            this->count++;
+            return true;
+        }
+
+        uint64_t slot;
+        if (this->find(s, slot)) {
+            return false;
+        }
+
+        const uint64_t inTable = this->count - this->hasZero;
+        if (2 * (inTable + 1) > this->capacity) {
+            this->grow(2 * this->capacity);
+            this->find(s, slot);
+        }
+
+        this->markDirty();
+        memcpy(this->table + slot * SERIAL_SIZE, s, SERIAL_SIZE);
+        this->count++;
+        this->bloomAdd(s);
+        return true;
+    }
+
+    bool
+    SerialNumberSet::contains(const Digest256 &serial) const
+    {
+        const unsigned char* s = serial.data();
+
+        if (isEmpty(s)) {
+            return this->hasZero;
+        }
+        if (!this->bloomMayContain(s)) {
+            return false;
+        }
+
+        uint64_t slot;
+        return this->find(s, slot);
+    }
+
+    size_t
+    SerialNumberSet::insertBatch(const std::vector<Digest256> &serials, std::vector<bool> &inserted)
+    {
+        // Grow once, up front, to hold the whole batch.
+        const uint64_t needed = capacityFor(this->count + serials.size());
+        if (needed > this->capacity) {
+            this->grow(needed);
+        }
+
+        inserted.assign(serials.size(), false);
+        size_t added = 0;
+        for (size_t i = 0; i < serials.size(); i++) {
+            if (i + PREFETCH_DISTANCE < serials.size()) {
+                __builtin_prefetch(this->table + this->slotFor(serials[i + PREFETCH_DISTANCE].data()) * SERIAL_SIZE);
+            }
+            if (this->insert(serials[i])) {
+                inserted[i] = true;
+                added++;
+            }
+        }
+        return added;
+    }
+
+    bool
+    SerialNumberSet::containsBatch(const std::vector<Digest256> &serials, std::vector<bool> &found) const
+    {
+        found.assign(serials.size(), false);
+        bool any = false;
+        for (size_t i = 0; i < serials.size(); i++) {
+            if (i + PREFETCH_DISTANCE < serials.size()) {
+                const unsigned char* ahead = serials[i + PREFETCH_DISTANCE].data();
+                if (!this->bloom.empty()) {
+                    __builtin_prefetch(&this->bloom[(word(ahead, 1) & this->bloomMask) / 64]);
+                }
+                __builtin_prefetch(this->table + this->slotFor(ahead) * SERIAL_SIZE);
+            }
+            if (this->contains(serials[i])) {
+                found[i] = true;
+                any = true;
+            }
+        }
+        return any;
+    }
+
+} /* namespace libzerocash */
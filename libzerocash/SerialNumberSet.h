@@ -0,0 +1,121 @@
+/** @file
+ *****************************************************************************
+
+ Declaration of interfaces for the class SerialNumberSet.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef SERIALNUMBERSET_H_
+#define SERIALNUMBERSET_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "utils/Bits.h"
+
+namespace libzerocash {
+
+/***************************** Serial number set *****************************/
+
+/* The set of spent serial numbers, for rejecting double spends.
+ *
+ * Serial numbers are outputs of SHA-256, so they are used as their own hash:
+ * the set is an open-addressing table of 32-byte slots with linear probing,
+ * indexed by the first 8 bytes of the serial number, with the all-zero slot
+ * marking an empty one. The table doubles when it is half full, so it takes
+ * between 64 and 128 bytes per serial number.
+ *
+ * The table is either in memory or in a file, memory-mapped. In front of it
+ * there can be a Bloom filter, always in memory, which answers most lookups
+ * of unspent serial numbers without touching the table; that matters mostly
+ * when the table is in a file larger than memory. It takes bloomBitsPerSerial
+ * bits per serial number the table can hold before it grows; 10 bits give a
+ * false positive rate of about 1%.
+ *
+ * A file is only written back at flush(), which the destructor also does.
+ * If the process dies between an insertion and the next flush, the file is
+ * marked as not cleanly closed and will not open again: rebuild it from the
+ * chain. Files are only portable between machines of the same byte order.
+ *
+ * Lookups may be made from any number of threads at once, but not while the
+ * set is being changed.
+ */
+class SerialNumberSet {
+public:
+    /* An empty set in memory, with room for expectedSize serial numbers
+     * before it has to grow. */
+    explicit SerialNumberSet(size_t expectedSize = 1024, unsigned bloomBitsPerSerial = 0);
+
+    /* Opens the set in the file at path, creating an empty one, with room for
+     * expectedSize serial numbers, if there is no such file. Filling the
+     * Bloom filter reads the whole table. Throws std::runtime_error if the
+     * file cannot be used. */
+    SerialNumberSet(const std::string &path, size_t expectedSize = 1024, unsigned bloomBitsPerSerial = 0);
+
+    ~SerialNumberSet();
+
+    SerialNumberSet(const SerialNumberSet&) = delete;
+    SerialNumberSet& operator=(const SerialNumberSet&) = delete;
+
+    /* Returns false, and changes nothing, if serial is already in the set. */
+    bool insert(const Digest256 &serial);
+    bool contains(const Digest256 &serial) const;
+
+    /* Inserts each serial number in turn; inserted[i] is set to whether
+     * serials[i] was new, i.e. neither in the set nor earlier in serials.
+     * Returns the number of serial numbers inserted. The set grows, if it
+     * must, before any of them goes in, so if this throws the set is
+     * unchanged. */
+    size_t insertBatch(const std::vector<Digest256> &serials, std::vector<bool> &inserted);
+
+    /* found[i] is set to contains(serials[i]). Returns whether any of them is
+     * in the set. Faster than calling contains on each, as the lookups are
+     * overlapped. */
+    bool containsBatch(const std::vector<Digest256> &serials, std::vector<bool> &found) const;
+
+    uint64_t size() const { return this->count; }
+    uint64_t getCapacity() const { return this->capacity; }
+
+    /* Makes every serial number inserted so far durable. Does nothing for a
+     * set in memory. */
+    void flush();
+
+private:
+    std::string                 path;               // empty for a set in memory
+    int                         fd;
+    unsigned char*              map;                // the file, header first
+    uint64_t                    mapSize;
+    std::vector<unsigned char>  memoryTable;        // the table of a set in memory
+
+    unsigned char*              table;              // capacity slots of 32 bytes
+    uint64_t                    capacity;           // a power of two
+    uint64_t                    count;
+    bool                        hasZero;            // the zero serial is not stored in the table
+    bool                        dirty;              // changed since the last flush
+
+    unsigned                    bloomBitsPerSerial;
+    unsigned                    bloomHashes;
+    std::vector<uint64_t>       bloom;
+    uint64_t                    bloomMask;
+
+    static uint64_t word(const unsigned char* serial, size_t i);
+    static uint64_t capacityFor(size_t expectedSize);
+
+    uint64_t slotFor(const unsigned char* serial) const;
+    bool find(const unsigned char* serial, uint64_t &slot) const;
+    bool bloomMayContain(const unsigned char* serial) const;
+    void bloomAdd(const unsigned char* serial);
+    void resetBloom();
+    void grow(uint64_t newCapacity);
+    void markDirty();
+    void close();
+};
+
+} /* namespace libzerocash */
+
+#endif /* SERIALNUMBERSET_H_ */
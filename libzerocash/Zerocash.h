@@ -46,7 +46,12 @@
 #define ZC_POUR_PROOF_SIZE 288
 #define ZC_C_SIZE          173
 #define ZC_SIGMA_SIZE      72
-#define ZC_TX_POUR_SIZE    (ZC_ROOT_SIZE+(2*ZC_SN_SIZE)+(2*ZC_CM_SIZE)+ZC_V_SIZE+ZC_PK_SIG_SIZE+(2*ZC_H_SIZE)+ZC_POUR_PROOF_SIZE+(2*ZC_C_SIZE)+ZC_SIGMA_SIZE)
+#define ZC_TX_VERSION_SIZE 2
+
+/* The encoding of PourTransaction::serialize. The root, the signature public
+ * key and the signature sigma belong to the transaction that carries the
+ * pour, and are not part of it. */
+#define ZC_TX_POUR_SIZE    (ZC_TX_VERSION_SIZE+(2*ZC_V_SIZE)+(2*ZC_SN_SIZE)+(2*ZC_CM_SIZE)+(2*ZC_H_SIZE)+ZC_POUR_PROOF_SIZE+(2*ZC_C_SIZE))
 
 #define SNARK
 
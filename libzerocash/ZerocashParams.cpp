@@ -11,11 +11,26 @@
  * @copyright  MIT license (see LICENSE file)
  *****************************************************************************/
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <exception>
 #include <fstream>
+#include <thread>
+#include <type_traits>
 #include <boost/format.hpp>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "Zerocash.h"
 #include "ZerocashParams.h"
+#include "utils/sha256.h"
 
 static void throw_missing_param_file_exception(std::string paramtype, std::string path) {
     /* paramtype should be either "proving" or "verifying". */
@@ -26,11 +41,495 @@ static void throw_missing_param_file_exception(std::string paramtype, std::strin
 
 namespace libzerocash {
 
-int ZerocashParams::getTreeDepth()
+/*
+ * Binary proving key format.
+ *
+ * A header followed by six sections: A_query, B_query, C_query, H_query,
+ * K_query and the constraint system. Every section starts at a multiple of
+ * PK_BINARY_ALIGNMENT bytes. Integers are 64-bit, and integers, field
+ * elements and curve points are all stored in their in-memory representation,
+ * so a file can only be read back on a machine of the same byte order by a
+ * build for the same curve; the header records the element sizes to catch a
+ * mismatch.
+ *
+ * - A, B and C queries (knowledge commitment vectors): the domain size, the
+ *   number of entries n, n indices, then (after padding) n values.
+ * - H and K queries (vectors of G1 elements): n, then (after padding) n
+ *   elements.
+ * - The constraint system: the primary and auxiliary input sizes and the
+ *   number of constraints, then for each constraint the terms of a, b and c,
+ *   each as a count followed by that many (index, coefficient) terms.
+ *
+ * Each section has its own SHA-256 checksum in the header, so that sections
+ * can be checked and decoded independently of each other, in parallel.
+ */
+static const char PK_BINARY_MAGIC[8] = { 'Z', 'C', 'P', 'K', 'B', 'I', 'N', '\0' };
+static const uint32_t PK_BINARY_VERSION = 2;
+static const size_t PK_BINARY_ALIGNMENT = 64;
+static const size_t PK_BINARY_SECTIONS = 6;
+
+typedef ZerocashParams::zerocash_pp pk_binary_ppT;
+typedef Fr<pk_binary_ppT> pk_binary_FieldT;
+
+static_assert(sizeof(size_t) == sizeof(uint64_t), "the binary proving key format needs 64-bit size_t");
+
+struct pk_binary_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t fr_size;
+    uint32_t g1_size;
+    uint32_t g2_size;
+    uint32_t term_size;
+    uint32_t reserved;
+    uint64_t num_old_coins;
+    uint64_t num_new_coins;
+    uint64_t tree_depth;
+    uint64_t section_offset[PK_BINARY_SECTIONS];
+    uint64_t section_size[PK_BINARY_SECTIONS];
+    unsigned char section_checksum[PK_BINARY_SECTIONS][SHA256_BLOCK_SIZE];
+    uint64_t file_size;
+};
+
+static const size_t PK_BINARY_HEADER_SPACE =
+    (sizeof(pk_binary_header) + PK_BINARY_ALIGNMENT - 1) / PK_BINARY_ALIGNMENT * PK_BINARY_ALIGNMENT;
+
+static void pk_binary_expected_header(pk_binary_header &h)
+{
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PK_BINARY_MAGIC, sizeof(h.magic));
+    h.version = PK_BINARY_VERSION;
+    h.fr_size = sizeof(pk_binary_FieldT);
+    h.g1_size = sizeof(G1<pk_binary_ppT>);
+    h.g2_size = sizeof(G2<pk_binary_ppT>);
+    h.term_size = sizeof(linear_term<pk_binary_FieldT>);
+}
+
+/* Writes the sections of a binary proving key, keeping track of the offset and
+ * of the checksum of the current section. */
+class pk_binary_writer {
+public:
+    pk_binary_writer(std::ostream &out) : out(out), offset(PK_BINARY_HEADER_SPACE) { }
+
+    void write(const void *data, size_t len) {
+        this->out.write(static_cast<const char*>(data), len);
+        sha256_update(&this->ctx, static_cast<const uint8_t*>(data), len);
+        this->offset += len;
+    }
+
+    void write_u64(uint64_t val) {
+        this->write(&val, sizeof(val));
+    }
+
+    /* Writes n objects of type T as they are laid out in memory. */
+    template<typename T>
+    void write_array(const T *data, size_t n) {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "the binary proving key format can only hold trivially copyable types");
+        this->write(data, n * sizeof(T));
+    }
+
+    void align() {
+        static const unsigned char zeros[PK_BINARY_ALIGNMENT] = { 0 };
+        this->write(zeros, (PK_BINARY_ALIGNMENT - this->offset % PK_BINARY_ALIGNMENT) % PK_BINARY_ALIGNMENT);
+    }
+
+    uint64_t position() const { return this->offset; }
+
+    void begin_section(pk_binary_header &header, size_t section) {
+        this->align();
+        header.section_offset[section] = this->offset;
+        sha256_init(&this->ctx);
+    }
+
+    void end_section(pk_binary_header &header, size_t section) {
+        header.section_size[section] = this->offset - header.section_offset[section];
+        sha256_length_padding(&this->ctx);
+        sha256_final_no_padding(&this->ctx, header.section_checksum[section]);
+    }
+
+private:
+    std::ostream &out;
+    uint64_t offset;
+    SHA256_CTX_mod ctx;
+};
+
+/* Bounds-checked reads out of a mapped binary proving key. */
+class pk_binary_reader {
+public:
+    pk_binary_reader(const unsigned char *data, size_t size) : data(data), size(size), offset(0) { }
+
+    void seek(uint64_t pos) {
+        if (pos > this->size) {
+            throw std::runtime_error("Binary proving key is truncated.");
+        }
+        this->offset = pos;
+    }
+
+    const unsigned char* read(uint64_t len) {
+        if (len > this->size - this->offset) {
+            throw std::runtime_error("Binary proving key is truncated.");
+        }
+        const unsigned char *p = this->data + this->offset;
+        this->offset += len;
+        return p;
+    }
+
+    uint64_t read_u64() {
+        uint64_t val;
+        memcpy(&val, this->read(sizeof(val)), sizeof(val));
+        return val;
+    }
+
+    /* Reads n objects of type T, guarding against overflow in n * sizeof(T). */
+    template<typename T>
+    void read_array(std::vector<T> &v, uint64_t n) {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "the binary proving key format can only hold trivially copyable types");
+        if (n > (this->size - this->offset) / sizeof(T)) {
+            throw std::runtime_error("Binary proving key is truncated.");
+        }
+        v.resize(n);
+        memcpy(v.data(), this->read(n * sizeof(T)), n * sizeof(T));
+    }
+
+    void align() {
+        this->seek((this->offset + PK_BINARY_ALIGNMENT - 1) / PK_BINARY_ALIGNMENT * PK_BINARY_ALIGNMENT);
+    }
+
+private:
+    const unsigned char *data;
+    size_t size;
+    uint64_t offset;
+};
+
+template<typename T>
+static void pk_binary_write_sparse_vector(pk_binary_writer &out, const sparse_vector<T> &v)
+{
+    out.write_u64(v.domain_size_);
+    out.write_u64(v.indices.size());
+    out.write_array(v.indices.data(), v.indices.size());
+    out.align();
+    out.write_array(v.values.data(), v.values.size());
+}
+
+template<typename T>
+static void pk_binary_read_sparse_vector(pk_binary_reader &in, sparse_vector<T> &v)
+{
+    v.domain_size_ = in.read_u64();
+    const uint64_t n = in.read_u64();
+    in.read_array(v.indices, n);
+    in.align();
+    in.read_array(v.values, n);
+}
+
+template<typename T>
+static void pk_binary_write_vector(pk_binary_writer &out, const std::vector<T> &v)
+{
+    out.write_u64(v.size());
+    out.align();
+    out.write_array(v.data(), v.size());
+}
+
+template<typename T>
+static void pk_binary_read_vector(pk_binary_reader &in, std::vector<T> &v)
+{
+    const uint64_t n = in.read_u64();
+    in.align();
+    in.read_array(v, n);
+}
+
+static void pk_binary_write_constraint_system(pk_binary_writer &out, const r1cs_constraint_system<pk_binary_FieldT> &cs)
+{
+    out.write_u64(cs.primary_input_size);
+    out.write_u64(cs.auxiliary_input_size);
+    out.write_u64(cs.constraints.size());
+    for (const r1cs_constraint<pk_binary_FieldT> &c : cs.constraints) {
+        for (const linear_combination<pk_binary_FieldT> *lc : { &c.a, &c.b, &c.c }) {
+            out.write_u64(lc->terms.size());
+            out.write_array(lc->terms.data(), lc->terms.size());
+        }
+    }
+}
+
+static void pk_binary_read_constraint_system(pk_binary_reader &in, r1cs_constraint_system<pk_binary_FieldT> &cs)
+{
+    cs.primary_input_size = in.read_u64();
+    cs.auxiliary_input_size = in.read_u64();
+    const uint64_t num_constraints = in.read_u64();
+    /* Don't trust the count for the reservation; a corrupt file runs out of bytes first. */
+    cs.constraints.clear();
+    cs.constraints.reserve(std::min<uint64_t>(num_constraints, 1 << 20));
+    for (uint64_t i = 0; i < num_constraints; i++) {
+        r1cs_constraint<pk_binary_FieldT> c;
+        for (linear_combination<pk_binary_FieldT> *lc : { &c.a, &c.b, &c.c }) {
+            in.read_array(lc->terms, in.read_u64());
+        }
+        cs.constraints.emplace_back(std::move(c));
+    }
+}
+
+/* An output stream buffer that writes straight to a file through a large
+ * buffer, optionally hashing everything that goes through it, so that keys can
+ * be serialized without holding a second copy in memory. The bytes go to
+ * path + ".tmp", which finish() fsyncs and renames over path, so a save that
+ * fails or is interrupted leaves any key file already at path as it was. */
+class key_file_buf : public std::streambuf {
+public:
+    key_file_buf(const std::string &path, bool hash) :
+        path(path), tmpPath(path + ".tmp"), buffer(1 << 20), hashing(hash)
+    {
+        this->fd = open(this->tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (this->fd < 0) {
+            throw std::runtime_error("Could not open key file for writing: " + this->tmpPath);
+        }
+        if (this->hashing) {
+            sha256_init(&this->ctx);
+        }
+        this->setp(this->buffer.data(), this->buffer.data() + this->buffer.size());
+    }
+
+    /* Without a successful finish(), the temporary file is removed. */
+    ~key_file_buf() {
+        if (this->fd >= 0) {
+            close(this->fd);
+            unlink(this->tmpPath.c_str());
+        }
+    }
+
+    key_file_buf(const key_file_buf&) = delete;
+    key_file_buf& operator=(const key_file_buf&) = delete;
+
+    /* Overwrites bytes that were already written, e.g. a header that is only
+     * known at the end. These bytes are not part of the digest. */
+    void write_at(uint64_t offset, const void *data, size_t len) {
+        if (!this->flush_buffer()) {
+            throw std::runtime_error("Could not write key file: " + this->path);
+        }
+        const char *p = static_cast<const char*>(data);
+        while (len > 0) {
+            ssize_t n = pwrite(this->fd, p, len, offset);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                throw std::runtime_error("Could not write key file: " + this->path);
+            }
+            p += n;
+            len -= n;
+            offset += n;
+        }
+    }
+
+    /* Flushes, fsyncs and closes the temporary file, then renames it over
+     * path. If digest is not NULL, it is set to the SHA-256 of everything
+     * written through the stream. */
+    void finish(std::vector<unsigned char> *digest) {
+        // The descriptor is closed whatever happens, so that a failed save
+        // does not leak it.
+        bool ok = this->flush_buffer();
+        ok = ok && fsync(this->fd) == 0;
+        ok = (close(this->fd) == 0) && ok;
+        this->fd = -1;
+        if (!ok || rename(this->tmpPath.c_str(), this->path.c_str()) != 0) {
+            unlink(this->tmpPath.c_str());
+            throw std::runtime_error("Could not write key file: " + this->path);
+        }
+
+        if (digest != NULL) {
+            assert(this->hashing);
+            digest->resize(SHA256_BLOCK_SIZE);
+            sha256_length_padding(&this->ctx);
+            sha256_final_no_padding(&this->ctx, digest->data());
+        }
+    }
+
+protected:
+    int_type overflow(int_type ch) {
+        if (!this->flush_buffer()) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *this->pptr() = traits_type::to_char_type(ch);
+            this->pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) {
+        if (n <= this->epptr() - this->pptr()) {
+            memcpy(this->pptr(), s, n);
+            this->pbump(n);
+            return n;
+        }
+        // Too big for what is left of the buffer: write it out directly.
+        if (!this->flush_buffer() || !this->write_out(s, n)) {
+            return 0;
+        }
+        return n;
+    }
+
+    int sync() {
+        return this->flush_buffer() ? 0 : -1;
+    }
+
+private:
+    bool write_out(const char *p, size_t len) {
+        if (this->hashing) {
+            sha256_update(&this->ctx, reinterpret_cast<const uint8_t*>(p), len);
+        }
+        while (len > 0) {
+            ssize_t n = write(this->fd, p, len);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    bool flush_buffer() {
+        const bool ok = this->write_out(this->pbase(), this->pptr() - this->pbase());
+        this->setp(this->buffer.data(), this->buffer.data() + this->buffer.size());
+        return ok;
+    }
+
+    std::string path;
+    std::string tmpPath;
+    std::vector<char> buffer;
+    bool hashing;
+    SHA256_CTX_mod ctx;
+    int fd;
+};
+
+/* A read-only mapping of a whole file. */
+class mapped_file {
+public:
+    mapped_file(const std::string &path) : data(NULL), size(0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw_missing_param_file_exception("proving", path);
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Could not stat proving key file: " + path);
+        }
+        this->size = st.st_size;
+
+        if (this->size > 0) {
+            void *map = mmap(NULL, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Could not map proving key file: " + path);
+            }
+            madvise(map, this->size, MADV_SEQUENTIAL);
+            this->data = static_cast<const unsigned char*>(map);
+        }
+        close(fd);
+    }
+
+    ~mapped_file() {
+        if (this->data != NULL) {
+            munmap(const_cast<unsigned char*>(this->data), this->size);
+        }
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    const unsigned char *data;
+    size_t size;
+};
+
+static pk_binary_header pk_binary_check_header(const mapped_file &file, const unsigned int tree_depth)
+{
+    if (file.size < PK_BINARY_HEADER_SPACE) {
+        throw std::runtime_error("Binary proving key is truncated.");
+    }
+
+    pk_binary_header header;
+    memcpy(&header, file.data, sizeof(header));
+
+    pk_binary_header expected;
+    pk_binary_expected_header(expected);
+    if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Not a binary proving key file.");
+    }
+    if (header.version != expected.version) {
+        throw std::runtime_error("Unsupported binary proving key version.");
+    }
+    if (header.fr_size != expected.fr_size || header.g1_size != expected.g1_size ||
+        header.g2_size != expected.g2_size || header.term_size != expected.term_size) {
+        throw std::runtime_error("Binary proving key was written for a different curve.");
+    }
+    if (header.file_size != file.size) {
+        throw std::runtime_error("Binary proving key is truncated.");
+    }
+    if (header.tree_depth != tree_depth) {
+        throw std::runtime_error("Binary proving key is for a different tree depth.");
+    }
+    for (size_t i = 0; i < PK_BINARY_SECTIONS; i++) {
+        if (header.section_offset[i] < PK_BINARY_HEADER_SPACE || header.section_offset[i] > file.size ||
+            header.section_size[i] > file.size - header.section_offset[i]) {
+            throw std::runtime_error("Binary proving key is truncated.");
+        }
+    }
+
+    return header;
+}
+
+/* Checks one section against its checksum and decodes it into pk. */
+static void pk_binary_load_section(const mapped_file &file,
+                                   const pk_binary_header &header,
+                                   size_t section,
+                                   r1cs_ppzksnark_proving_key<pk_binary_ppT> &pk)
+{
+    const unsigned char *data = file.data + header.section_offset[section];
+    const size_t size = header.section_size[section];
+
+    unsigned char checksum[SHA256_BLOCK_SIZE];
+    SHA256_CTX_mod ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, size);
+    sha256_length_padding(&ctx);
+    sha256_final_no_padding(&ctx, checksum);
+    if (memcmp(checksum, header.section_checksum[section], sizeof(checksum)) != 0) {
+        throw std::runtime_error("Binary proving key checksum mismatch.");
+    }
+
+    // Offsets within the file are aligned, so aligning relative to the start
+    // of the section is the same thing.
+    pk_binary_reader reader(data, size);
+    switch (section) {
+    case 0: pk_binary_read_sparse_vector(reader, pk.A_query); break;
+    case 1: pk_binary_read_sparse_vector(reader, pk.B_query); break;
+    case 2: pk_binary_read_sparse_vector(reader, pk.C_query); break;
+    case 3: pk_binary_read_vector(reader, pk.H_query); break;
+    case 4: pk_binary_read_vector(reader, pk.K_query); break;
+    case 5: pk_binary_read_constraint_system(reader, pk.constraint_system); break;
+    }
+}
+
+int ZerocashParams::getTreeDepth() const
 {
     return treeDepth;
 }
 
+void ZerocashParams::setPourMetrics(PourMetrics* metrics)
+{
+    pourMetrics = metrics;
+}
+
+PourMetrics* ZerocashParams::getPourMetrics() const
+{
+    return pourMetrics;
+}
+
 zerocash_pour_keypair<ZerocashParams::zerocash_pp> ZerocashParams::GenerateNewKeyPair(const unsigned int tree_depth)
 {
     libzerocash::ZerocashParams::zerocash_pp::init_public_params();
@@ -43,29 +542,29 @@ zerocash_pour_keypair<ZerocashParams::zerocash_pp> ZerocashParams::GenerateNewKe
     return kp_v1;
 }
 
-void ZerocashParams::SaveProvingKeyToFile(const zerocash_pour_proving_key<ZerocashParams::zerocash_pp>* p_pk_1, std::string path)
+void ZerocashParams::SaveProvingKeyToFile(const zerocash_pour_proving_key<ZerocashParams::zerocash_pp>* p_pk_1, std::string path, std::vector<unsigned char>* digest)
 {
-    std::stringstream ssProving;
-    ssProving << p_pk_1->r1cs_pk;
-    std::ofstream pkFilePtr;
-    pkFilePtr.open(path, std::ios::binary);
-    ssProving.rdbuf()->pubseekpos(0, std::ios_base::out);
-    pkFilePtr << ssProving.rdbuf();
-    pkFilePtr.flush();
-    pkFilePtr.close();
+    key_file_buf pkFileBuf(path, digest != NULL);
+    std::ostream pkFile(&pkFileBuf);
+    pkFile << p_pk_1->r1cs_pk;
+    pkFile.flush();
+    if (!pkFile) {
+        throw std::runtime_error("Could not write proving key file: " + path);
+    }
+    pkFileBuf.finish(digest);
 }
 
 
-void ZerocashParams::SaveVerificationKeyToFile(const zerocash_pour_verification_key<ZerocashParams::zerocash_pp>* p_vk_1, std::string path)
+void ZerocashParams::SaveVerificationKeyToFile(const zerocash_pour_verification_key<ZerocashParams::zerocash_pp>* p_vk_1, std::string path, std::vector<unsigned char>* digest)
 {
-    std::stringstream ssVerification;
-    ssVerification << p_vk_1->r1cs_vk;
-    std::ofstream vkFilePtr;
-    vkFilePtr.open(path, std::ios::binary);
-    ssVerification.rdbuf()->pubseekpos(0, std::ios_base::out);
-    vkFilePtr << ssVerification.rdbuf();
-    vkFilePtr.flush();
-    vkFilePtr.close();
+    key_file_buf vkFileBuf(path, digest != NULL);
+    std::ostream vkFile(&vkFileBuf);
+    vkFile << p_vk_1->r1cs_vk;
+    vkFile.flush();
+    if (!vkFile) {
+        throw std::runtime_error("Could not write verification key file: " + path);
+    }
+    vkFileBuf.finish(digest);
 }
 
 zerocash_pour_proving_key<ZerocashParams::zerocash_pp> ZerocashParams::LoadProvingKeyFromFile(std::string path, const unsigned int tree_depth)
@@ -117,14 +616,117 @@ zerocash_pour_verification_key<ZerocashParams::zerocash_pp> ZerocashParams::Load
     );
 }
 
+void ZerocashParams::SaveProvingKeyToBinaryFile(const zerocash_pour_proving_key<ZerocashParams::zerocash_pp>* p_pk_1, std::string path)
+{
+    key_file_buf pkFileBuf(path, false);
+    std::ostream pkFile(&pkFileBuf);
+
+    pk_binary_header header;
+    pk_binary_expected_header(header);
+    header.num_old_coins = p_pk_1->num_old_coins;
+    header.num_new_coins = p_pk_1->num_new_coins;
+    header.tree_depth = p_pk_1->tree_depth;
+
+    // The header goes in last, once the offsets and the checksum are known.
+    const std::vector<char> header_space(PK_BINARY_HEADER_SPACE, 0);
+    pkFile.write(header_space.data(), header_space.size());
+
+    const r1cs_ppzksnark_proving_key<ZerocashParams::zerocash_pp> &pk = p_pk_1->r1cs_pk;
+    pk_binary_writer writer(pkFile);
+    writer.begin_section(header, 0);
+    pk_binary_write_sparse_vector(writer, pk.A_query);
+    writer.end_section(header, 0);
+    writer.begin_section(header, 1);
+    pk_binary_write_sparse_vector(writer, pk.B_query);
+    writer.end_section(header, 1);
+    writer.begin_section(header, 2);
+    pk_binary_write_sparse_vector(writer, pk.C_query);
+    writer.end_section(header, 2);
+    writer.begin_section(header, 3);
+    pk_binary_write_vector(writer, pk.H_query);
+    writer.end_section(header, 3);
+    writer.begin_section(header, 4);
+    pk_binary_write_vector(writer, pk.K_query);
+    writer.end_section(header, 4);
+    writer.begin_section(header, 5);
+    pk_binary_write_constraint_system(writer, pk.constraint_system);
+    writer.end_section(header, 5);
+
+    header.file_size = writer.position();
+
+    pkFile.flush();
+    if (!pkFile) {
+        throw std::runtime_error("Could not write proving key file: " + path);
+    }
+    pkFileBuf.write_at(0, &header, sizeof(header));
+    pkFileBuf.finish(NULL);
+}
+
+zerocash_pour_proving_key<ZerocashParams::zerocash_pp> ZerocashParams::LoadProvingKeyFromBinaryFile(std::string path, const unsigned int tree_depth, unsigned int num_threads)
+{
+    const mapped_file file(path);
+    const pk_binary_header header = pk_binary_check_header(file, tree_depth);
+
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::min<unsigned int>(num_threads, PK_BINARY_SECTIONS);
+
+    // Hand out the biggest sections first so that no thread is left with a
+    // big one at the end.
+    std::vector<size_t> order(PK_BINARY_SECTIONS);
+    for (size_t i = 0; i < PK_BINARY_SECTIONS; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&header](size_t a, size_t b) {
+        return header.section_size[a] > header.section_size[b];
+    });
+
+    r1cs_ppzksnark_proving_key<ZerocashParams::zerocash_pp> pk_temp;
+    std::atomic<size_t> next(0);
+    std::vector<std::exception_ptr> errors(PK_BINARY_SECTIONS);
+    auto worker = [&]() {
+        for (size_t i = next++; i < PK_BINARY_SECTIONS; i = next++) {
+            try {
+                pk_binary_load_section(file, header, order[i], pk_temp);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < num_threads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    for (const std::exception_ptr &e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+
+    return zerocash_pour_proving_key<ZerocashParams::zerocash_pp>(
+        header.num_old_coins,
+        header.num_new_coins,
+        header.tree_depth,
+        std::move(pk_temp)
+    );
+}
+
 ZerocashParams::ZerocashParams(
     const unsigned int tree_depth,
     zerocash_pour_keypair<ZerocashParams::zerocash_pp> *keypair
 ) :
-    treeDepth(tree_depth)
+    treeDepth(tree_depth),
+    pourMetrics(NULL)
 {
-    params_pk_v1 = new zerocash_pour_proving_key<ZerocashParams::zerocash_pp>(keypair->pk);
-    params_vk_v1 = new zerocash_pour_verification_key<ZerocashParams::zerocash_pp>(keypair->vk);
+    params_pk_v1 = std::make_shared<const zerocash_pour_proving_key<ZerocashParams::zerocash_pp> >(keypair->pk);
+    params_vk_v1 = std::make_shared<const zerocash_pour_verification_key<ZerocashParams::zerocash_pp> >(keypair->vk);
+    processVerificationKey();
 }
 
 ZerocashParams::ZerocashParams(
@@ -132,49 +734,104 @@ ZerocashParams::ZerocashParams(
     zerocash_pour_proving_key<ZerocashParams::zerocash_pp>* p_pk_1,
     zerocash_pour_verification_key<ZerocashParams::zerocash_pp>* p_vk_1
 ) :
-    treeDepth(tree_depth)
+    treeDepth(tree_depth),
+    pourMetrics(NULL)
 {
     assert(p_pk_1 != NULL || p_vk_1 != NULL);
 
-    if (p_pk_1 == NULL) {
-        params_pk_v1 = NULL;
-    } else {
-        params_pk_v1 = new zerocash_pour_proving_key<ZerocashParams::zerocash_pp>(*p_pk_1);
+    if (p_pk_1 != NULL) {
+        params_pk_v1 = std::make_shared<const zerocash_pour_proving_key<ZerocashParams::zerocash_pp> >(*p_pk_1);
     }
 
-    if (p_vk_1 == NULL) {
-        params_vk_v1 = NULL;
-    } else {
-        params_vk_v1 = new zerocash_pour_verification_key<ZerocashParams::zerocash_pp>(*p_vk_1);
+    if (p_vk_1 != NULL) {
+        params_vk_v1 = std::make_shared<const zerocash_pour_verification_key<ZerocashParams::zerocash_pp> >(*p_vk_1);
     }
+    processVerificationKey();
+}
+
+ZerocashParams::ZerocashParams(
+    const unsigned int tree_depth,
+    zerocash_pour_keypair<ZerocashParams::zerocash_pp> &&keypair
+) :
+    treeDepth(tree_depth),
+    params_pk_v1(std::make_shared<const zerocash_pour_proving_key<ZerocashParams::zerocash_pp> >(std::move(keypair.pk))),
+    params_vk_v1(std::make_shared<const zerocash_pour_verification_key<ZerocashParams::zerocash_pp> >(std::move(keypair.vk))),
+    pourMetrics(NULL)
+{
+    processVerificationKey();
+}
+
+ZerocashParams::ZerocashParams(
+    const unsigned int tree_depth,
+    std::shared_ptr<const zerocash_pour_proving_key<ZerocashParams::zerocash_pp> > pk_1,
+    std::shared_ptr<const zerocash_pour_verification_key<ZerocashParams::zerocash_pp> > vk_1
+) :
+    treeDepth(tree_depth),
+    params_pk_v1(std::move(pk_1)),
+    params_vk_v1(std::move(vk_1)),
+    pourMetrics(NULL)
+{
+    assert(params_pk_v1 || params_vk_v1);
+    processVerificationKey();
 }
 
 ZerocashParams::~ZerocashParams()
 {
-    if (params_pk_v1 != NULL) {
-        delete params_pk_v1;
-    }
-    if (params_vk_v1 != NULL) {
-        delete params_vk_v1;
-    }
+    /* The context refers to the proving key, so it has to go first. */
+    prover_context.reset();
 }
 
-const zerocash_pour_proving_key<ZerocashParams::zerocash_pp>& ZerocashParams::getProvingKey()
+std::shared_ptr<const zerocash_pour_proving_key<ZerocashParams::zerocash_pp> > ZerocashParams::getSharedProvingKey() const
 {
-    if (params_pk_v1 != NULL) {
+    return params_pk_v1;
+}
+
+std::shared_ptr<const zerocash_pour_verification_key<ZerocashParams::zerocash_pp> > ZerocashParams::getSharedVerificationKey() const
+{
+    return params_vk_v1;
+}
+
+const zerocash_pour_proving_key<ZerocashParams::zerocash_pp>& ZerocashParams::getProvingKey() const
+{
+    if (params_pk_v1) {
         return *params_pk_v1;
     } else {
         throw std::runtime_error("Pour proving key not set.");
     }
 }
 
-const zerocash_pour_verification_key<ZerocashParams::zerocash_pp>& ZerocashParams::getVerificationKey()
+const zerocash_pour_verification_key<ZerocashParams::zerocash_pp>& ZerocashParams::getVerificationKey() const
 {
-    if (params_vk_v1 != NULL) {
+    if (params_vk_v1) {
         return *params_vk_v1;
     } else {
         throw std::runtime_error("Pour verification key not set.");
     }
 }
 
+const zerocash_pour_processed_verification_key<ZerocashParams::zerocash_pp>& ZerocashParams::getProcessedVerificationKey() const
+{
+    if (params_pvk_v1) {
+        return *params_pvk_v1;
+    } else {
+        throw std::runtime_error("Pour verification key not set.");
+    }
+}
+
+void ZerocashParams::processVerificationKey()
+{
+    if (params_vk_v1) {
+        params_pvk_v1 = std::make_shared<const zerocash_pour_processed_verification_key<ZerocashParams::zerocash_pp> >(
+            zerocash_pour_ppzksnark_verifier_process_vk<ZerocashParams::zerocash_pp>(*params_vk_v1));
+    }
+}
+
+zerocash_pour_prover_context<ZerocashParams::zerocash_pp>& ZerocashParams::getProverContext()
+{
+    if (!prover_context) {
+        prover_context.reset(new zerocash_pour_prover_context<ZerocashParams::zerocash_pp>(getProvingKey()));
+    }
+    return *prover_context;
+}
+
 } /* namespace libzerocash */
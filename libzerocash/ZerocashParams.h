@@ -12,7 +12,10 @@
 #ifndef PARAMS_H_
 #define PARAMS_H_
 
+#include <memory>
+
 #include "Zerocash.h"
+#include "PourMetrics.h"
 #include "libsnark/common/default_types/r1cs_ppzksnark_pp.hpp"
 #include "libsnark/zk_proof_systems/ppzksnark/r1cs_ppzksnark/r1cs_ppzksnark.hpp"
 #include "zerocash_pour_ppzksnark/zerocash_pour_ppzksnark.hpp"
@@ -35,9 +38,41 @@ public:
         zerocash_pour_verification_key<ZerocashParams::zerocash_pp>* p_vk_1
     );
 
-    const zerocash_pour_proving_key<zerocash_pp>& getProvingKey();
-    const zerocash_pour_verification_key<zerocash_pp>& getVerificationKey();
-    int getTreeDepth();
+    /* Takes over the keys of keypair without copying them. */
+    ZerocashParams(
+        const unsigned int tree_depth,
+        zerocash_pour_keypair<ZerocashParams::zerocash_pp> &&keypair
+    );
+
+    /* Shares the given keys, which may be used by any number of
+     * ZerocashParams (and threads) at once. Either key may be null. */
+    ZerocashParams(
+        const unsigned int tree_depth,
+        std::shared_ptr<const zerocash_pour_proving_key<ZerocashParams::zerocash_pp> > pk_1,
+        std::shared_ptr<const zerocash_pour_verification_key<ZerocashParams::zerocash_pp> > vk_1
+    );
+
+    ZerocashParams(ZerocashParams &&other) = default;
+    ZerocashParams& operator=(ZerocashParams &&other) = default;
+
+    /* The const members of ZerocashParams may be used from any number of
+     * threads at once. */
+    const zerocash_pour_proving_key<zerocash_pp>& getProvingKey() const;
+    const zerocash_pour_verification_key<zerocash_pp>& getVerificationKey() const;
+    /* The processed form of the verification key, built along with the
+     * ZerocashParams. */
+    const zerocash_pour_processed_verification_key<zerocash_pp>& getProcessedVerificationKey() const;
+    /* The prover context for the proving key, built on first use. Not
+     * thread-safe: concurrent provers need their own contexts. */
+    zerocash_pour_prover_context<zerocash_pp>& getProverContext();
+    std::shared_ptr<const zerocash_pour_proving_key<zerocash_pp> > getSharedProvingKey() const;
+    std::shared_ptr<const zerocash_pour_verification_key<zerocash_pp> > getSharedVerificationKey() const;
+    int getTreeDepth() const;
+
+    /* The hook told about the phases of each pour built with these params,
+     * or NULL (the default). The ZerocashParams does not own it. */
+    void setPourMetrics(PourMetrics* metrics);
+    PourMetrics* getPourMetrics() const;
     ~ZerocashParams();
 
     static const size_t numPourInputs = 2;
@@ -45,14 +80,30 @@ public:
 
     static zerocash_pour_keypair<ZerocashParams::zerocash_pp> GenerateNewKeyPair(const unsigned int tree_depth);
 
-    static void SaveProvingKeyToFile(const zerocash_pour_proving_key<ZerocashParams::zerocash_pp>* p_pk_1, std::string path);
-    static void SaveVerificationKeyToFile(const zerocash_pour_verification_key<ZerocashParams::zerocash_pp>* p_vk_1, std::string path);
+    /* Keys are streamed to the file as they are serialized, and the file is
+     * fsynced once at the end. If digest is not NULL, it is set to the
+     * SHA-256 of the file. */
+    static void SaveProvingKeyToFile(const zerocash_pour_proving_key<ZerocashParams::zerocash_pp>* p_pk_1, std::string path, std::vector<unsigned char>* digest = NULL);
+    static void SaveVerificationKeyToFile(const zerocash_pour_verification_key<ZerocashParams::zerocash_pp>* p_vk_1, std::string path, std::vector<unsigned char>* digest = NULL);
     static zerocash_pour_proving_key<ZerocashParams::zerocash_pp> LoadProvingKeyFromFile(std::string path, const unsigned int tree_depth);
     static zerocash_pour_verification_key<ZerocashParams::zerocash_pp> LoadVerificationKeyFromFile(std::string path, const unsigned int tree_depth);
+
+    /* The binary proving key format is laid out as the key is in memory, so
+     * loading is a checksum and a copy out of a read-only mapping of the file
+     * instead of a parse. Files are only portable between builds for the same
+     * curve and byte order. The sections of the key are checked and decoded
+     * on num_threads threads (0 means one per hardware thread). */
+    static void SaveProvingKeyToBinaryFile(const zerocash_pour_proving_key<ZerocashParams::zerocash_pp>* p_pk_1, std::string path);
+    static zerocash_pour_proving_key<ZerocashParams::zerocash_pp> LoadProvingKeyFromBinaryFile(std::string path, const unsigned int tree_depth, unsigned int num_threads = 0);
 private:
     int treeDepth;
-    zerocash_pour_proving_key<ZerocashParams::zerocash_pp>* params_pk_v1;
-    zerocash_pour_verification_key<ZerocashParams::zerocash_pp>* params_vk_v1;
+    std::shared_ptr<const zerocash_pour_proving_key<ZerocashParams::zerocash_pp> > params_pk_v1;
+    std::shared_ptr<const zerocash_pour_verification_key<ZerocashParams::zerocash_pp> > params_vk_v1;
+    std::unique_ptr<zerocash_pour_prover_context<ZerocashParams::zerocash_pp> > prover_context;
+    std::shared_ptr<const zerocash_pour_processed_verification_key<ZerocashParams::zerocash_pp> > params_pvk_v1;
+    PourMetrics* pourMetrics;
+
+    void processVerificationKey();
 };
 
 } /* namespace libzerocash */
@@ -0,0 +1,177 @@
+/** @file
+ *****************************************************************************
+
+ Declaration and implementation of the fixed-size bit string Bits<N>.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef BITS_H_
+#define BITS_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "sha256.h"
+
+namespace libzerocash {
+
+/*
+ * A string of N bits packed into N/8 bytes. Bit i is bit (7 - i % 8) of byte
+ * i / 8, i.e. the most significant bit of the first byte comes first. This is
+ * the same order used by convertBytesToVector and friends, so a Bits<N> and
+ * the std::vector<bool> of N entries that libsnark works with describe the
+ * same string.
+ *
+ * Values are kept packed everywhere in libzerocash; the conversion to a
+ * std::vector<bool> is only done where a bit vector is actually needed, i.e.
+ * when handing inputs to the zkSNARK prover and verifier.
+ */
+template<size_t N>
+class Bits {
+    static_assert(N % 8 == 0, "Bits<N> must be a whole number of bytes");
+
+public:
+    static const size_t BITS = N;
+    static const size_t BYTES = N / 8;
+
+    Bits() : bytes() { }
+
+    explicit Bits(const unsigned char* data) {
+        memcpy(this->bytes.data(), data, BYTES);
+    }
+
+    /* Throws std::length_error unless v has exactly N/8 bytes. */
+    static Bits fromBytesVector(const std::vector<unsigned char>& v) {
+        if (v.size() != BYTES) {
+            throw std::length_error("Bits: wrong number of bytes");
+        }
+        return Bits(v.data());
+    }
+
+    /* Throws std::length_error unless v has exactly N bits. */
+    static Bits fromBitVector(const std::vector<bool>& v) {
+        if (v.size() != N) {
+            throw std::length_error("Bits: wrong number of bits");
+        }
+        Bits result;
+        for (size_t i = 0; i < N; i++) {
+            if (v[i]) {
+                result.bytes[i / 8] |= (0x80 >> (i % 8));
+            }
+        }
+        return result;
+    }
+
+    /* Big-endian encoding of val, as done by convertIntToBytesVector. */
+    static Bits fromInt(uint64_t val) {
+        static_assert(N <= 64, "Bits<N>::fromInt needs N <= 64");
+        Bits result;
+        for (size_t i = 0; i < BYTES; i++) {
+            result.bytes[BYTES - 1 - i] = (val >> (i * 8)) & 0xff;
+        }
+        return result;
+    }
+
+    uint64_t toInt() const {
+        static_assert(N <= 64, "Bits<N>::toInt needs N <= 64");
+        uint64_t val = 0;
+        for (size_t i = 0; i < BYTES; i++) {
+            val = (val << 8) | this->bytes[i];
+        }
+        return val;
+    }
+
+    bool getBit(size_t i) const {
+        return (this->bytes[i / 8] >> (7 - i % 8)) & 1;
+    }
+
+    void setBit(size_t i, bool value) {
+        if (value) {
+            this->bytes[i / 8] |= (0x80 >> (i % 8));
+        } else {
+            this->bytes[i / 8] &= ~(0x80 >> (i % 8));
+        }
+    }
+
+    std::vector<bool> toBitVector() const {
+        std::vector<bool> v(N);
+        for (size_t i = 0; i < N; i++) {
+            v[i] = this->getBit(i);
+        }
+        return v;
+    }
+
+    std::vector<unsigned char> toBytesVector() const {
+        return std::vector<unsigned char>(this->bytes.begin(), this->bytes.end());
+    }
+
+    /* The first `length` bits of the result are the low bits of prefix (most
+     * significant first), followed by the first N - length bits of this
+     * string. This is how the serial number and MAC preimages tag a value. */
+    Bits withPrefix(unsigned int prefix, size_t length) const {
+        Bits result;
+        for (size_t i = 0; i < length; i++) {
+            result.setBit(i, (prefix >> (length - 1 - i)) & 1);
+        }
+        for (size_t i = length; i < N; i++) {
+            result.setBit(i, this->getBit(i - length));
+        }
+        return result;
+    }
+
+    bool isZero() const {
+        return std::all_of(this->bytes.begin(), this->bytes.end(),
+                           [](unsigned char c) { return c == 0; });
+    }
+
+    unsigned char* data() { return this->bytes.data(); }
+    const unsigned char* data() const { return this->bytes.data(); }
+    static size_t size() { return BYTES; }
+
+    typename std::array<unsigned char, BYTES>::iterator begin() { return this->bytes.begin(); }
+    typename std::array<unsigned char, BYTES>::iterator end() { return this->bytes.end(); }
+    typename std::array<unsigned char, BYTES>::const_iterator begin() const { return this->bytes.begin(); }
+    typename std::array<unsigned char, BYTES>::const_iterator end() const { return this->bytes.end(); }
+
+    bool operator==(const Bits& rhs) const { return this->bytes == rhs.bytes; }
+    bool operator!=(const Bits& rhs) const { return this->bytes != rhs.bytes; }
+    bool operator<(const Bits& rhs) const { return this->bytes < rhs.bytes; }
+
+private:
+    std::array<unsigned char, BYTES> bytes;
+};
+
+template<size_t N> const size_t Bits<N>::BITS;
+template<size_t N> const size_t Bits<N>::BYTES;
+
+typedef Bits<256> Digest256;
+
+/* The string a || b. */
+template<size_t N, size_t M>
+Bits<N + M> concatenate(const Bits<N>& a, const Bits<M>& b) {
+    Bits<N + M> result;
+    memcpy(result.data(), a.data(), Bits<N>::BYTES);
+    memcpy(result.data() + Bits<N>::BYTES, b.data(), Bits<M>::BYTES);
+    return result;
+}
+
+/* The libzerocash hash of a single 512-bit block (SHA-256 compression from
+ * the initial state, without length padding). */
+inline Digest256 hashBlock(const Bits<512>& block) {
+    Digest256 result;
+    sha256_compress_block(block.data(), result.data());
+    return result;
+}
+
+} /* namespace libzerocash */
+
+#endif /* BITS_H_ */
@@ -17,6 +17,12 @@
 #include <memory.h>
 #include "sha256.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_X86_KERNELS
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 /****************************** MACROS ******************************/
 #define ROTLEFT(a,b) (((a) << (b)) | ((a) >> (32-(b))))
 #define ROTRIGHT(a,b) (((a) >> (b)) | ((a) << (32-(b))))
@@ -98,9 +104,18 @@ void sha256_init(SHA256_CTX_mod *ctx)
 
 void sha256_update(SHA256_CTX_mod *ctx, const uint8_t data[], size_t len)
 {
-	uint32_t i;
+	uint32_t i = 0;
+
+	// Whole blocks are transformed straight from the input when nothing is
+	// buffered, instead of being copied into ctx->data a byte at a time.
+	if (ctx->datalen == 0) {
+		for ( ; i + 64 <= len; i += 64) {
+			sha256_transform(ctx, data + i);
+			ctx->bitlen += 512;
+		}
+	}
 
-	for (i = 0; i < len; ++i) {
+	for ( ; i < len; ++i) {
 		ctx->data[ctx->datalen] = data[i];
 		ctx->datalen++;
 		if (ctx->datalen == 64) {
@@ -161,3 +176,277 @@ void sha256_final_no_padding(SHA256_CTX_mod *ctx, uint8_t hash[])
 		hash[i + 28] = (ctx->state[7] >> (24 - i * 8)) & 0x000000ff;
 	}
 }
+
+/******************** MULTI-BLOCK COMPRESSION ***********************/
+static const uint32_t initial_state[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | ((uint32_t) p[3]);
+}
+
+static inline void store_be32(uint8_t *p, uint32_t x)
+{
+	p[0] = (x >> 24) & 0xff;
+	p[1] = (x >> 16) & 0xff;
+	p[2] = (x >> 8) & 0xff;
+	p[3] = x & 0xff;
+}
+
+static void sha256_compress_generic(const uint8_t block[], uint8_t out[])
+{
+	SHA256_CTX_mod ctx;
+
+	sha256_init(&ctx);
+	sha256_transform(&ctx, block);
+	sha256_final_no_padding(&ctx, out);
+}
+
+#ifdef SHA256_X86_KERNELS
+
+/* One block with the SHA extensions. The state is held in the ABEF/CDGH
+ * register layout that sha256rnds2 expects. */
+__attribute__((target("sha,ssse3,sse4.1")))
+static void sha256_compress_shani(const uint8_t block[], uint8_t out[])
+{
+	const __m128i byteswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i abef, cdgh, abef_save, cdgh_save, msg, tmp, w[4];
+	int i;
+
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &initial_state[0]), 0xB1);  /* CDAB */
+	cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &initial_state[4]), 0x1B); /* EFGH */
+	abef = _mm_alignr_epi8(tmp, cdgh, 8);
+	cdgh = _mm_blend_epi16(cdgh, tmp, 0xF0);
+	abef_save = abef;
+	cdgh_save = cdgh;
+
+	for (i = 0; i < 16; ++i) {
+		if (i < 4)
+			w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (block + 16 * i)), byteswap);
+
+		msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *) &k[4 * i]));
+		cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+
+		/* finish the schedule words for the next group of four rounds */
+		if (i >= 3 && i <= 14) {
+			tmp = _mm_alignr_epi8(w[i & 3], w[(i - 1) & 3], 4);
+			w[(i + 1) & 3] = _mm_add_epi32(w[(i + 1) & 3], tmp);
+			w[(i + 1) & 3] = _mm_sha256msg2_epu32(w[(i + 1) & 3], w[i & 3]);
+		}
+
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		abef = _mm_sha256rnds2_epu32(abef, cdgh, msg);
+
+		/* start the schedule words needed three groups from now */
+		if (i >= 1 && i <= 12)
+			w[(i - 1) & 3] = _mm_sha256msg1_epu32(w[(i - 1) & 3], w[i & 3]);
+	}
+
+	abef = _mm_add_epi32(abef, abef_save);
+	cdgh = _mm_add_epi32(cdgh, cdgh_save);
+
+	tmp = _mm_shuffle_epi32(abef, 0x1B);      /* FEBA */
+	cdgh = _mm_shuffle_epi32(cdgh, 0xB1);     /* DCHG */
+	abef = _mm_blend_epi16(tmp, cdgh, 0xF0);  /* DCBA */
+	cdgh = _mm_alignr_epi8(cdgh, tmp, 8);     /* HGFE */
+
+	_mm_storeu_si128((__m128i *) out, _mm_shuffle_epi8(abef, byteswap));
+	_mm_storeu_si128((__m128i *) (out + 16), _mm_shuffle_epi8(cdgh, byteswap));
+}
+
+/* Lane-parallel kernels: lane j of every vector belongs to block j, so the
+ * round function is the scalar one with each operation widened. */
+#define SHA256_LANE_ROUNDS(V, ADD, XOR, AND, ANDNOT, OR, SRL, SLL, SET1)                 \
+	do {                                                                              \
+		V a = SET1(initial_state[0]), b = SET1(initial_state[1]);                     \
+		V c = SET1(initial_state[2]), d = SET1(initial_state[3]);                     \
+		V e = SET1(initial_state[4]), f = SET1(initial_state[5]);                     \
+		V g = SET1(initial_state[6]), h = SET1(initial_state[7]);                     \
+		V t1, t2;                                                                     \
+		for (i = 0; i < 64; ++i) {                                                    \
+			if (i >= 16) {                                                            \
+				V x = m[(i - 15) & 15], y = m[(i - 2) & 15];                          \
+				V s0 = XOR(XOR(OR(SRL(x, 7), SLL(x, 25)), OR(SRL(x, 18), SLL(x, 14))), SRL(x, 3)); \
+				V s1 = XOR(XOR(OR(SRL(y, 17), SLL(y, 15)), OR(SRL(y, 19), SLL(y, 13))), SRL(y, 10)); \
+				m[i & 15] = ADD(ADD(m[i & 15], s0), ADD(m[(i - 7) & 15], s1));        \
+			}                                                                         \
+			t1 = XOR(XOR(OR(SRL(e, 6), SLL(e, 26)), OR(SRL(e, 11), SLL(e, 21))), OR(SRL(e, 25), SLL(e, 7))); \
+			t1 = ADD(ADD(h, t1), ADD(XOR(AND(e, f), ANDNOT(e, g)), ADD(SET1(k[i]), m[i & 15]))); \
+			t2 = XOR(XOR(OR(SRL(a, 2), SLL(a, 30)), OR(SRL(a, 13), SLL(a, 19))), OR(SRL(a, 22), SLL(a, 10))); \
+			t2 = ADD(t2, XOR(XOR(AND(a, b), AND(a, c)), AND(b, c)));                  \
+			h = g; g = f; f = e; e = ADD(d, t1);                                      \
+			d = c; c = b; b = a; a = ADD(t1, t2);                                     \
+		}                                                                             \
+		st[0] = ADD(a, SET1(initial_state[0])); st[1] = ADD(b, SET1(initial_state[1])); \
+		st[2] = ADD(c, SET1(initial_state[2])); st[3] = ADD(d, SET1(initial_state[3])); \
+		st[4] = ADD(e, SET1(initial_state[4])); st[5] = ADD(f, SET1(initial_state[5])); \
+		st[6] = ADD(g, SET1(initial_state[6])); st[7] = ADD(h, SET1(initial_state[7])); \
+	} while (0)
+
+__attribute__((target("sse2")))
+static void sha256_compress_sse2_x4(const uint8_t blocks[][64], uint8_t out[][SHA256_BLOCK_SIZE])
+{
+	__m128i m[16], st[8];
+	uint32_t lanes[4];
+	int i, j;
+
+	for (i = 0; i < 16; ++i)
+		m[i] = _mm_set_epi32(load_be32(blocks[3] + 4 * i), load_be32(blocks[2] + 4 * i),
+		                     load_be32(blocks[1] + 4 * i), load_be32(blocks[0] + 4 * i));
+
+	SHA256_LANE_ROUNDS(__m128i, _mm_add_epi32, _mm_xor_si128, _mm_and_si128, _mm_andnot_si128,
+	                   _mm_or_si128, _mm_srli_epi32, _mm_slli_epi32, _mm_set1_epi32);
+
+	for (i = 0; i < 8; ++i) {
+		_mm_storeu_si128((__m128i *) lanes, st[i]);
+		for (j = 0; j < 4; ++j)
+			store_be32(out[j] + 4 * i, lanes[j]);
+	}
+}
+
+__attribute__((target("avx2")))
+static void sha256_compress_avx2_x8(const uint8_t blocks[][64], uint8_t out[][SHA256_BLOCK_SIZE])
+{
+	__m256i m[16], st[8];
+	uint32_t lanes[8];
+	int i, j;
+
+	for (i = 0; i < 16; ++i)
+		m[i] = _mm256_set_epi32(load_be32(blocks[7] + 4 * i), load_be32(blocks[6] + 4 * i),
+		                        load_be32(blocks[5] + 4 * i), load_be32(blocks[4] + 4 * i),
+		                        load_be32(blocks[3] + 4 * i), load_be32(blocks[2] + 4 * i),
+		                        load_be32(blocks[1] + 4 * i), load_be32(blocks[0] + 4 * i));
+
+	SHA256_LANE_ROUNDS(__m256i, _mm256_add_epi32, _mm256_xor_si256, _mm256_and_si256, _mm256_andnot_si256,
+	                   _mm256_or_si256, _mm256_srli_epi32, _mm256_slli_epi32, _mm256_set1_epi32);
+
+	for (i = 0; i < 8; ++i) {
+		_mm256_storeu_si256((__m256i *) lanes, st[i]);
+		for (j = 0; j < 8; ++j)
+			store_be32(out[j] + 4 * i, lanes[j]);
+	}
+}
+
+#undef SHA256_LANE_ROUNDS
+
+static int cpu_has_sha_extensions()
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (__get_cpuid_max(0, 0) < 7)
+		return 0;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	return (ebx >> 29) & 1;
+}
+
+static sha256_kernel sha256_select_kernel()
+{
+	if (sha256_kernel_supported(SHA256_KERNEL_SHANI))
+		return SHA256_KERNEL_SHANI;
+	if (sha256_kernel_supported(SHA256_KERNEL_AVX2))
+		return SHA256_KERNEL_AVX2;
+	if (sha256_kernel_supported(SHA256_KERNEL_SSE2))
+		return SHA256_KERNEL_SSE2;
+	return SHA256_KERNEL_GENERIC;
+}
+
+static sha256_kernel sha256_forced_kernel = SHA256_KERNEL_AUTO;
+
+static sha256_kernel sha256_kernel_in_use()
+{
+	static const sha256_kernel kernel = sha256_select_kernel();
+	return sha256_forced_kernel == SHA256_KERNEL_AUTO ? kernel : sha256_forced_kernel;
+}
+
+#endif /* SHA256_X86_KERNELS */
+
+int sha256_kernel_supported(sha256_kernel kernel)
+{
+	if (kernel == SHA256_KERNEL_AUTO || kernel == SHA256_KERNEL_GENERIC)
+		return 1;
+#ifdef SHA256_X86_KERNELS
+	__builtin_cpu_init();
+	switch (kernel) {
+	case SHA256_KERNEL_SSE2:
+		return __builtin_cpu_supports("sse2") != 0;
+	case SHA256_KERNEL_AVX2:
+		return __builtin_cpu_supports("avx2") != 0;
+	case SHA256_KERNEL_SHANI:
+		return cpu_has_sha_extensions() && __builtin_cpu_supports("sse4.1");
+	default:
+		break;
+	}
+#endif
+	return 0;
+}
+
+int sha256_force_kernel(sha256_kernel kernel)
+{
+	if (!sha256_kernel_supported(kernel))
+		return 0;
+#ifdef SHA256_X86_KERNELS
+	sha256_forced_kernel = kernel;
+#endif
+	return 1;
+}
+
+void sha256_compress_block(const uint8_t block[], uint8_t hash[])
+{
+#ifdef SHA256_X86_KERNELS
+	if (sha256_kernel_in_use() == SHA256_KERNEL_SHANI) {
+		sha256_compress_shani(block, hash);
+		return;
+	}
+#endif
+	sha256_compress_generic(block, hash);
+}
+
+void sha256_compress_x4(const uint8_t blocks[][64], uint8_t out[][SHA256_BLOCK_SIZE])
+{
+	int i;
+
+#ifdef SHA256_X86_KERNELS
+	switch (sha256_kernel_in_use()) {
+	case SHA256_KERNEL_SHANI:
+		for (i = 0; i < 4; ++i)
+			sha256_compress_shani(blocks[i], out[i]);
+		return;
+	case SHA256_KERNEL_AVX2:
+	case SHA256_KERNEL_SSE2:
+		sha256_compress_sse2_x4(blocks, out);
+		return;
+	default:
+		break;
+	}
+#endif
+	for (i = 0; i < 4; ++i)
+		sha256_compress_generic(blocks[i], out[i]);
+}
+
+void sha256_compress_x8(const uint8_t blocks[][64], uint8_t out[][SHA256_BLOCK_SIZE])
+{
+	int i;
+
+#ifdef SHA256_X86_KERNELS
+	switch (sha256_kernel_in_use()) {
+	case SHA256_KERNEL_SHANI:
+		for (i = 0; i < 8; ++i)
+			sha256_compress_shani(blocks[i], out[i]);
+		return;
+	case SHA256_KERNEL_AVX2:
+		sha256_compress_avx2_x8(blocks, out);
+		return;
+	case SHA256_KERNEL_SSE2:
+		sha256_compress_sse2_x4(blocks, out);
+		sha256_compress_sse2_x4(blocks + 4, out + 4);
+		return;
+	default:
+		break;
+	}
+#endif
+	for (i = 0; i < 8; ++i)
+		sha256_compress_generic(blocks[i], out[i]);
+}
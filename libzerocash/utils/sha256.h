@@ -29,4 +29,37 @@ void sha256_update(SHA256_CTX_mod *ctx, const uint8_t data[], size_t len);
 void sha256_length_padding(SHA256_CTX_mod *ctx);
 void sha256_final_no_padding(SHA256_CTX_mod *ctx, uint8_t hash[]);
 
+/* Hashes exactly one 64-byte block from the initial state with no length
+ * padding; the same digest as sha256_init/sha256_update/
+ * sha256_final_no_padding over those 64 bytes, without going through the
+ * context buffer. */
+void sha256_compress_block(const uint8_t block[64], uint8_t hash[SHA256_BLOCK_SIZE]);
+
+/* Multi-block compression. Each 64-byte block is compressed independently
+ * from the initial state with no length padding, exactly as
+ * sha256_init/sha256_update/sha256_final_no_padding would do for a single
+ * block, and the digests are written to the matching entry of out. The kernel
+ * (SHA extensions, AVX2, SSE2 or the portable code) is picked at run time. */
+void sha256_compress_x4(const uint8_t blocks[][64], uint8_t out[][SHA256_BLOCK_SIZE]);
+void sha256_compress_x8(const uint8_t blocks[][64], uint8_t out[][SHA256_BLOCK_SIZE]);
+
+/* For tests only: the kernels above can be forced, so that each one the CPU
+ * supports can be checked whatever the run-time choice would be. The SSE2
+ * kernel hashes four blocks at once and the AVX2 one eight; the AVX2 choice
+ * uses SSE2 for sha256_compress_x4, and both use the portable code for
+ * sha256_compress_block. Forcing a kernel is not thread-safe. */
+typedef enum {
+	SHA256_KERNEL_AUTO = -1,        /* the best one the CPU supports */
+	SHA256_KERNEL_GENERIC = 0,
+	SHA256_KERNEL_SSE2,
+	SHA256_KERNEL_AVX2,
+	SHA256_KERNEL_SHANI,
+	SHA256_KERNEL_COUNT
+} sha256_kernel;
+
+int sha256_kernel_supported(sha256_kernel kernel);
+
+/* Returns 0, and changes nothing, if the CPU does not support kernel. */
+int sha256_force_kernel(sha256_kernel kernel);
+
 #endif   // SHA256H_H
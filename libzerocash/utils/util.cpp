@@ -87,57 +87,140 @@ void getRandBytes(unsigned char* bytes, int num) {
         std::cout << "rand_bytes error!" << ERR_get_error() << std::endl;
 }
 
-void convertBytesToVector(const unsigned char* bytes, std::vector<bool>& v) {
-    int numBytes = v.size() / 8;
-    unsigned char c;
-    for(int i = 0; i < numBytes; i++) {
-        c = bytes[i];
+/*
+ * Bit conversions.
+ *
+ * Bit i of a bit vector is bit (7 - i % 8) of byte i / 8. libstdc++ keeps a
+ * std::vector<bool> as an array of words holding bit i at bit i % W of word
+ * i / W, so with it a whole word is filled from (or split into) W / 8 bytes
+ * at once: byte k of the word is the k-th input byte with its bits reversed.
+ * Other standard libraries, and libstdc++'s debug mode, go through
+ * operator[].
+ */
+
+#if defined(__GLIBCXX__) && !defined(_GLIBCXX_DEBUG)
+#define BIT_VECTOR_WORD_ACCESS
+typedef std::_Bit_type BitWord;
+static const size_t BYTES_PER_WORD = sizeof(BitWord);
+
+static inline BitWord* bitVectorWords(std::vector<bool>& v) {
+    return v.begin()._M_p;
+}
+
+static inline const BitWord* bitVectorWords(const std::vector<bool>& v) {
+    return v.begin()._M_p;
+}
+
+// Reverse the order of the bits within every byte of x.
+static inline BitWord reverseBitsInBytes(BitWord x) {
+    const BitWord m1 = (BitWord) 0x5555555555555555ULL;
+    const BitWord m2 = (BitWord) 0x3333333333333333ULL;
+    const BitWord m4 = (BitWord) 0x0f0f0f0f0f0f0f0fULL;
+    x = ((x >> 1) & m1) | ((x & m1) << 1);
+    x = ((x >> 2) & m2) | ((x & m2) << 2);
+    x = ((x >> 4) & m4) | ((x & m4) << 4);
+    return x;
+}
+
+// The word whose byte k (counting from the least significant) is p[k].
+static inline BitWord loadWord(const unsigned char* p) {
+    BitWord word = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(&word, p, sizeof(word));
+#else
+    for (size_t k = 0; k < BYTES_PER_WORD; k++) {
+        word |= ((BitWord) p[k]) << (8 * k);
+    }
+#endif
+    return word;
+}
+
+static inline void storeWord(unsigned char* p, BitWord word) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(p, &word, sizeof(word));
+#else
+    for (size_t k = 0; k < BYTES_PER_WORD; k++) {
+        p[k] = (unsigned char) (word >> (8 * k));
+    }
+#endif
+}
+#endif
 
-        for(int j = 0; j < 8; j++) {
-            v.at((i*8)+j) = ((c >> (7-j)) & 1);
+// Unpack numBytes bytes into the first 8 * numBytes entries of v.
+static void unpackBits(const unsigned char* bytes, size_t numBytes, std::vector<bool>& v) {
+#ifdef BIT_VECTOR_WORD_ACCESS
+    BitWord* words = bitVectorWords(v);
+    size_t fullWords = numBytes / BYTES_PER_WORD;
+
+    for (size_t w = 0; w < fullWords; w++) {
+        words[w] = reverseBitsInBytes(loadWord(bytes + w * BYTES_PER_WORD));
+    }
+
+    // The last partial word may hold bits past the converted range.
+    for (size_t i = fullWords * BYTES_PER_WORD; i < numBytes; i++) {
+        size_t shift = 8 * (i % BYTES_PER_WORD);
+        BitWord byte = reverseBitsInBytes((BitWord) bytes[i]);
+        words[i / BYTES_PER_WORD] = (words[i / BYTES_PER_WORD] & ~(((BitWord) 0xff) << shift)) | (byte << shift);
+    }
+#else
+    for (size_t i = 0; i < numBytes; i++) {
+        unsigned char c = bytes[i];
+        for (size_t j = 0; j < 8; j++) {
+            v[(i * 8) + j] = (c >> (7 - j)) & 1;
         }
     }
+#endif
 }
 
-void convertVectorToBytes(const std::vector<bool>& v, unsigned char* bytes) {
-    int numBytes = v.size() / 8;
-    unsigned char c = '\0';
-
-    for(int i = 0; i < numBytes; i++) {
-        c = '\0';
-        for(int j = 0; j < 8; j++) {
-            if(j == 7)
-                c = ((c | v.at((i*8)+j)));
-            else
-                c = ((c | v.at((i*8)+j)) << 1);
+// Pack the first 8 * numBytes entries of v into numBytes bytes.
+static void packBits(const std::vector<bool>& v, size_t numBytes, unsigned char* bytes) {
+#ifdef BIT_VECTOR_WORD_ACCESS
+    const BitWord* words = bitVectorWords(v);
+    size_t fullWords = numBytes / BYTES_PER_WORD;
+
+    for (size_t w = 0; w < fullWords; w++) {
+        storeWord(bytes + w * BYTES_PER_WORD, reverseBitsInBytes(words[w]));
+    }
+
+    for (size_t i = fullWords * BYTES_PER_WORD; i < numBytes; i++) {
+        BitWord word = words[i / BYTES_PER_WORD] >> (8 * (i % BYTES_PER_WORD));
+        bytes[i] = (unsigned char) reverseBitsInBytes(word & 0xff);
+    }
+#else
+    for (size_t i = 0; i < numBytes; i++) {
+        unsigned char c = 0;
+        for (size_t j = 0; j < 8; j++) {
+            c = (c << 1) | v[(i * 8) + j];
         }
         bytes[i] = c;
     }
+#endif
+}
+
+void convertBytesToVector(const unsigned char* bytes, std::vector<bool>& v) {
+    unpackBits(bytes, v.size() / 8, v);
+}
+
+void convertVectorToBytes(const std::vector<bool>& v, unsigned char* bytes) {
+    packBits(v, v.size() / 8, bytes);
 }
 
 void convertBytesToBytesVector(const unsigned char* bytes, std::vector<unsigned char>& v) {
-    for(size_t i = 0; i < v.size(); i++) {
-        v.at(i) = bytes[i];
-    }
+    std::copy(bytes, bytes + v.size(), v.begin());
 }
 
 void convertBytesVectorToBytes(const std::vector<unsigned char>& v, unsigned char* bytes) {
-    for(size_t i = 0; i < v.size(); i++) {
-        bytes[i] = v.at(i);
-    }
+    std::copy(v.begin(), v.end(), bytes);
 }
 
 void convertBytesVectorToVector(const std::vector<unsigned char>& bytes, std::vector<bool>& v) {
 	v.resize(bytes.size() * 8);
-    unsigned char bytesArr[bytes.size()];
-    convertBytesVectorToBytes(bytes, bytesArr);
-    convertBytesToVector(bytesArr, v);
+    unpackBits(bytes.data(), bytes.size(), v);
 }
 
 void convertVectorToBytesVector(const std::vector<bool>& v, std::vector<unsigned char>& bytes) {
-    unsigned char bytesArr[int(ceil(v.size() / 8.))];
-    convertVectorToBytes(v, bytesArr);
-    convertBytesToBytesVector(bytesArr, bytes);
+    // Only as many bytes as the caller sized the output for are written.
+    packBits(v, std::min(bytes.size(), v.size() / 8), bytes.data());
 }
 
 void convertIntToBytesVector(const uint64_t val_int, std::vector<unsigned char>& bytes) {
@@ -219,13 +302,23 @@ void sha256(SHA256_CTX_mod* ctx256, const unsigned char* input, unsigned char* h
 	sha256_final_no_padding(ctx256, hash);
 }
 
+// Every hash in libzerocash is over exactly one 64-byte block, which has a
+// dedicated entry point that skips the context buffer.
+static void hashBytes(SHA256_CTX_mod* ctx256, const unsigned char* bytes, unsigned char* hash, int size) {
+    if (size == 64) {
+        sha256_compress_block(bytes, hash);
+    } else {
+        sha256(ctx256, bytes, hash, size);
+    }
+}
+
 void hashVector(SHA256_CTX_mod* ctx256, const std::vector<bool> input, std::vector<bool>& output) {
     int size = int(input.size() / 8);
     unsigned char bytes[size];
     convertVectorToBytes(input, bytes);
 
     unsigned char hash[SHA256_BLOCK_SIZE];
-    sha256(ctx256, bytes, hash, (int)size);
+    hashBytes(ctx256, bytes, hash, size);
 
     convertBytesToVector(hash, output);
 }
@@ -236,7 +329,7 @@ void hashVector(SHA256_CTX_mod* ctx256, const std::vector<unsigned char> input,
     convertBytesVectorToBytes(input, bytes);
 
     unsigned char hash[SHA256_BLOCK_SIZE];
-    sha256(ctx256, bytes, hash, (int)size);
+    hashBytes(ctx256, bytes, hash, size);
 
     convertBytesToBytesVector(hash, output);
 }
@@ -249,7 +342,7 @@ void hashVector(const std::vector<bool> input, std::vector<bool>& output) {
     convertVectorToBytes(input, bytes);
 
     unsigned char hash[SHA256_BLOCK_SIZE];
-    sha256(&ctx256, bytes, hash, (int)size);
+    hashBytes(&ctx256, bytes, hash, size);
 
     convertBytesToVector(hash, output);
 }
@@ -262,7 +355,7 @@ void hashVector(const std::vector<unsigned char> input, std::vector<unsigned cha
     convertBytesVectorToBytes(input, bytes);
 
     unsigned char hash[SHA256_BLOCK_SIZE];
-    sha256(&ctx256, bytes, hash, (int)size);
+    hashBytes(&ctx256, bytes, hash, size);
 
     convertBytesToBytesVector(hash, output);
 }
@@ -276,7 +369,7 @@ void hashVectors(SHA256_CTX_mod* ctx256, const std::vector<bool> left, const std
     convertVectorToBytes(concat, bytes);
 
     unsigned char hash[SHA256_BLOCK_SIZE];
-    sha256(ctx256, bytes, hash, (int)size);
+    hashBytes(ctx256, bytes, hash, size);
 
     convertBytesToVector(hash, output);
 }
@@ -290,14 +383,12 @@ void hashVectors(SHA256_CTX_mod* ctx256, const std::vector<unsigned char> left,
     convertBytesVectorToBytes(concat, bytes);
 
     unsigned char hash[SHA256_BLOCK_SIZE];
-    sha256(ctx256, bytes, hash, (int)size);
+    hashBytes(ctx256, bytes, hash, size);
 
     convertBytesToBytesVector(hash, output);
 }
 
 void hashVectors(const std::vector<bool> left, const std::vector<bool> right, std::vector<bool>& output) {
-	std::cout << std::endl;
-
     std::vector<bool> concat;
     concatenateVectors(left, right, concat);
 
@@ -305,8 +396,9 @@ void hashVectors(const std::vector<bool> left, const std::vector<bool> right, st
     unsigned char bytes[size];
     convertVectorToBytes(concat, bytes);
 
+    SHA256_CTX_mod ctx256;
     unsigned char hash[SHA256_BLOCK_SIZE];
-    sha256(bytes, hash, (int)size);
+    hashBytes(&ctx256, bytes, hash, size);
 
     convertBytesToVector(hash, output);
 }
@@ -319,8 +411,9 @@ void hashVectors(const std::vector<unsigned char> left, const std::vector<unsign
     unsigned char bytes[size];
     convertBytesVectorToBytes(concat, bytes);
 
+    SHA256_CTX_mod ctx256;
     unsigned char hash[SHA256_BLOCK_SIZE];
-    sha256(bytes, hash, (int)size);
+    hashBytes(&ctx256, bytes, hash, size);
 
     convertBytesToBytesVector(hash, output);
 }
@@ -7,6 +7,7 @@
 #include <cstdint>
 
 #include "sha256.h"
+#include "Bits.h"
 
 namespace libzerocash {
 
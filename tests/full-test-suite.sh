@@ -26,6 +26,7 @@ cd "${REPOROOT}"
 run_test_phase "${REPOROOT}/tests/utilTest"
 run_test_phase "${REPOROOT}/tests/zerocashTest"
 run_test_phase "${REPOROOT}/tests/merkleTest"
+run_test_phase "${REPOROOT}/tests/serialNumberSetTest"
 run_test_phase "${REPOROOT}/zerocash_pour_ppzksnark/tests/test_zerocash_pour_ppzksnark"
 
 exit $SUITE_EXIT_STATUS
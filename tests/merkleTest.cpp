@@ -10,7 +10,9 @@
  *****************************************************************************/
 
 #include "libzerocash/IncrementalMerkleTree.h"
+#include "libzerocash/PersistentMerkleTree.h"
 
+#include <cstdio>
 #include <iostream>
 #include <vector>
 
@@ -127,3 +129,249 @@ BOOST_AUTO_TEST_CASE( testCompactRepresentation ) {
         BOOST_REQUIRE( root1 == root2 );
     }
 }
+
+void constructDistinctTestVector(std::vector< std::vector<bool> > &values, uint32_t size)
+{
+    values.resize(0);
+    for (uint32_t i = 0; i < size; i++)
+    {
+        std::vector<bool> value;
+        std::vector<bool> counter;
+        libzerocash::convertIntToVector(i, counter);
+        value.insert(value.end(), 192, true);
+        value.insert(value.end(), counter.begin(), counter.end());
+        values.push_back(value);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( testWitnessesAuthenticateToRoot ) {
+    for (uint32_t height = 1; height <= 6; height++) {
+        std::vector< std::vector<bool> > values;
+        std::vector<bool> root;
+        SHA256_CTX_mod ctx;
+
+        constructDistinctTestVector(values, (1 << height) - 1);
+        IncrementalMerkleTree incTree(values, height);
+        incTree.getRootValue(root);
+
+        for (uint32_t i = 0; i < values.size(); i++) {
+            std::vector<bool> index;
+            merkle_authentication_path witness(height);
+            libzerocash::convertIntToVector(i, index);
+            BOOST_REQUIRE( incTree.getWitness(index, witness) );
+
+            // Walk from the leaf back up to the root.
+            std::vector<bool> node = values.at(i);
+            for (uint32_t depth = height; depth-- > 0; ) {
+                std::vector<bool> parent(256);
+                if ((i >> (height - 1 - depth)) & 1) {
+                    libzerocash::hashVectors(&ctx, witness.at(depth), node, parent);
+                } else {
+                    libzerocash::hashVectors(&ctx, node, witness.at(depth), parent);
+                }
+                node = parent;
+            }
+            BOOST_CHECK( node == root );
+        }
+
+        // Nothing has been inserted at the last position yet.
+        std::vector<bool> index;
+        merkle_authentication_path witness(height);
+        libzerocash::convertIntToVector(values.size(), index);
+        BOOST_CHECK( !incTree.getWitness(index, witness) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( testPruneKeepsRightEdge ) {
+    std::vector< std::vector<bool> > values;
+    std::vector<bool> root1, root2;
+
+    constructDistinctTestVector(values, 11);
+    IncrementalMerkleTree pruned(16), full(16);
+
+    for (uint32_t i = 0; i < values.size(); i++) {
+        std::vector<bool> index;
+        BOOST_REQUIRE( pruned.insertElement(values.at(i), index) );
+        BOOST_REQUIRE( full.insertElement(values.at(i), index) );
+        BOOST_REQUIRE( pruned.prune() );
+
+        pruned.getRootValue(root1);
+        full.getRootValue(root2);
+        BOOST_REQUIRE( root1 == root2 );
+    }
+
+    // Leaves inside full subtrees can no longer be authenticated, but the
+    // most recent one (whose subtree is not yet full) still can.
+    std::vector<bool> index;
+    merkle_authentication_path witness1(16), witness2(16);
+    libzerocash::convertIntToVector(0, index);
+    BOOST_CHECK( !pruned.getWitness(index, witness1) );
+    libzerocash::convertIntToVector(10, index);
+    BOOST_CHECK( pruned.getWitness(index, witness1) );
+    BOOST_CHECK( full.getWitness(index, witness2) );
+    BOOST_CHECK( witness1 == witness2 );
+}
+
+BOOST_AUTO_TEST_CASE( testAppendBatchMatchesSequentialInserts ) {
+    std::vector< std::vector<bool> > values;
+    constructDistinctTestVector(values, 37);
+
+    for (uint32_t split = 0; split <= values.size(); split += 5) {
+        IncrementalMerkleTree sequential(8), batched(8);
+        std::vector<bool> root1, root2;
+
+        for (uint32_t i = 0; i < values.size(); i++) {
+            std::vector<bool> index;
+            BOOST_REQUIRE( sequential.insertElement(values.at(i), index) );
+        }
+
+        // Insert a prefix one at a time and prune, then the rest in one batch.
+        for (uint32_t i = 0; i < split; i++) {
+            std::vector<bool> index;
+            BOOST_REQUIRE( batched.insertElement(values.at(i), index) );
+        }
+        BOOST_REQUIRE( batched.prune() );
+        std::vector< std::vector<bool> > rest(values.begin() + split, values.end());
+        BOOST_REQUIRE( batched.appendBatch(rest) );
+
+        sequential.getRootValue(root1);
+        batched.getRootValue(root2);
+        BOOST_CHECK( root1 == root2 );
+
+        IncrementalMerkleTreeCompact compact1 = sequential.getCompactRepresentation();
+        IncrementalMerkleTreeCompact compact2 = batched.getCompactRepresentation();
+        BOOST_CHECK( compact1.getHashListBytes() == compact2.getHashListBytes() );
+        BOOST_CHECK( compact1.getHashVec() == compact2.getHashVec() );
+    }
+
+    // A batch that does not fit is rejected as a whole.
+    IncrementalMerkleTree small(5);
+    std::vector<bool> before, after;
+    small.getRootValue(before);
+    BOOST_CHECK( !small.appendBatch(values) );
+    small.getRootValue(after);
+    BOOST_CHECK( before == after );
+}
+
+BOOST_AUTO_TEST_CASE( testLargeBatchMatchesSequentialInserts ) {
+    // Large enough for the levels near the leaves to be hashed in parallel
+    // when built with MULTICORE.
+    std::vector< std::vector<bool> > values;
+    std::vector<bool> root1, root2;
+    constructDistinctTestVector(values, 1000);
+
+    IncrementalMerkleTree sequential(20);
+    for (uint32_t i = 0; i < values.size(); i++) {
+        std::vector<bool> index;
+        BOOST_REQUIRE( sequential.insertElement(values.at(i), index) );
+    }
+
+    IncrementalMerkleTree batched(values, 20);
+
+    sequential.getRootValue(root1);
+    batched.getRootValue(root2);
+    BOOST_CHECK( root1 == root2 );
+}
+
+BOOST_AUTO_TEST_CASE( testPersistentTreeMatchesIncrementalTree ) {
+    const char* path = "merkleTest.tree";
+    std::vector< std::vector<bool> > values;
+    constructDistinctTestVector(values, 64);
+    std::remove(path);
+
+    IncrementalMerkleTree incTree(6);
+    {
+        PersistentMerkleTree diskTree(path, 6);
+        for (uint32_t i = 0; i < 20; i++) {
+            std::vector<bool> index1, index2, root1, root2;
+            BOOST_REQUIRE( incTree.insertElement(values.at(i), index1) );
+            BOOST_REQUIRE( diskTree.insertElement(values.at(i), index2) );
+            BOOST_CHECK( index1 == index2 );
+
+            incTree.getRootValue(root1);
+            diskTree.getRootValue(root2);
+            BOOST_REQUIRE( root1 == root2 );
+        }
+
+        std::vector< std::vector<bool> > rest(values.begin() + 20, values.begin() + 45);
+        BOOST_REQUIRE( incTree.appendBatch(rest) );
+        BOOST_REQUIRE( diskTree.appendBatch(rest) );
+    }
+
+    // Reopening the file gives back the same tree, with witnesses for every
+    // leaf, and it can keep growing.
+    {
+        PersistentMerkleTree diskTree(path, 6);
+        BOOST_REQUIRE( diskTree.size() == 45 );
+
+        std::vector< std::vector<bool> > rest(values.begin() + 45, values.end());
+        BOOST_REQUIRE( incTree.appendBatch(rest) );
+        BOOST_REQUIRE( diskTree.appendBatch(rest) );
+
+        std::vector<bool> root1, root2;
+        incTree.getRootValue(root1);
+        diskTree.getRootValue(root2);
+        BOOST_CHECK( root1 == root2 );
+
+        for (uint32_t i = 0; i < values.size(); i++) {
+            std::vector<bool> index;
+            merkle_authentication_path witness1(6), witness2(6);
+            libzerocash::convertIntToVector(i, index);
+            BOOST_REQUIRE( incTree.getWitness(index, witness1) );
+            BOOST_REQUIRE( diskTree.getWitness(index, witness2) );
+            BOOST_CHECK( witness1 == witness2 );
+        }
+
+        // The tree is full.
+        std::vector<bool> index;
+        BOOST_CHECK( !diskTree.insertElement(values.at(0), index) );
+    }
+
+    BOOST_CHECK_THROW( PersistentMerkleTree(path, 7), std::runtime_error );
+    std::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE( testIncrementalWitnessFollowsTree ) {
+    std::vector< std::vector<bool> > values;
+    constructDistinctTestVector(values, 40);
+
+    // A wallet that prunes its tree after taking witnesses for some leaves.
+    IncrementalMerkleTree full(6), pruned(6);
+    std::vector<IncrementalWitness> witnesses;
+
+    for (uint32_t i = 0; i < values.size(); i++) {
+        std::vector<bool> index;
+        BOOST_REQUIRE( full.insertElement(values.at(i), index) );
+        BOOST_REQUIRE( pruned.insertElement(values.at(i), index) );
+
+        for (size_t w = 0; w < witnesses.size(); w++) {
+            BOOST_REQUIRE( witnesses[w].append(values.at(i)) );
+        }
+        if (i % 3 == 0) {
+            IncrementalWitness witness;
+            BOOST_REQUIRE( pruned.getIncrementalWitness(witness) );
+            BOOST_REQUIRE( witness.getPosition() == i );
+            witnesses.push_back(witness);
+        }
+        BOOST_REQUIRE( pruned.prune() );
+
+        std::vector<bool> root;
+        full.getRootValue(root);
+        for (size_t w = 0; w < witnesses.size(); w++) {
+            std::vector<bool> witnessRoot;
+            merkle_authentication_path path1(6), path2;
+
+            libzerocash::convertIntToVector(witnesses[w].getPosition(), index);
+            BOOST_REQUIRE( full.getWitness(index, path1) );
+            witnesses[w].getWitness(path2);
+            BOOST_CHECK( path1 == path2 );
+
+            witnesses[w].getRootValue(witnessRoot);
+            BOOST_CHECK( witnessRoot == root );
+        }
+    }
+
+    // An empty tree has no leaf to track.
+    IncrementalWitness witness;
+    BOOST_CHECK( !IncrementalMerkleTree(6).getIncrementalWitness(witness) );
+}
@@ -0,0 +1,150 @@
+/** @file
+ *****************************************************************************
+
+ Test for the serial number set.
+
+ *****************************************************************************
+ * @author     This file is part of libzerocash, developed by the Zerocash
+ *             project and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include "libzerocash/SerialNumberSet.h"
+#include "libzerocash/utils/util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define BOOST_TEST_MODULE serialNumberSetTest
+#include <boost/test/included/unit_test.hpp>
+
+using namespace libzerocash;
+using namespace std;
+
+vector<Digest256> randomSerials(size_t count)
+{
+    vector<Digest256> serials(count);
+    for (size_t i = 0; i < count; i++) {
+        getRandBytes(serials[i].data(), Digest256::BYTES);
+    }
+    return serials;
+}
+
+// Inserts, looks up and grows a set, checking it against std::set.
+void exerciseSet(SerialNumberSet &set)
+{
+    vector<Digest256> serials = randomSerials(5000);
+    vector<Digest256> unspent = randomSerials(5000);
+    std::set<Digest256> reference;
+
+    for (size_t i = 0; i < 1000; i++) {
+        BOOST_CHECK(set.insert(serials[i]));
+        reference.insert(serials[i]);
+    }
+    BOOST_CHECK(!set.insert(serials[0]));
+
+    // A batch with a repeat inside it and one already in the set.
+    vector<Digest256> batch(serials.begin() + 1000, serials.end());
+    batch.push_back(serials[2000]);
+    batch.push_back(serials[10]);
+    vector<bool> inserted;
+    BOOST_CHECK(set.insertBatch(batch, inserted) == 4000);
+    BOOST_CHECK(inserted.size() == batch.size());
+    BOOST_CHECK(inserted[0] && !inserted[4000] && !inserted[4001]);
+    reference.insert(serials.begin() + 1000, serials.end());
+
+    BOOST_CHECK(set.size() == reference.size());
+    BOOST_CHECK(set.getCapacity() >= 2 * set.size());
+
+    vector<bool> found;
+    BOOST_CHECK(set.containsBatch(serials, found));
+    BOOST_CHECK(std::find(found.begin(), found.end(), false) == found.end());
+    BOOST_CHECK(!set.containsBatch(unspent, found));
+    for (size_t i = 0; i < unspent.size(); i++) {
+        BOOST_CHECK(!set.contains(unspent[i]));
+    }
+
+    // The zero serial number is the one that cannot go in the table.
+    Digest256 zero;
+    BOOST_CHECK(!set.contains(zero));
+    BOOST_CHECK(set.insert(zero));
+    BOOST_CHECK(!set.insert(zero));
+    BOOST_CHECK(set.contains(zero));
+    BOOST_CHECK(set.size() == reference.size() + 1);
+}
+
+BOOST_AUTO_TEST_CASE( testInMemorySet ) {
+    SerialNumberSet set(16);
+    exerciseSet(set);
+
+    SerialNumberSet filtered(16, 10);
+    exerciseSet(filtered);
+}
+
+BOOST_AUTO_TEST_CASE( testPersistentSet ) {
+    const std::string path = "/tmp/libzerocash_serialNumberSetTest.dat";
+    remove(path.c_str());
+
+    vector<Digest256> serials = randomSerials(3000);
+    vector<bool> inserted;
+    {
+        SerialNumberSet set(path, 16, 8);
+        set.insertBatch(serials, inserted);
+        set.insert(Digest256());
+    }
+
+    {
+        SerialNumberSet reopened(path);
+        BOOST_CHECK(reopened.size() == serials.size() + 1);
+        vector<bool> found;
+        reopened.containsBatch(serials, found);
+        BOOST_CHECK(std::find(found.begin(), found.end(), false) == found.end());
+        BOOST_CHECK(reopened.contains(Digest256()));
+        BOOST_CHECK(!reopened.contains(randomSerials(1)[0]));
+    }
+
+    // A fresh file grows by being rewritten.
+    remove(path.c_str());
+    {
+        SerialNumberSet fresh(path, 16, 10);
+        exerciseSet(fresh);
+    }
+    {
+        SerialNumberSet reopened(path);
+        BOOST_CHECK(reopened.size() == 5001);
+    }
+
+    remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( testPersistentSetRejectsUncleanFile ) {
+    const std::string path = "/tmp/libzerocash_serialNumberSetTest_unclean.dat";
+    remove(path.c_str());
+
+    {
+        SerialNumberSet set(path);
+        set.insert(randomSerials(1)[0]);
+
+        // Copy the file as it is before the flush, as if the process had
+        // died here.
+        FILE *in = fopen(path.c_str(), "rb");
+        FILE *out = fopen((path + ".copy").c_str(), "wb");
+        BOOST_REQUIRE(in != NULL && out != NULL);
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+            fwrite(buf, 1, n, out);
+        }
+        fclose(in);
+        fclose(out);
+    }
+
+    BOOST_CHECK_THROW(SerialNumberSet((path + ".copy")), std::runtime_error);
+
+    remove(path.c_str());
+    remove((path + ".copy").c_str());
+}
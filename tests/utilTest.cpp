@@ -172,6 +172,28 @@ BOOST_AUTO_TEST_CASE( testConvertVectorToBytesVector ) {
     BOOST_CHECK(actual_bytes == expected_bytes);
 }
 
+BOOST_AUTO_TEST_CASE( testConvertLongAndUnalignedVectors ) {
+    /* Lengths that do not fill the last storage word of a std::vector<bool>,
+     * or that are not a whole number of bytes. Bits past the last whole byte
+     * must be left alone. */
+    for (size_t numBits : { 8, 56, 64, 72, 257, 519, 8 * 1024 + 3 }) {
+        std::vector<unsigned char> bytes(numBits / 8);
+        libzerocash::getRandBytes(bytes.data(), bytes.size());
+
+        std::vector<bool> bits(numBits, true);
+        libzerocash::convertBytesToVector(bytes.data(), bits);
+
+        for (size_t i = 0; i < numBits; i++) {
+            bool expected = (i < 8 * bytes.size()) ? ((bytes[i / 8] >> (7 - i % 8)) & 1) : true;
+            BOOST_REQUIRE( bits[i] == expected );
+        }
+
+        std::vector<unsigned char> packed(bytes.size());
+        libzerocash::convertVectorToBytes(bits, packed.data());
+        BOOST_CHECK( packed == bytes );
+    }
+}
+
 BOOST_AUTO_TEST_CASE( testConvertIntToBytesVector ) {
     uint64_t val;
     std::vector<unsigned char> expected;
@@ -381,6 +403,67 @@ BOOST_AUTO_TEST_CASE( testSHA256TestVectors ) {
     BOOST_CHECK( memcmp(expected_hash, actual_hash, 32) == 0 );
 }
 
+BOOST_AUTO_TEST_CASE( testSHA256CompressBlock ) {
+    /* The single-block entry point and the whole-block path through
+     * sha256_update must both match feeding the block in a byte at a time. */
+    unsigned char block[64];
+    unsigned char expected[32];
+    unsigned char direct[32];
+    unsigned char updated[32];
+    SHA256_CTX_mod ctx256;
+
+    libzerocash::getRandBytes(block, 64);
+
+    sha256_init(&ctx256);
+    for (int i = 0; i < 64; i++) {
+        sha256_update(&ctx256, block + i, 1);
+    }
+    sha256_final_no_padding(&ctx256, expected);
+
+    sha256_compress_block(block, direct);
+    libzerocash::sha256(block, updated, 64);
+
+    BOOST_CHECK( memcmp(expected, direct, 32) == 0 );
+    BOOST_CHECK( memcmp(expected, updated, 32) == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( testSHA256MultiBlockCompression ) {
+    /* Every kernel the CPU supports, and not only the one picked at run
+     * time, must agree with hashing each 64-byte block on its own. */
+    unsigned char blocks[8][64];
+    unsigned char expected[8][32];
+    unsigned char actual1[8][32];
+    unsigned char actual4[8][32];
+    unsigned char actual8[8][32];
+
+    for (int kernel = SHA256_KERNEL_AUTO; kernel < SHA256_KERNEL_COUNT; kernel++) {
+        if (!sha256_force_kernel((sha256_kernel) kernel)) {
+            BOOST_TEST_MESSAGE("SHA-256 kernel " << kernel << " is not supported here");
+            continue;
+        }
+
+        for (int round = 0; round < 16; round++) {
+            libzerocash::getRandBytes(&blocks[0][0], sizeof(blocks));
+            for (int i = 0; i < 8; i++) {
+                libzerocash::sha256(blocks[i], expected[i], 64);
+                sha256_compress_block(blocks[i], actual1[i]);
+            }
+
+            sha256_compress_x4(blocks, actual4);
+            sha256_compress_x4(blocks + 4, actual4 + 4);
+            sha256_compress_x8(blocks, actual8);
+
+            BOOST_CHECK( memcmp(expected, actual1, sizeof(expected)) == 0 );
+            BOOST_CHECK( memcmp(expected, actual4, sizeof(expected)) == 0 );
+            BOOST_CHECK( memcmp(expected, actual8, sizeof(expected)) == 0 );
+        }
+    }
+
+    BOOST_CHECK(sha256_kernel_supported(SHA256_KERNEL_GENERIC));
+    BOOST_CHECK(!sha256_force_kernel(SHA256_KERNEL_COUNT));
+    sha256_force_kernel(SHA256_KERNEL_AUTO);
+}
+
 BOOST_AUTO_TEST_CASE( testHashBoolVectorToBoolVectorCTX ) {
     SHA256_CTX_mod ctx256;
 
@@ -532,3 +615,27 @@ BOOST_AUTO_TEST_CASE( testVectorIsZero ) {
     BOOST_CHECK( !libzerocash::VectorIsZero(bits) );
 }
 
+
+BOOST_AUTO_TEST_CASE( testBitsMatchBitVectors ) {
+    unsigned char bytes[32];
+    libzerocash::getRandBytes(bytes, 32);
+
+    std::vector<bool> expected(256);
+    libzerocash::convertBytesToVector(bytes, expected);
+
+    libzerocash::Digest256 digest(bytes);
+    BOOST_CHECK( digest.toBitVector() == expected );
+    BOOST_CHECK( libzerocash::Digest256::fromBitVector(expected) == digest );
+    BOOST_CHECK_THROW( libzerocash::Digest256::fromBitVector(std::vector<bool>(255)), std::length_error );
+
+    /* Tagging drops the trailing bits and prepends the tag. */
+    std::vector<bool> tagged = expected;
+    tagged.erase(tagged.end() - 3, tagged.end());
+    tagged.insert(tagged.begin(), { 1, 0, 1 });
+    BOOST_CHECK( digest.withPrefix(0x5, 3).toBitVector() == tagged );
+
+    std::vector<unsigned char> value(8);
+    libzerocash::convertIntToBytesVector(0x0123456789abcdefULL, value);
+    BOOST_CHECK( libzerocash::Bits<64>::fromInt(0x0123456789abcdefULL).toBytesVector() == value );
+    BOOST_CHECK( libzerocash::Bits<64>::fromBytesVector(value).toInt() == 0x0123456789abcdefULL );
+}
@@ -10,7 +10,12 @@
  *****************************************************************************/
 
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
 
 #define BOOST_TEST_MODULE zerocashTest
 #include <boost/test/included/unit_test.hpp>
@@ -20,14 +25,20 @@
 #include "libzerocash/Zerocash.h"
 #include "libzerocash/ZerocashParams.h"
 #include "libzerocash/Address.h"
+#include "libzerocash/BlockValidator.h"
 #include "libzerocash/CoinCommitment.h"
 #include "libzerocash/Coin.h"
 #include "libzerocash/IncrementalMerkleTree.h"
 #include "libzerocash/MintTransaction.h"
+#include "libzerocash/PourBatchBuilder.h"
 #include "libzerocash/PourTransaction.h"
+#include "libzerocash/PourTransactionView.h"
+#include "libzerocash/PourVerifier.h"
 #include "libzerocash/PourInput.h"
 #include "libzerocash/PourOutput.h"
+#include "libzerocash/SerialNumberSet.h"
 #include "libzerocash/utils/util.h"
+#include "libzerocash/utils/sha256.h"
 
 using namespace std;
 using namespace libsnark;
@@ -64,13 +75,27 @@ BOOST_AUTO_TEST_CASE( SaveAndLoadKeysFromFiles ) {
 
     libzerocash::timer_start("Saving Verification Key");
 
+    std::vector<unsigned char> vk_digest;
     libzerocash::ZerocashParams::SaveVerificationKeyToFile(
         &p.getVerificationKey(),
-        vk_path
+        vk_path,
+        &vk_digest
     );
 
     libzerocash::timer_stop("Saving Verification Key");
 
+    {
+        std::ifstream vk_file(vk_path, std::ios::binary);
+        std::vector<unsigned char> vk_bytes((std::istreambuf_iterator<char>(vk_file)), std::istreambuf_iterator<char>());
+        std::vector<unsigned char> vk_file_digest(SHA256_BLOCK_SIZE);
+        SHA256_CTX_mod ctx;
+        sha256_init(&ctx);
+        sha256_update(&ctx, vk_bytes.data(), vk_bytes.size());
+        sha256_length_padding(&ctx);
+        sha256_final_no_padding(&ctx, vk_file_digest.data());
+        BOOST_CHECK(vk_digest == vk_file_digest);
+    }
+
     libzerocash::timer_start("Loading Proving Key");
     auto pk_loaded = libzerocash::ZerocashParams::LoadProvingKeyFromFile(pk_path, TEST_TREE_DEPTH);
     libzerocash::timer_stop("Loading Proving Key");
@@ -85,6 +110,30 @@ BOOST_AUTO_TEST_CASE( SaveAndLoadKeysFromFiles ) {
         BOOST_ERROR("Proving and verification key are not equal.");
     }
 
+    std::string pk_binary_path = "./zerocashTest-proving-key.bin";
+
+    libzerocash::timer_start("Saving Binary Proving Key");
+    libzerocash::ZerocashParams::SaveProvingKeyToBinaryFile(
+        &p.getProvingKey(),
+        pk_binary_path
+    );
+    libzerocash::timer_stop("Saving Binary Proving Key");
+
+    libzerocash::timer_start("Loading Binary Proving Key");
+    auto pk_binary_loaded = libzerocash::ZerocashParams::LoadProvingKeyFromBinaryFile(pk_binary_path, TEST_TREE_DEPTH);
+    libzerocash::timer_stop("Loading Binary Proving Key");
+
+    if ( !(p.getProvingKey() == pk_binary_loaded) ) {
+        BOOST_ERROR("Proving key loaded from the binary format is not equal.");
+    }
+
+    auto pk_binary_loaded_1 = libzerocash::ZerocashParams::LoadProvingKeyFromBinaryFile(pk_binary_path, TEST_TREE_DEPTH, 1);
+    if ( !(p.getProvingKey() == pk_binary_loaded_1) ) {
+        BOOST_ERROR("Proving key loaded from the binary format on one thread is not equal.");
+    }
+
+    BOOST_CHECK_THROW(libzerocash::ZerocashParams::LoadProvingKeyFromBinaryFile(pk_binary_path, TEST_TREE_DEPTH + 1), std::runtime_error);
+
     vector<libzerocash::Coin> coins;
     vector<libzerocash::Address> addrs;
 
@@ -165,6 +214,60 @@ BOOST_AUTO_TEST_CASE( SaveAndLoadKeysFromFiles ) {
     bool pourtx_res = pourtx.verify(p, pubkeyHash, rt);
 
     BOOST_CHECK(pourtx_res);
+
+    cout << "Verifying pour transactions concurrently...\n" << endl;
+    vector<unsigned char> bad_rt(rt);
+    bad_rt[0] ^= 1;
+    {
+        libzerocash::PourVerifier verifier(p, 2);
+        vector<std::future<bool> > results;
+        for (size_t i = 0; i < 4; i++) {
+            results.push_back(verifier.submit(pourtx, pubkeyHash, rt));
+        }
+        std::future<bool> bad_result = verifier.submit(pourtx, pubkeyHash, bad_rt);
+
+        // A transaction cancelled before a thread takes it is not verified.
+        std::shared_ptr<std::atomic<bool> > cancelled = std::make_shared<std::atomic<bool> >(true);
+        std::future<bool> cancelled_result = verifier.submit(pourtx, pubkeyHash, rt, cancelled);
+
+        for (size_t i = 0; i < results.size(); i++) {
+            BOOST_CHECK(results[i].get());
+        }
+        BOOST_CHECK(!bad_result.get());
+        BOOST_CHECK(!cancelled_result.get());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( ZerocashParamsConstructorsTest ) {
+    auto keypair = libzerocash::ZerocashParams::GenerateNewKeyPair(TEST_TREE_DEPTH);
+    const auto keypair_copy = keypair;
+
+    // Moving the keypair in gives the same keys as copying it.
+    libzerocash::ZerocashParams p_copied(TEST_TREE_DEPTH, &keypair);
+    libzerocash::ZerocashParams p_moved(TEST_TREE_DEPTH, std::move(keypair));
+    BOOST_CHECK(p_moved.getProvingKey() == keypair_copy.pk);
+    BOOST_CHECK(p_moved.getVerificationKey() == keypair_copy.vk);
+    BOOST_CHECK(p_copied.getProvingKey() == p_moved.getProvingKey());
+    BOOST_CHECK(&p_copied.getProvingKey() != &p_moved.getProvingKey());
+
+    // Shared keys are used in place, not copied.
+    libzerocash::ZerocashParams p_shared(
+        TEST_TREE_DEPTH,
+        p_moved.getSharedProvingKey(),
+        p_moved.getSharedVerificationKey()
+    );
+    BOOST_CHECK(&p_shared.getProvingKey() == &p_moved.getProvingKey());
+    BOOST_CHECK(&p_shared.getVerificationKey() == &p_moved.getVerificationKey());
+    BOOST_CHECK(p_shared.getTreeDepth() == TEST_TREE_DEPTH);
+
+    // A verifier needs no proving key.
+    libzerocash::ZerocashParams p_verifier(TEST_TREE_DEPTH, nullptr, p_moved.getSharedVerificationKey());
+    BOOST_CHECK(&p_verifier.getVerificationKey() == &p_moved.getVerificationKey());
+
+    // Moving a ZerocashParams keeps its keys where they are.
+    const void* pk_address = &p_shared.getProvingKey();
+    libzerocash::ZerocashParams p_moved_again(std::move(p_shared));
+    BOOST_CHECK(&p_moved_again.getProvingKey() == pk_address);
 }
 
 BOOST_AUTO_TEST_CASE( PourInputOutputTest ) {
@@ -281,6 +384,306 @@ BOOST_AUTO_TEST_CASE( PourVpubInTest ) {
     BOOST_CHECK_THROW(test_pour(p, 0, 0, {2, 2}, {2, 3}), std::invalid_argument);
 }
 
+BOOST_AUTO_TEST_CASE( PourBatchBuilderTest ) {
+    auto keypair = libzerocash::ZerocashParams::GenerateNewKeyPair(TEST_TREE_DEPTH);
+    libzerocash::ZerocashParams p(
+        TEST_TREE_DEPTH,
+        std::move(keypair)
+    );
+
+    libzerocash::IncrementalMerkleTree merkleTree(TEST_TREE_DEPTH);
+    vector<unsigned char> rt(ZC_ROOT_SIZE);
+    {
+        vector<bool> root_bv(ZC_ROOT_SIZE * 8);
+        merkleTree.getRootValue(root_bv);
+        libzerocash::convertVectorToBytesVector(root_bv, rt);
+    }
+
+    vector<unsigned char> as(ZC_SIG_PK_SIZE, 'a');
+
+    libzerocash::PourPhaseCounters counters;
+    p.setPourMetrics(&counters);
+
+    libzerocash::PourBatchBuilder builder(p, 2);
+    for (uint64_t i = 1; i <= 5; i++) {
+        BOOST_CHECK(builder.add(as, rt, {}, { libzerocash::PourOutput(i) }, i, 0) == i - 1);
+    }
+    BOOST_CHECK(builder.size() == 5);
+
+    vector<libzerocash::PourTransaction> txs = builder.build();
+    BOOST_CHECK(builder.size() == 0);
+    BOOST_REQUIRE(txs.size() == 5);
+    for (size_t i = 0; i < txs.size(); i++) {
+        BOOST_CHECK(txs[i].getPublicValueIn() == i + 1);
+        BOOST_CHECK(txs[i].verify(p, as, rt));
+    }
+
+    libzerocash::PourPhaseCounters::Totals totals = counters.getTotals();
+    BOOST_CHECK(totals.pours == 5);
+    BOOST_CHECK(totals.wallNanos[libzerocash::POUR_PHASE_PROOF] > 0);
+    BOOST_CHECK(totals.cpuNanos[libzerocash::POUR_PHASE_WITNESS] > 0);
+    BOOST_CHECK(totals.maxWallNanos[libzerocash::POUR_PHASE_ENCRYPTION] <= totals.wallNanos[libzerocash::POUR_PHASE_ENCRYPTION]);
+
+    // An unbalanced pour fails the whole batch.
+    builder.add(as, rt, {}, { libzerocash::PourOutput(1) }, 1, 0);
+    builder.add(as, rt, {}, { libzerocash::PourOutput(2) }, 1, 0);
+    BOOST_CHECK_THROW(builder.build(), std::invalid_argument);
+    BOOST_CHECK(builder.size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE( PourTransactionViewTest ) {
+    auto keypair = libzerocash::ZerocashParams::GenerateNewKeyPair(TEST_TREE_DEPTH);
+    libzerocash::ZerocashParams p(
+        TEST_TREE_DEPTH,
+        std::move(keypair)
+    );
+
+    libzerocash::IncrementalMerkleTree merkleTree(TEST_TREE_DEPTH);
+    vector<unsigned char> rt(ZC_ROOT_SIZE);
+    merkleTree.getRootValue(rt);
+
+    vector<unsigned char> as(ZC_SIG_PK_SIZE, 'a');
+    vector<unsigned char> bs(ZC_SIG_PK_SIZE, 'b');
+
+    libzerocash::PourTransaction pourtx(p, as, rt, {}, { libzerocash::PourOutput(2), libzerocash::PourOutput(1) }, 3, 0);
+    vector<uint8_t> encoded(ZC_TX_POUR_SIZE);
+    pourtx.serialize(&encoded[0]);
+
+    libzerocash::PourTransactionView view(&encoded[0]);
+    BOOST_CHECK(view.data() == &encoded[0]);
+    BOOST_CHECK(view.getVersion() == 1);
+    BOOST_CHECK(view.getPublicValueIn() == pourtx.getPublicValueIn());
+    BOOST_CHECK(view.getPublicValueOut() == pourtx.getPublicValueOut());
+    BOOST_CHECK(vector<unsigned char>(view.getSpentSerial1(), view.getSpentSerial1() + ZC_SN_SIZE) == pourtx.getSpentSerial1());
+    BOOST_CHECK(vector<unsigned char>(view.getSpentSerial2(), view.getSpentSerial2() + ZC_SN_SIZE) == pourtx.getSpentSerial2());
+    BOOST_CHECK(vector<unsigned char>(view.getNewCoinCommitmentValue1(), view.getNewCoinCommitmentValue1() + ZC_CM_SIZE) == pourtx.getNewCoinCommitmentValue1());
+    BOOST_CHECK(vector<unsigned char>(view.getNewCoinCommitmentValue2(), view.getNewCoinCommitmentValue2() + ZC_CM_SIZE) == pourtx.getNewCoinCommitmentValue2());
+    BOOST_CHECK(string((const char*) view.getCiphertext1(), ZC_C_SIZE) == pourtx.getCiphertext1());
+    BOOST_CHECK(string((const char*) view.getCiphertext2(), ZC_C_SIZE) == pourtx.getCiphertext2());
+
+    // The view and the transaction agree on a valid pour, and on the wrong
+    // public key hash or root.
+    vector<unsigned char> bad_rt(rt);
+    bad_rt[0] ^= 1;
+    BOOST_CHECK(pourtx.verify(p, as, rt) && view.verify(p, as, rt));
+    BOOST_CHECK(!pourtx.verify(p, bs, rt) && !view.verify(p, bs, rt));
+    BOOST_CHECK(!pourtx.verify(p, as, bad_rt) && !view.verify(p, as, bad_rt));
+
+    const size_t proofOffset = ZC_TX_VERSION_SIZE + 2 * ZC_V_SIZE + 2 * ZC_SN_SIZE + 2 * ZC_CM_SIZE + 2 * ZC_H_SIZE;
+
+    // A damaged proof that still decodes: the first point, negated.
+    vector<uint8_t> damaged(encoded);
+    damaged[proofOffset] ^= 0x40;
+    libzerocash::PourTransaction damaged_tx;
+    damaged_tx.deserialize(&damaged[0]);
+    libzerocash::PourTransactionView damaged_view(&damaged[0]);
+    BOOST_CHECK(!damaged_tx.verify(p, as, rt));
+    BOOST_CHECK(!damaged_view.verify(p, as, rt));
+
+    // A proof that does not decode fails verification through the view, as
+    // it fails to deserialize into a transaction.
+    damaged = encoded;
+    damaged[proofOffset] |= 0x3f;     // x no longer reduced
+    BOOST_CHECK_THROW(damaged_tx.deserialize(&damaged[0]), std::invalid_argument);
+    BOOST_CHECK(!damaged_view.verify(p, as, rt));
+
+    // A pour relabelled as version 0, which carries no proof, fails.
+    damaged = encoded;
+    damaged[0] = damaged[1] = 0;
+    BOOST_CHECK(damaged_view.getVersion() == 0);
+    BOOST_CHECK(!damaged_view.verify(p, as, rt));
+}
+
+BOOST_AUTO_TEST_CASE( PourTxSerializationTest ) {
+    auto keypair = libzerocash::ZerocashParams::GenerateNewKeyPair(TEST_TREE_DEPTH);
+    libzerocash::ZerocashParams p(
+        TEST_TREE_DEPTH,
+        std::move(keypair)
+    );
+
+    libzerocash::IncrementalMerkleTree merkleTree(TEST_TREE_DEPTH);
+    vector<unsigned char> rt(ZC_ROOT_SIZE);
+    merkleTree.getRootValue(rt);
+
+    vector<unsigned char> as(ZC_SIG_PK_SIZE, 'a');
+
+    const size_t proofOffset = ZC_TX_VERSION_SIZE + 2 * ZC_V_SIZE + 2 * ZC_SN_SIZE + 2 * ZC_CM_SIZE + 2 * ZC_H_SIZE;
+
+    // A version 1 pour round-trips, proof included.
+    libzerocash::PourTransaction pourtx(p, as, rt, {}, { libzerocash::PourOutput(3) }, 3, 0);
+    vector<uint8_t> encoded(ZC_TX_POUR_SIZE);
+    pourtx.serialize(&encoded[0]);
+    BOOST_CHECK(encoded[0] == 0 && encoded[1] == 1);
+
+    libzerocash::PourTransaction decoded;
+    decoded.deserialize(&encoded[0]);
+    BOOST_CHECK(decoded.getPublicValueIn() == 3);
+    BOOST_CHECK(decoded.getPublicValueOut() == 0);
+    BOOST_CHECK(decoded.getSpentSerial1() == pourtx.getSpentSerial1());
+    BOOST_CHECK(decoded.getSpentSerial2() == pourtx.getSpentSerial2());
+    BOOST_CHECK(decoded.getNewCoinCommitmentValue1() == pourtx.getNewCoinCommitmentValue1());
+    BOOST_CHECK(decoded.getNewCoinCommitmentValue2() == pourtx.getNewCoinCommitmentValue2());
+    BOOST_CHECK(decoded.getCiphertext1() == pourtx.getCiphertext1());
+    BOOST_CHECK(decoded.getCiphertext2() == pourtx.getCiphertext2());
+    BOOST_CHECK(decoded.verify(p, as, rt));
+
+    vector<uint8_t> reencoded(ZC_TX_POUR_SIZE);
+    decoded.serialize(&reencoded[0]);
+    BOOST_CHECK(reencoded == encoded);
+
+    // A proof that is not a valid encoding is rejected, and the transaction
+    // it was read into is left as it was.
+    vector<uint8_t> damaged(encoded);
+    damaged[proofOffset] |= 0x3f;     // x no longer reduced
+    BOOST_CHECK_THROW(decoded.deserialize(&damaged[0]), std::invalid_argument);
+    BOOST_CHECK(decoded.verify(p, as, rt));
+    decoded.serialize(&reencoded[0]);
+    BOOST_CHECK(reencoded == encoded);
+
+    // A version 0 pour carries no proof: it is written as zeros, and cannot
+    // be read back, since it would pass verification whatever it holds.
+    libzerocash::PourInput in_1(TEST_TREE_DEPTH), in_2(TEST_TREE_DEPTH);
+    libzerocash::PourOutput out_1(0), out_2(0);
+    libzerocash::PourTransaction pourtx_v0(0, p, rt,
+            in_1.old_coin, in_2.old_coin,
+            in_1.old_address, in_2.old_address,
+            in_1.merkle_index, in_2.merkle_index,
+            in_1.path, in_2.path,
+            out_1.to_address, out_2.to_address,
+            0, 0, as,
+            out_1.new_coin, out_2.new_coin);
+
+    vector<uint8_t> encoded_v0(ZC_TX_POUR_SIZE);
+    pourtx_v0.serialize(&encoded_v0[0]);
+    BOOST_CHECK(encoded_v0[0] == 0 && encoded_v0[1] == 0);
+    BOOST_CHECK(std::all_of(encoded_v0.begin() + proofOffset,
+                            encoded_v0.begin() + proofOffset + ZC_POUR_PROOF_SIZE,
+                            [](uint8_t b) { return b == 0; }));
+
+    BOOST_CHECK_THROW(decoded.deserialize(&encoded_v0[0]), std::invalid_argument);
+    decoded.serialize(&reencoded[0]);
+    BOOST_CHECK(reencoded == encoded);
+
+    // Nor can a version 1 pour be passed off as version 0.
+    vector<uint8_t> downgraded(encoded);
+    downgraded[1] = 0;
+    BOOST_CHECK_THROW(decoded.deserialize(&downgraded[0]), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE( BlockValidatorTest ) {
+    auto keypair = libzerocash::ZerocashParams::GenerateNewKeyPair(TEST_TREE_DEPTH);
+    libzerocash::ZerocashParams p(
+        TEST_TREE_DEPTH,
+        std::move(keypair)
+    );
+
+    libzerocash::IncrementalMerkleTree merkleTree(TEST_TREE_DEPTH);
+    libzerocash::SerialNumberSet spent;
+    libzerocash::BlockValidator validator(p, merkleTree, spent, 2);
+
+    vector<unsigned char> rt(ZC_ROOT_SIZE);
+    merkleTree.getRootValue(rt);
+    BOOST_CHECK(validator.isAnchor(rt));
+
+    vector<unsigned char> as(ZC_SIG_PK_SIZE, 'a');
+
+    libzerocash::PourBatchBuilder builder(p, 2);
+    for (uint64_t i = 1; i <= 8; i++) {
+        builder.add(as, rt, {}, { libzerocash::PourOutput(i) }, i, 0);
+    }
+    vector<libzerocash::PourTransaction> txs = builder.build();
+    vector<libzerocash::PourTransaction> block(txs.begin(), txs.begin() + 3);
+    vector<vector<unsigned char> > hashes(block.size(), as);
+    vector<vector<unsigned char> > roots(block.size(), rt);
+
+    vector<libzerocash::MintTransaction> mints;
+    for (uint64_t i = 0; i < 2; i++) {
+        libzerocash::Address addr = libzerocash::Address::CreateNewRandomAddress();
+        mints.push_back(libzerocash::MintTransaction(libzerocash::Coin(addr.getPublicAddress(), i)));
+    }
+
+    BOOST_CHECK(validator.connectBlock(mints, block, hashes, roots) == libzerocash::BlockValidator::VALID);
+    BOOST_CHECK(spent.size() == 6);
+
+    vector<unsigned char> rt2(ZC_ROOT_SIZE);
+    merkleTree.getRootValue(rt2);
+    BOOST_CHECK(rt2 != rt);
+    BOOST_CHECK(validator.isAnchor(rt2));
+
+    // The same commitments, appended one at a time, give the same root.
+    {
+        libzerocash::IncrementalMerkleTree expected(TEST_TREE_DEPTH);
+        vector<vector<unsigned char> > leaves;
+        for (const libzerocash::MintTransaction &mint : mints) {
+            leaves.push_back(mint.getMintedCoinCommitmentValue());
+        }
+        for (const libzerocash::PourTransaction &tx : block) {
+            leaves.push_back(tx.getNewCoinCommitmentValue1());
+            leaves.push_back(tx.getNewCoinCommitmentValue2());
+        }
+        for (const vector<unsigned char> &leaf : leaves) {
+            vector<bool> index;
+            expected.insertElement(libzerocash::Digest256(leaf.data()), index);
+        }
+        vector<unsigned char> expected_rt(ZC_ROOT_SIZE);
+        expected.getRootValue(expected_rt);
+        BOOST_CHECK(expected_rt == rt2);
+    }
+
+    // Rejected blocks change nothing.
+    vector<libzerocash::PourTransaction> last(1, txs[3]);
+    vector<unsigned char> bad_rt(rt);
+    bad_rt[0] ^= 1;
+
+    BOOST_CHECK(validator.connectBlock({}, block, hashes, roots) == libzerocash::BlockValidator::DOUBLE_SPEND);
+    BOOST_CHECK(validator.connectBlock({}, { txs[3], txs[3] }, { as, as }, { rt, rt }) == libzerocash::BlockValidator::DOUBLE_SPEND);
+    BOOST_CHECK(validator.connectBlock({}, last, { as }, { bad_rt }) == libzerocash::BlockValidator::UNKNOWN_ANCHOR);
+    BOOST_CHECK(validator.connectBlock({}, last, { vector<unsigned char>(ZC_SIG_PK_SIZE, 'b') }, { rt }) == libzerocash::BlockValidator::INVALID_POUR);
+    BOOST_CHECK(validator.connectBlock({ libzerocash::MintTransaction() }, last, { as }, { rt }) == libzerocash::BlockValidator::INVALID_MINT);
+    BOOST_CHECK_THROW(validator.connectBlock({}, last, {}, {}), std::invalid_argument);
+
+    // A version 0 pour carries no proof, and is rejected before any proof
+    // of the block is verified.
+    libzerocash::PourInput in_1(TEST_TREE_DEPTH), in_2(TEST_TREE_DEPTH);
+    libzerocash::PourOutput out_1(0), out_2(0);
+    libzerocash::PourTransaction pourtx_v0(0, p, rt,
+            in_1.old_coin, in_2.old_coin,
+            in_1.old_address, in_2.old_address,
+            in_1.merkle_index, in_2.merkle_index,
+            in_1.path, in_2.path,
+            out_1.to_address, out_2.to_address,
+            0, 0, as,
+            out_1.new_coin, out_2.new_coin);
+    BOOST_CHECK(pourtx_v0.verify(p, as, rt));
+    BOOST_CHECK(validator.connectBlock({}, { pourtx_v0 }, { as }, { rt }) == libzerocash::BlockValidator::INVALID_POUR);
+    BOOST_CHECK(validator.connectBlock({}, { txs[3], pourtx_v0 }, { as, as }, { rt, rt }) == libzerocash::BlockValidator::INVALID_POUR);
+
+    BOOST_CHECK(spent.size() == 6);
+    vector<unsigned char> rt3(ZC_ROOT_SIZE);
+    merkleTree.getRootValue(rt3);
+    BOOST_CHECK(rt3 == rt2);
+
+    // An earlier root is still a valid anchor.
+    BOOST_CHECK(validator.connectBlock({}, last, { as }, { rt }) == libzerocash::BlockValidator::VALID);
+    BOOST_CHECK(spent.size() == 8);
+
+    // A rejected block leaves none of its proofs queued in front of the next
+    // block, whether it was rejected before its proofs were submitted or by
+    // one of them.
+    vector<unsigned char> bs(ZC_SIG_PK_SIZE, 'b');
+    BOOST_CHECK(validator.connectBlock({}, { txs[4], txs[0] }, { as, as }, { rt, rt }) == libzerocash::BlockValidator::DOUBLE_SPEND);
+    BOOST_CHECK(validator.connectBlock({}, { txs[5] }, { as }, { rt2 }) == libzerocash::BlockValidator::VALID);
+    BOOST_CHECK(validator.connectBlock({}, { txs[6], txs[7] }, { bs, as }, { rt, rt }) == libzerocash::BlockValidator::INVALID_POUR);
+    BOOST_CHECK(validator.connectBlock({}, { txs[7] }, { as }, { rt }) == libzerocash::BlockValidator::VALID);
+    BOOST_CHECK(spent.size() == 12);
+
+    // The tree, of 16 leaves, now holds 14; a block that would overflow it
+    // changes nothing.
+    BOOST_CHECK(validator.connectBlock(mints, { txs[4] }, { as }, { rt }) == libzerocash::BlockValidator::TREE_FULL);
+    BOOST_CHECK(spent.size() == 12);
+    BOOST_CHECK(validator.connectBlock({}, { txs[4] }, { as }, { rt }) == libzerocash::BlockValidator::VALID);
+}
+
 BOOST_AUTO_TEST_CASE( CoinTest ) {
     cout << "\nCOIN TEST\n" << endl;
 
@@ -323,6 +726,14 @@ BOOST_AUTO_TEST_CASE( MintTxTest ) {
     libzerocash::timer_stop("Mint Transaction Verify");
 
     BOOST_CHECK(minttx_res);
+
+    vector<uint8_t> encoded(ZC_TX_MINT_SIZE);
+    minttx.serialize(&encoded[0]);
+    libzerocash::MintTransaction decoded;
+    decoded.deserialize(&encoded[0]);
+    BOOST_CHECK(decoded.verify());
+    BOOST_CHECK(decoded.getMintedCoinCommitmentValue() == minttx.getMintedCoinCommitmentValue());
+    BOOST_CHECK(decoded.getMonetaryValue() == minttx.getMonetaryValue());
 }
 
 BOOST_AUTO_TEST_CASE( PourTxTest ) {
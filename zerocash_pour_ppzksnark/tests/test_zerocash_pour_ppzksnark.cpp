@@ -311,6 +311,79 @@ void test_zerocash_pour_ppzksnark(const size_t num_old_coins, const size_t num_n
                                                                            proof);
     printf("Verification result: %s\n", verification_result ? "pass" : "FAIL");
     assert(verification_result);
+
+    /* a prover context must give valid proofs when reused */
+    zerocash_pour_prover_context<ppT> context(keypair.pk);
+    for (size_t i = 0; i < 2; ++i)
+    {
+        const zerocash_pour_proof<ppT> context_proof = context.prove(old_coin_authentication_paths,
+                                                                     old_coin_merkle_tree_positions,
+                                                                     merkle_tree_root,
+                                                                     new_address_public_keys,
+                                                                     old_address_secret_keys,
+                                                                     new_address_commitment_nonces,
+                                                                     old_address_commitment_nonces,
+                                                                     new_coin_serial_number_nonces,
+                                                                     old_coin_serial_number_nonces,
+                                                                     new_coin_values,
+                                                                     public_in_value,
+                                                                     public_out_value,
+                                                                     old_coin_values,
+                                                                     signature_public_key_hash);
+        const bool context_verification_result = zerocash_pour_ppzksnark_verifier<ppT>(keypair.vk,
+                                                                                       merkle_tree_root,
+                                                                                       old_coin_serial_numbers,
+                                                                                       new_coin_commitments,
+                                                                                       public_in_value,
+                                                                                       public_out_value,
+                                                                                       signature_public_key_hash,
+                                                                                       signature_public_key_hash_macs,
+                                                                                       context_proof);
+        printf("Verification result (prover context, proof %zu): %s\n", i, context_verification_result ? "pass" : "FAIL");
+        assert(context_verification_result);
+    }
+
+    /* batch verification: accept a batch of valid proofs, and point out a bad one */
+    const r1cs_primary_input<FieldT> primary_input = zerocash_pour_ppzksnark_primary_input<ppT>(keypair.vk,
+                                                                                                merkle_tree_root,
+                                                                                                old_coin_serial_numbers,
+                                                                                                new_coin_commitments,
+                                                                                                public_in_value,
+                                                                                                public_out_value,
+                                                                                                signature_public_key_hash,
+                                                                                                signature_public_key_hash_macs);
+    const zerocash_pour_processed_verification_key<ppT> pvk = zerocash_pour_ppzksnark_verifier_process_vk<ppT>(keypair.vk);
+    const bool online_verification_result = zerocash_pour_ppzksnark_online_verifier<ppT>(pvk, primary_input, proof);
+    printf("Online verification result: %s\n", online_verification_result ? "pass" : "FAIL");
+    assert(online_verification_result);
+
+    std::vector<bit_vector> wrong_serial_numbers = old_coin_serial_numbers;
+    wrong_serial_numbers[0][0] = !wrong_serial_numbers[0][0];
+    const r1cs_primary_input<FieldT> wrong_primary_input = zerocash_pour_ppzksnark_primary_input<ppT>(keypair.vk,
+                                                                                                      merkle_tree_root,
+                                                                                                      wrong_serial_numbers,
+                                                                                                      new_coin_commitments,
+                                                                                                      public_in_value,
+                                                                                                      public_out_value,
+                                                                                                      signature_public_key_hash,
+                                                                                                      signature_public_key_hash_macs);
+    std::vector<size_t> failed;
+    const bool batch_result = zerocash_pour_ppzksnark_batch_verifier<ppT>(keypair.vk,
+                                                                          { primary_input, primary_input, primary_input },
+                                                                          { proof, proof, proof },
+                                                                          failed);
+    printf("Batch verification result: %s\n", batch_result ? "pass" : "FAIL");
+    assert(batch_result && failed.empty());
+
+    assert(!zerocash_pour_ppzksnark_online_verifier<ppT>(pvk, wrong_primary_input, proof));
+
+    const bool bad_batch_result = zerocash_pour_ppzksnark_batch_verifier<ppT>(keypair.vk,
+                                                                              pvk,
+                                                                              { primary_input, wrong_primary_input, primary_input },
+                                                                              { proof, proof, proof },
+                                                                              failed);
+    printf("Batch verification result with a bad proof: %s\n", bad_batch_result ? "pass" : "FAIL");
+    assert(!bad_batch_result && failed == std::vector<size_t>({ 1 }));
 }
 
 int main(int argc, const char * argv[])
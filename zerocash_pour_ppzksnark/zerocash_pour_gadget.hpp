@@ -181,6 +181,17 @@ r1cs_primary_input<FieldT> zerocash_pour_input_map(const size_t num_old_coins,
                                                    const bit_vector &signature_public_key_hash,
                                                    const std::vector<bit_vector> &signature_public_key_hash_macs);
 
+/**
+ * As zerocash_pour_input_map, for the concatenation of its bit-string
+ * arguments (in the same order) packed into bytes, most significant bit
+ * first. The result is written to primary_input, whose storage is reused.
+ */
+template<typename FieldT>
+void zerocash_pour_input_map_from_bytes(const size_t num_old_coins,
+                                        const size_t num_new_coins,
+                                        const unsigned char *input_bytes,
+                                        r1cs_primary_input<FieldT> &primary_input);
+
 } // libzerocash
 
 #include "zerocash_pour_ppzksnark/zerocash_pour_gadget.tcc"
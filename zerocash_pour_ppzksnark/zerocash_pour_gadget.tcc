@@ -500,4 +500,30 @@ r1cs_primary_input<FieldT> zerocash_pour_input_map(const size_t num_old_coins,
     return input_as_field_elements;
 }
 
+template<typename FieldT>
+void zerocash_pour_input_map_from_bytes(const size_t num_old_coins,
+                                        const size_t num_new_coins,
+                                        const unsigned char *input_bytes,
+                                        r1cs_primary_input<FieldT> &primary_input)
+{
+    const size_t input_size_in_bits = sha256_digest_len + num_old_coins*sha256_digest_len + num_new_coins*sha256_digest_len + (coin_value_length * 2) + (num_old_coins + 1) * sha256_digest_len;
+    const size_t chunk_bits = FieldT::capacity();
+
+    /* same packing as pack_bit_vector_into_field_element_vector */
+    primary_input.resize(div_ceil(input_size_in_bits, chunk_bits));
+    for (size_t i = 0; i < primary_input.size(); ++i)
+    {
+        bigint<FieldT::num_limbs> b;
+        for (size_t j = 0; j < chunk_bits && i * chunk_bits + j < input_size_in_bits; ++j)
+        {
+            const size_t k = i * chunk_bits + j;
+            if ((input_bytes[k / 8] >> (7 - k % 8)) & 1)
+            {
+                b.data[j / GMP_NUMB_BITS] |= ((mp_limb_t) 1) << (j % GMP_NUMB_BITS);
+            }
+        }
+        primary_input[i] = FieldT(b);
+    }
+}
+
 } // libzerocash
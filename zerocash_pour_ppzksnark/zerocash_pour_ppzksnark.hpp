@@ -6,11 +6,15 @@
  This includes:
  - class for proving key
  - class for verification key
+ - class for processed verification key
  - class for key pair (proving key & verification key)
  - class for proof
+ - class for prover context
  - generator algorithm
  - prover algorithm
  - verifier algorithm
+ - online verifier algorithm
+ - batch verifier algorithm
 
  The ppzkSNARK is obtained by using an R1CS ppzkSNARK relative to an R1CS
  realization of the NP statement "Pour". The implementation follows, extends,
@@ -40,7 +44,9 @@
 #define ZEROCASH_POUR_PPZKSNARK_HPP_
 
 #include "libsnark/common/data_structures/merkle_tree.hpp"
+#include "libsnark/gadgetlib1/protoboard.hpp"
 #include "libsnark/zk_proof_systems/ppzksnark/r1cs_ppzksnark/r1cs_ppzksnark.hpp"
+#include <memory>
 #include <stdexcept>
 
 namespace libzerocash {
@@ -130,6 +136,33 @@ public:
     friend std::istream& operator>> <ppzksnark_ppT>(std::istream &in, zerocash_pour_verification_key<ppzksnark_ppT> &pk);
 };
 
+/************************ Processed verification key *************************/
+
+/**
+ * A processed verification key for the Pour ppzkSNARK.
+ *
+ * It holds the Miller-loop precomputations for the fixed elements of a
+ * verification key, so that the online verifier does not redo them for every
+ * proof.
+ */
+template<typename ppzksnark_ppT>
+class zerocash_pour_processed_verification_key {
+public:
+    size_t num_old_coins;
+    size_t num_new_coins;
+    r1cs_ppzksnark_processed_verification_key<ppzksnark_ppT> r1cs_pvk;
+
+    zerocash_pour_processed_verification_key() = default;
+    zerocash_pour_processed_verification_key(const zerocash_pour_processed_verification_key<ppzksnark_ppT> &other) = default;
+    zerocash_pour_processed_verification_key(zerocash_pour_processed_verification_key<ppzksnark_ppT> &&other) = default;
+    zerocash_pour_processed_verification_key(const size_t num_old_coins,
+                                             const size_t num_new_coins,
+                                             r1cs_ppzksnark_processed_verification_key<ppzksnark_ppT> &&r1cs_pvk) :
+        num_old_coins(num_old_coins), num_new_coins(num_new_coins),
+        r1cs_pvk(std::move(r1cs_pvk)) {}
+    zerocash_pour_processed_verification_key<ppzksnark_ppT>& operator=(const zerocash_pour_processed_verification_key<ppzksnark_ppT> &other) = default;
+};
+
 /********************************** Key pair *********************************/
 
 /**
@@ -176,6 +209,83 @@ template<typename ppzksnark_ppT>
 using zerocash_pour_proof = r1cs_ppzksnark_proof<ppzksnark_ppT>;
 
 
+/******************************* Prover context ******************************/
+
+template<typename FieldT>
+class zerocash_pour_gadget;
+
+/**
+ * A prover context for the Pour ppzkSNARK.
+ *
+ * The prover only needs a witness assignment, but the Pour gadget lays out its
+ * variables (and the constraints that is_satisfied() checks against) in
+ * generate_r1cs_constraints(). A prover context does that once, for the
+ * dimensions of a given proving key, and reuses the same protoboard and gadget
+ * for every proof: each call to prove() only resets the variable assignment
+ * and generates a new witness.
+ *
+ * The context keeps a reference to the proving key, which must outlive it. A
+ * context is not safe for concurrent use; use one context per thread.
+ */
+template<typename ppzksnark_ppT>
+class zerocash_pour_prover_context {
+public:
+    typedef Fr<ppzksnark_ppT> FieldT;
+
+    const zerocash_pour_proving_key<ppzksnark_ppT> &pk;
+
+    explicit zerocash_pour_prover_context(const zerocash_pour_proving_key<ppzksnark_ppT> &pk);
+    zerocash_pour_prover_context(const zerocash_pour_prover_context<ppzksnark_ppT> &other) = delete;
+    zerocash_pour_prover_context<ppzksnark_ppT>& operator=(const zerocash_pour_prover_context<ppzksnark_ppT> &other) = delete;
+
+    /**
+     * Assigns the witness for the given inputs to the protoboard; throws
+     * std::invalid_argument if they do not satisfy the Pour constraints.
+     */
+    void generate_witness(const std::vector<merkle_authentication_path> &old_coin_authentication_paths,
+                          const std::vector<size_t> &old_coin_merkle_tree_positions,
+                          const bit_vector &merkle_tree_root,
+                          const std::vector<bit_vector> &new_address_public_keys,
+                          const std::vector<bit_vector> &old_address_secret_keys,
+                          const std::vector<bit_vector> &new_address_commitment_nonces,
+                          const std::vector<bit_vector> &old_address_commitment_nonces,
+                          const std::vector<bit_vector> &new_coin_serial_number_nonces,
+                          const std::vector<bit_vector> &old_coin_serial_number_nonces,
+                          const std::vector<bit_vector> &new_coin_values,
+                          const bit_vector &public_old_value,
+                          const bit_vector &public_new_value,
+                          const std::vector<bit_vector> &old_coin_values,
+                          const bit_vector &signature_public_key_hash);
+
+    /**
+     * Proves the witness assigned by the last call to generate_witness.
+     */
+    zerocash_pour_proof<ppzksnark_ppT> prove() const;
+
+    /**
+     * Both of the above.
+     */
+    zerocash_pour_proof<ppzksnark_ppT> prove(const std::vector<merkle_authentication_path> &old_coin_authentication_paths,
+                                             const std::vector<size_t> &old_coin_merkle_tree_positions,
+                                             const bit_vector &merkle_tree_root,
+                                             const std::vector<bit_vector> &new_address_public_keys,
+                                             const std::vector<bit_vector> &old_address_secret_keys,
+                                             const std::vector<bit_vector> &new_address_commitment_nonces,
+                                             const std::vector<bit_vector> &old_address_commitment_nonces,
+                                             const std::vector<bit_vector> &new_coin_serial_number_nonces,
+                                             const std::vector<bit_vector> &old_coin_serial_number_nonces,
+                                             const std::vector<bit_vector> &new_coin_values,
+                                             const bit_vector &public_old_value,
+                                             const bit_vector &public_new_value,
+                                             const std::vector<bit_vector> &old_coin_values,
+                                             const bit_vector &signature_public_key_hash);
+
+private:
+    protoboard<FieldT> pb;
+    std::shared_ptr<zerocash_pour_gadget<FieldT> > g;
+};
+
+
 /***************************** Main algorithms *******************************/
 
 /**
@@ -192,7 +302,8 @@ zerocash_pour_keypair<ppzksnark_ppT> zerocash_pour_ppzksnark_generator(const siz
 /**
  * A prover algorithm for the Pour ppzkSNARK.
  *
- * TODO: add description
+ * This builds a one-off zerocash_pour_prover_context; callers producing more
+ * than one proof with the same key should keep a context around instead.
  */
 template<typename ppzksnark_ppT>
 zerocash_pour_proof<ppzksnark_ppT> zerocash_pour_ppzksnark_prover(const zerocash_pour_proving_key<ppzksnark_ppT> &pk,
@@ -211,6 +322,30 @@ zerocash_pour_proof<ppzksnark_ppT> zerocash_pour_ppzksnark_prover(const zerocash
                                                                   const std::vector<bit_vector> &old_coin_values,
                                                                   const bit_vector &signature_public_key_hash);
 
+/**
+ * Map the public inputs of a Pour to the primary input of the underlying R1CS
+ * ppzkSNARK, as expected by the verifier algorithms below.
+ */
+template<typename ppzksnark_ppT>
+r1cs_primary_input<Fr<ppzksnark_ppT> > zerocash_pour_ppzksnark_primary_input(const zerocash_pour_verification_key<ppzksnark_ppT> &vk,
+                                                                             const bit_vector &merkle_tree_root,
+                                                                             const std::vector<bit_vector> &old_coin_serial_numbers,
+                                                                             const std::vector<bit_vector> &new_coin_commitments,
+                                                                             const bit_vector &public_old_value,
+                                                                             const bit_vector &public_new_value,
+                                                                             const bit_vector &signature_public_key_hash,
+                                                                             const std::vector<bit_vector> &signature_public_key_hash_macs);
+
+/**
+ * As above, for the public inputs concatenated (in the same order) and packed
+ * into bytes, most significant bit first. The result is written to
+ * primary_input, whose storage is reused.
+ */
+template<typename ppzksnark_ppT>
+void zerocash_pour_ppzksnark_primary_input(const zerocash_pour_verification_key<ppzksnark_ppT> &vk,
+                                           const unsigned char *public_input_bytes,
+                                           r1cs_primary_input<Fr<ppzksnark_ppT> > &primary_input);
+
 /**
  * A verifier algorithm for the Pour ppzkSNARK.
  */
@@ -225,6 +360,64 @@ bool zerocash_pour_ppzksnark_verifier(const zerocash_pour_verification_key<ppzks
                                       const std::vector<bit_vector> &signature_public_key_hash_macs,
                                       const zerocash_pour_proof<ppzksnark_ppT> &proof);
 
+/**
+ * A verifier algorithm for the Pour ppzkSNARK, for a primary input obtained
+ * from zerocash_pour_ppzksnark_primary_input.
+ */
+template<typename ppzksnark_ppT>
+bool zerocash_pour_ppzksnark_verifier(const zerocash_pour_verification_key<ppzksnark_ppT> &vk,
+                                      const r1cs_primary_input<Fr<ppzksnark_ppT> > &primary_input,
+                                      const zerocash_pour_proof<ppzksnark_ppT> &proof);
+
+/**
+ * Convert a (non-processed) verification key into a processed verification key.
+ */
+template<typename ppzksnark_ppT>
+zerocash_pour_processed_verification_key<ppzksnark_ppT> zerocash_pour_ppzksnark_verifier_process_vk(const zerocash_pour_verification_key<ppzksnark_ppT> &vk);
+
+/**
+ * A verifier algorithm for the Pour ppzkSNARK that accepts a processed
+ * verification key, for a primary input obtained from
+ * zerocash_pour_ppzksnark_primary_input.
+ */
+template<typename ppzksnark_ppT>
+bool zerocash_pour_ppzksnark_online_verifier(const zerocash_pour_processed_verification_key<ppzksnark_ppT> &pvk,
+                                             const r1cs_primary_input<Fr<ppzksnark_ppT> > &primary_input,
+                                             const zerocash_pour_proof<ppzksnark_ppT> &proof);
+
+/**
+ * A batch verifier algorithm for the Pour ppzkSNARK.
+ *
+ * Each proof is accepted by the verifier iff five pairing-product equations
+ * hold. The batch verifier raises every equation of every proof to an
+ * independent random 128-bit exponent and multiplies them all together, so
+ * that the pairings against fixed elements of the verification key collapse
+ * into one Miller loop each, the pairings against a proof's g_B collapse into
+ * one Miller loop per proof, and a single final exponentiation is shared by
+ * the whole batch. An invalid proof makes the combined check fail except with
+ * probability about 2^-128.
+ *
+ * Returns true iff all proofs verify. Otherwise every proof is checked on its
+ * own, and the indices of the proofs that do not verify are stored in
+ * `failed` (in increasing order).
+ */
+template<typename ppzksnark_ppT>
+bool zerocash_pour_ppzksnark_batch_verifier(const zerocash_pour_verification_key<ppzksnark_ppT> &vk,
+                                            const std::vector<r1cs_primary_input<Fr<ppzksnark_ppT> > > &primary_inputs,
+                                            const std::vector<zerocash_pour_proof<ppzksnark_ppT> > &proofs,
+                                            std::vector<size_t> &failed);
+
+/**
+ * As above, but reusing the precomputations in a processed verification key
+ * for vk.
+ */
+template<typename ppzksnark_ppT>
+bool zerocash_pour_ppzksnark_batch_verifier(const zerocash_pour_verification_key<ppzksnark_ppT> &vk,
+                                            const zerocash_pour_processed_verification_key<ppzksnark_ppT> &pvk,
+                                            const std::vector<r1cs_primary_input<Fr<ppzksnark_ppT> > > &primary_inputs,
+                                            const std::vector<zerocash_pour_proof<ppzksnark_ppT> > &proofs,
+                                            std::vector<size_t> &failed);
+
 } // libzerocash
 
 #include "zerocash_pour_ppzksnark/zerocash_pour_ppzksnark.tcc"
@@ -128,6 +128,103 @@ zerocash_pour_keypair<ppzksnark_ppT> zerocash_pour_ppzksnark_generator(const siz
     return zerocash_pour_keypair<ppzksnark_ppT>(std::move(zerocash_pour_pk), std::move(zerocash_pour_vk));
 }
 
+template<typename ppzksnark_ppT>
+zerocash_pour_prover_context<ppzksnark_ppT>::zerocash_pour_prover_context(const zerocash_pour_proving_key<ppzksnark_ppT> &pk) :
+    pk(pk)
+{
+    enter_block("Call to zerocash_pour_prover_context::zerocash_pour_prover_context");
+    g.reset(new zerocash_pour_gadget<FieldT>(pb, pk.num_old_coins, pk.num_new_coins, pk.tree_depth, "zerocash_pour"));
+    g->generate_r1cs_constraints();
+    leave_block("Call to zerocash_pour_prover_context::zerocash_pour_prover_context");
+}
+
+template<typename ppzksnark_ppT>
+void zerocash_pour_prover_context<ppzksnark_ppT>::generate_witness(const std::vector<merkle_authentication_path> &old_coin_authentication_paths,
+                                                                   const std::vector<size_t> &old_coin_merkle_tree_positions,
+                                                                   const bit_vector &merkle_tree_root,
+                                                                   const std::vector<bit_vector> &new_address_public_keys,
+                                                                   const std::vector<bit_vector> &old_address_secret_keys,
+                                                                   const std::vector<bit_vector> &new_address_commitment_nonces,
+                                                                   const std::vector<bit_vector> &old_address_commitment_nonces,
+                                                                   const std::vector<bit_vector> &new_coin_serial_number_nonces,
+                                                                   const std::vector<bit_vector> &old_coin_serial_number_nonces,
+                                                                   const std::vector<bit_vector> &new_coin_values,
+                                                                   const bit_vector &public_old_value,
+                                                                   const bit_vector &public_new_value,
+                                                                   const std::vector<bit_vector> &old_coin_values,
+                                                                   const bit_vector &signature_public_key_hash)
+{
+    enter_block("Call to zerocash_pour_prover_context::generate_witness");
+
+    /* Start from an all-zero assignment so nothing from the previous proof leaks into this witness. */
+    pb.clear_values();
+    g->generate_r1cs_witness(old_coin_authentication_paths,
+                             old_coin_merkle_tree_positions,
+                             merkle_tree_root,
+                             new_address_public_keys,
+                             old_address_secret_keys,
+                             new_address_commitment_nonces,
+                             old_address_commitment_nonces,
+                             new_coin_serial_number_nonces,
+                             old_coin_serial_number_nonces,
+                             new_coin_values,
+                             public_old_value,
+                             public_new_value,
+                             old_coin_values,
+                             signature_public_key_hash);
+    if (!pb.is_satisfied()) {
+      leave_block("Call to zerocash_pour_prover_context::generate_witness");
+      throw std::invalid_argument("Constraints not satisfied by inputs");
+    }
+
+    leave_block("Call to zerocash_pour_prover_context::generate_witness");
+}
+
+template<typename ppzksnark_ppT>
+zerocash_pour_proof<ppzksnark_ppT> zerocash_pour_prover_context<ppzksnark_ppT>::prove() const
+{
+    return r1cs_ppzksnark_prover<ppzksnark_ppT>(pk.r1cs_pk, pb.primary_input(), pb.auxiliary_input());
+}
+
+template<typename ppzksnark_ppT>
+zerocash_pour_proof<ppzksnark_ppT> zerocash_pour_prover_context<ppzksnark_ppT>::prove(const std::vector<merkle_authentication_path> &old_coin_authentication_paths,
+                                                                                      const std::vector<size_t> &old_coin_merkle_tree_positions,
+                                                                                      const bit_vector &merkle_tree_root,
+                                                                                      const std::vector<bit_vector> &new_address_public_keys,
+                                                                                      const std::vector<bit_vector> &old_address_secret_keys,
+                                                                                      const std::vector<bit_vector> &new_address_commitment_nonces,
+                                                                                      const std::vector<bit_vector> &old_address_commitment_nonces,
+                                                                                      const std::vector<bit_vector> &new_coin_serial_number_nonces,
+                                                                                      const std::vector<bit_vector> &old_coin_serial_number_nonces,
+                                                                                      const std::vector<bit_vector> &new_coin_values,
+                                                                                      const bit_vector &public_old_value,
+                                                                                      const bit_vector &public_new_value,
+                                                                                      const std::vector<bit_vector> &old_coin_values,
+                                                                                      const bit_vector &signature_public_key_hash)
+{
+    enter_block("Call to zerocash_pour_ppzksnark_prover");
+
+    generate_witness(old_coin_authentication_paths,
+                     old_coin_merkle_tree_positions,
+                     merkle_tree_root,
+                     new_address_public_keys,
+                     old_address_secret_keys,
+                     new_address_commitment_nonces,
+                     old_address_commitment_nonces,
+                     new_coin_serial_number_nonces,
+                     old_coin_serial_number_nonces,
+                     new_coin_values,
+                     public_old_value,
+                     public_new_value,
+                     old_coin_values,
+                     signature_public_key_hash);
+    zerocash_pour_proof<ppzksnark_ppT> proof = prove();
+
+    leave_block("Call to zerocash_pour_ppzksnark_prover");
+
+    return proof;
+}
+
 template<typename ppzksnark_ppT>
 zerocash_pour_proof<ppzksnark_ppT> zerocash_pour_ppzksnark_prover(const zerocash_pour_proving_key<ppzksnark_ppT> &pk,
                                                                   const std::vector<merkle_authentication_path> &old_coin_authentication_paths,
@@ -145,37 +242,55 @@ zerocash_pour_proof<ppzksnark_ppT> zerocash_pour_ppzksnark_prover(const zerocash
                                                                   const std::vector<bit_vector> &old_coin_values,
                                                                   const bit_vector &signature_public_key_hash)
 {
-    typedef Fr<ppzksnark_ppT> FieldT;
-
-    enter_block("Call to zerocash_pour_ppzksnark_prover");
-
-    protoboard<FieldT> pb;
-    zerocash_pour_gadget<FieldT > g(pb, pk.num_old_coins, pk.num_new_coins, pk.tree_depth, "zerocash_pour");
-    g.generate_r1cs_constraints();
-    g.generate_r1cs_witness(old_coin_authentication_paths,
-                            old_coin_merkle_tree_positions,
-                            merkle_tree_root,
-                            new_address_public_keys,
-                            old_address_secret_keys,
-                            new_address_commitment_nonces,
-                            old_address_commitment_nonces,
-                            new_coin_serial_number_nonces,
-                            old_coin_serial_number_nonces,
-                            new_coin_values,
-                            public_old_value,
-                            public_new_value,
-                            old_coin_values,
-                            signature_public_key_hash);
-    if (!pb.is_satisfied()) {
-      leave_block("Call to zerocash_pour_ppzksnark_prover");
-      throw std::invalid_argument("Constraints not satisfied by inputs");
-    }
+    zerocash_pour_prover_context<ppzksnark_ppT> context(pk);
+    return context.prove(old_coin_authentication_paths,
+                         old_coin_merkle_tree_positions,
+                         merkle_tree_root,
+                         new_address_public_keys,
+                         old_address_secret_keys,
+                         new_address_commitment_nonces,
+                         old_address_commitment_nonces,
+                         new_coin_serial_number_nonces,
+                         old_coin_serial_number_nonces,
+                         new_coin_values,
+                         public_old_value,
+                         public_new_value,
+                         old_coin_values,
+                         signature_public_key_hash);
+}
 
-    zerocash_pour_proof<ppzksnark_ppT> proof = r1cs_ppzksnark_prover<ppzksnark_ppT>(pk.r1cs_pk, pb.primary_input(), pb.auxiliary_input());
+template<typename ppzksnark_ppT>
+r1cs_primary_input<Fr<ppzksnark_ppT> > zerocash_pour_ppzksnark_primary_input(const zerocash_pour_verification_key<ppzksnark_ppT> &vk,
+                                                                             const bit_vector &merkle_tree_root,
+                                                                             const std::vector<bit_vector> &old_coin_serial_numbers,
+                                                                             const std::vector<bit_vector> &new_coin_commitments,
+                                                                             const bit_vector &public_old_value,
+                                                                             const bit_vector &public_new_value,
+                                                                             const bit_vector &signature_public_key_hash,
+                                                                             const std::vector<bit_vector> &signature_public_key_hash_macs)
+{
+    typedef Fr<ppzksnark_ppT> FieldT;
 
-    leave_block("Call to zerocash_pour_ppzksnark_prover");
+    return zerocash_pour_input_map<FieldT>(vk.num_old_coins,
+                                           vk.num_new_coins,
+                                           merkle_tree_root,
+                                           old_coin_serial_numbers,
+                                           new_coin_commitments,
+                                           public_old_value,
+                                           public_new_value,
+                                           signature_public_key_hash,
+                                           signature_public_key_hash_macs);
+}
 
-    return proof;
+template<typename ppzksnark_ppT>
+void zerocash_pour_ppzksnark_primary_input(const zerocash_pour_verification_key<ppzksnark_ppT> &vk,
+                                           const unsigned char *public_input_bytes,
+                                           r1cs_primary_input<Fr<ppzksnark_ppT> > &primary_input)
+{
+    zerocash_pour_input_map_from_bytes<Fr<ppzksnark_ppT> >(vk.num_old_coins,
+                                                          vk.num_new_coins,
+                                                          public_input_bytes,
+                                                          primary_input);
 }
 
 template<typename ppzksnark_ppT>
@@ -189,24 +304,188 @@ bool zerocash_pour_ppzksnark_verifier(const zerocash_pour_verification_key<ppzks
                                       const std::vector<bit_vector> &signature_public_key_hash_macs,
                                       const zerocash_pour_proof<ppzksnark_ppT> &proof)
 {
-    typedef Fr<ppzksnark_ppT> FieldT;
+    const r1cs_primary_input<Fr<ppzksnark_ppT> > input = zerocash_pour_ppzksnark_primary_input<ppzksnark_ppT>(vk,
+                                                                                                              merkle_tree_root,
+                                                                                                              old_coin_serial_numbers,
+                                                                                                              new_coin_commitments,
+                                                                                                              public_old_value,
+                                                                                                              public_new_value,
+                                                                                                              signature_public_key_hash,
+                                                                                                              signature_public_key_hash_macs);
+    return zerocash_pour_ppzksnark_verifier<ppzksnark_ppT>(vk, input, proof);
+}
 
+template<typename ppzksnark_ppT>
+bool zerocash_pour_ppzksnark_verifier(const zerocash_pour_verification_key<ppzksnark_ppT> &vk,
+                                      const r1cs_primary_input<Fr<ppzksnark_ppT> > &primary_input,
+                                      const zerocash_pour_proof<ppzksnark_ppT> &proof)
+{
     enter_block("Call to zerocash_pour_ppzksnark_verifier");
-    const r1cs_primary_input<FieldT> input = zerocash_pour_input_map<FieldT>(vk.num_old_coins,
-                                                                             vk.num_new_coins,
-                                                                             merkle_tree_root,
-                                                                             old_coin_serial_numbers,
-                                                                             new_coin_commitments,
-                                                                             public_old_value,
-                                                                             public_new_value,
-                                                                             signature_public_key_hash,
-                                                                             signature_public_key_hash_macs);
-    const bool ans = r1cs_ppzksnark_verifier_strong_IC<ppzksnark_ppT>(vk.r1cs_vk, input, proof);
+    const bool ans = r1cs_ppzksnark_verifier_strong_IC<ppzksnark_ppT>(vk.r1cs_vk, primary_input, proof);
     leave_block("Call to zerocash_pour_ppzksnark_verifier");
 
     return ans;
 }
 
+template<typename ppzksnark_ppT>
+zerocash_pour_processed_verification_key<ppzksnark_ppT> zerocash_pour_ppzksnark_verifier_process_vk(const zerocash_pour_verification_key<ppzksnark_ppT> &vk)
+{
+    enter_block("Call to zerocash_pour_ppzksnark_verifier_process_vk");
+    r1cs_ppzksnark_processed_verification_key<ppzksnark_ppT> r1cs_pvk = r1cs_ppzksnark_verifier_process_vk<ppzksnark_ppT>(vk.r1cs_vk);
+    leave_block("Call to zerocash_pour_ppzksnark_verifier_process_vk");
+
+    return zerocash_pour_processed_verification_key<ppzksnark_ppT>(vk.num_old_coins, vk.num_new_coins, std::move(r1cs_pvk));
+}
+
+template<typename ppzksnark_ppT>
+bool zerocash_pour_ppzksnark_online_verifier(const zerocash_pour_processed_verification_key<ppzksnark_ppT> &pvk,
+                                             const r1cs_primary_input<Fr<ppzksnark_ppT> > &primary_input,
+                                             const zerocash_pour_proof<ppzksnark_ppT> &proof)
+{
+    enter_block("Call to zerocash_pour_ppzksnark_online_verifier");
+    const bool ans = r1cs_ppzksnark_online_verifier_strong_IC<ppzksnark_ppT>(pvk.r1cs_pvk, primary_input, proof);
+    leave_block("Call to zerocash_pour_ppzksnark_online_verifier");
+
+    return ans;
+}
+
+/**
+ * A random scalar of 128 bits, which is all the soundness of batch
+ * verification needs and halves the cost of the scalar multiplications
+ * compared to a full-size field element.
+ */
+template<typename FieldT>
+FieldT zerocash_pour_batch_scalar()
+{
+    bigint<FieldT::num_limbs> r;
+    r.randomize();
+    for (size_t i = 128 / GMP_NUMB_BITS; i < FieldT::num_limbs; ++i)
+    {
+        r.data[i] = 0;
+    }
+    return FieldT(r);
+}
+
+template<typename ppzksnark_ppT>
+bool zerocash_pour_ppzksnark_batch_verifier(const zerocash_pour_verification_key<ppzksnark_ppT> &vk,
+                                            const std::vector<r1cs_primary_input<Fr<ppzksnark_ppT> > > &primary_inputs,
+                                            const std::vector<zerocash_pour_proof<ppzksnark_ppT> > &proofs,
+                                            std::vector<size_t> &failed)
+{
+    return zerocash_pour_ppzksnark_batch_verifier<ppzksnark_ppT>(vk,
+                                                                 zerocash_pour_ppzksnark_verifier_process_vk<ppzksnark_ppT>(vk),
+                                                                 primary_inputs,
+                                                                 proofs,
+                                                                 failed);
+}
+
+template<typename ppzksnark_ppT>
+bool zerocash_pour_ppzksnark_batch_verifier(const zerocash_pour_verification_key<ppzksnark_ppT> &vk,
+                                            const zerocash_pour_processed_verification_key<ppzksnark_ppT> &pvk,
+                                            const std::vector<r1cs_primary_input<Fr<ppzksnark_ppT> > > &primary_inputs,
+                                            const std::vector<zerocash_pour_proof<ppzksnark_ppT> > &proofs,
+                                            std::vector<size_t> &failed)
+{
+    typedef Fr<ppzksnark_ppT> FieldT;
+
+    assert(primary_inputs.size() == proofs.size());
+    failed.clear();
+    if (proofs.empty())
+    {
+        return true;
+    }
+
+    enter_block("Call to zerocash_pour_ppzksnark_batch_verifier");
+    const r1cs_ppzksnark_verification_key<ppzksnark_ppT> &r1cs_vk = vk.r1cs_vk;
+
+    /*
+      For a proof with accumulated input acc, the verifier checks
+
+        e(g_A.g, alphaA_g2) = e(g_A.h, g2)
+        e(alphaB_g1, g_B.g) = e(g_B.h, g2)
+        e(g_C.g, alphaC_g2) = e(g_C.h, g2)
+        e(g_A.g + acc, g_B.g) = e(g_H, rC_Z_g2) * e(g_C.g, g2)
+        e(g_K, gamma_g2) = e(g_A.g + acc + g_C.g, gamma_beta_g2) * e(gamma_beta_g1, g_B.g)
+
+      Raising the i-th equation to r_i and moving everything to the left, the
+      G1 arguments paired with the same G2 element are summed below.
+    */
+    G1<ppzksnark_ppT> sum_alphaA = G1<ppzksnark_ppT>::zero();
+    G1<ppzksnark_ppT> sum_g2 = G1<ppzksnark_ppT>::zero();
+    G1<ppzksnark_ppT> sum_alphaC = G1<ppzksnark_ppT>::zero();
+    G1<ppzksnark_ppT> sum_rC_Z = G1<ppzksnark_ppT>::zero();
+    G1<ppzksnark_ppT> sum_gamma = G1<ppzksnark_ppT>::zero();
+    G1<ppzksnark_ppT> sum_gamma_beta = G1<ppzksnark_ppT>::zero();
+    Fqk<ppzksnark_ppT> miller_product = Fqk<ppzksnark_ppT>::one();
+
+    bool well_formed = true;
+    for (size_t i = 0; i < proofs.size(); ++i)
+    {
+        const zerocash_pour_proof<ppzksnark_ppT> &proof = proofs[i];
+        if (primary_inputs[i].size() != r1cs_vk.encoded_IC_query.domain_size() || !proof.is_well_formed())
+        {
+            well_formed = false;
+            break;
+        }
+
+        const G1<ppzksnark_ppT> acc = r1cs_vk.encoded_IC_query.template accumulate_chunk<FieldT>(primary_inputs[i].begin(), primary_inputs[i].end(), 0).first;
+        const G1<ppzksnark_ppT> A_acc = proof.g_A.g + acc;
+
+        const FieldT r_A = zerocash_pour_batch_scalar<FieldT>();
+        const FieldT r_B = zerocash_pour_batch_scalar<FieldT>();
+        const FieldT r_C = zerocash_pour_batch_scalar<FieldT>();
+        const FieldT r_QAP = zerocash_pour_batch_scalar<FieldT>();
+        const FieldT r_K = zerocash_pour_batch_scalar<FieldT>();
+
+        sum_alphaA = sum_alphaA + r_A * proof.g_A.g;
+        sum_g2 = sum_g2 - (r_A * proof.g_A.h + r_B * proof.g_B.h + r_C * proof.g_C.h + r_QAP * proof.g_C.g);
+        sum_alphaC = sum_alphaC + r_C * proof.g_C.g;
+        sum_rC_Z = sum_rC_Z - r_QAP * proof.g_H;
+        sum_gamma = sum_gamma + r_K * proof.g_K;
+        sum_gamma_beta = sum_gamma_beta - r_K * (A_acc + proof.g_C.g);
+
+        const G1<ppzksnark_ppT> g_B_partner = r_B * r1cs_vk.alphaB_g1 + r_QAP * A_acc - r_K * r1cs_vk.gamma_beta_g1;
+        miller_product = miller_product * ppzksnark_ppT::miller_loop(ppzksnark_ppT::precompute_G1(g_B_partner),
+                                                                     ppzksnark_ppT::precompute_G2(proof.g_B.g));
+    }
+
+    bool ans = false;
+    if (well_formed)
+    {
+        miller_product = miller_product * ppzksnark_ppT::double_miller_loop(ppzksnark_ppT::precompute_G1(sum_alphaA),
+                                                                            pvk.r1cs_pvk.vk_alphaA_g2_precomp,
+                                                                            ppzksnark_ppT::precompute_G1(sum_g2),
+                                                                            pvk.r1cs_pvk.pp_G2_one_precomp);
+        miller_product = miller_product * ppzksnark_ppT::double_miller_loop(ppzksnark_ppT::precompute_G1(sum_alphaC),
+                                                                            pvk.r1cs_pvk.vk_alphaC_g2_precomp,
+                                                                            ppzksnark_ppT::precompute_G1(sum_rC_Z),
+                                                                            pvk.r1cs_pvk.vk_rC_Z_g2_precomp);
+        miller_product = miller_product * ppzksnark_ppT::double_miller_loop(ppzksnark_ppT::precompute_G1(sum_gamma),
+                                                                            pvk.r1cs_pvk.vk_gamma_g2_precomp,
+                                                                            ppzksnark_ppT::precompute_G1(sum_gamma_beta),
+                                                                            pvk.r1cs_pvk.vk_gamma_beta_g2_precomp);
+        ans = (ppzksnark_ppT::final_exponentiation(miller_product) == GT<ppzksnark_ppT>::one());
+    }
+
+    if (!ans)
+    {
+        /* Find the culprits. */
+        for (size_t i = 0; i < proofs.size(); ++i)
+        {
+            if (!zerocash_pour_ppzksnark_online_verifier<ppzksnark_ppT>(pvk, primary_inputs[i], proofs[i]))
+            {
+                failed.emplace_back(i);
+            }
+        }
+        /* The combined check can only fail spuriously with negligible probability. */
+        ans = failed.empty();
+    }
+
+    leave_block("Call to zerocash_pour_ppzksnark_batch_verifier");
+
+    return ans;
+}
+
 } // libzerocash
 
 #endif // ZEROCASH_POUR_PPZKSNARK_TCC_